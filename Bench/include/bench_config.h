@@ -0,0 +1,91 @@
+#ifndef BENCH_CONFIG_H
+#define BENCH_CONFIG_H
+
+#include "server.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+/**
+ * @struct BenchConfig
+ * @brief Settings of lanchat-bench, read from the command line.
+ */
+struct BenchConfig
+{
+    /**
+     * @brief Which relay modes are measured.
+     */
+    enum class Mode
+    {
+        Direct,   ///< Group chat off: the records stop at the server.
+        Group,    ///< Group chat on: every record is relayed to the other clients.
+        Both      ///< Direct, then group.
+    };
+
+    static inline const char* USAGE =
+        "Usage: lanchat-bench [options]\n"
+        "  --clients N           Number of client connections (default 16)\n"
+        "  --rate R              Records per second per client, 0 = unlimited (default 1000)\n"
+        "  --size BYTES          Size of the record body, at least 8 (default 64)\n"
+        "  --duration SECONDS    Length of the measurement (default 5)\n"
+        "  --warmup SECONDS      Load before the measurement starts (default 1)\n"
+        "  --mode direct|group|both\n"
+        "                        Relay modes to measure (default both)\n"
+        "  --server-mode shared|per-core\n"
+        "                        Worker threads layout of the server (default shared)\n"
+        "  --threads N           Threads running the clients (default 2)\n"
+        "  --stalled N           Extra clients that never read, to exercise the slow\n"
+        "                        consumer policy (default 0)\n"
+        "  --session-budget BYTES\n"
+        "                        Server write queue budget per client (default 4194304)\n"
+        "  --slow-consumer drop-oldest|drop-newest|disconnect\n"
+        "                        Server slow consumer policy (default drop-oldest)\n"
+        "  --high-watermark BYTES\n"
+        "                        Server memory above which reads pause (default 268435456)\n"
+        "  --log-dir DIRECTORY   Keep the relayed messages in a server log in DIRECTORY\n"
+        "                        (default: no log)\n"
+        "  --log-fsync on|off    fsync the server log after every group commit (default off)\n"
+        "  --compression off|deflate|lz4|zstd\n"
+        "                        Codec of the large records, both ways (default off)\n"
+        "  --compression-threshold BYTES\n"
+        "                        Smallest record that is compressed (default 1024)\n"
+        "  --file-size BYTES     One more client uploads files of BYTES, one after the\n"
+        "                        other, during the run (default 0: no upload)\n"
+        "  --tcp-profile low-latency|bulk|system\n"
+        "                        TCP options of the server and the clients\n"
+        "                        (default low-latency)\n"
+        "  --help                Show this help\n";
+
+    std::size_t               clients        = 16;                              ///< Number of connections.
+    double                    rate           = 1000;                            ///< Records per second per client.
+    std::size_t               size           = 64;                              ///< Body size.
+    double                    duration       = 5;                               ///< Measured seconds.
+    double                    warmup         = 1;                               ///< Seconds before measuring.
+    Mode                      mode           = Mode::Both;                      ///< Relay modes to measure.
+    Server::ExecutionMode     server_mode    = Server::ExecutionMode::Shared;   ///< Server threads layout.
+    std::size_t               threads        = 2;                               ///< Client threads.
+    std::size_t               stalled        = 0;                               ///< Clients that never read.
+    Server::FlowControl       flow_control;                                     ///< Server write queue limits.
+    ChatLog::Options          chat_log;                                         ///< Server log, off if no directory.
+    Server::CompressionPolicy compression;                                      ///< Codec of the records, both ways.
+    std::uint64_t             file_size      = 0;                               ///< Size of the uploaded files, 0 = none.
+    SocketTuning              socket_tuning  = SocketTuning::lowLatency();      ///< TCP options of both ends.
+    bool                      show_help      = false;                           ///< --help was given.
+
+    /**
+     * @brief fromCommandLine Builds the configuration from the program arguments.
+     * @throws std::invalid_argument On unknown options or invalid values.
+     */
+    static BenchConfig fromCommandLine(const int argc, char* argv[]);
+    /**
+     * @brief set Applies one option.
+     * @param key Option name, without the leading dashes.
+     * @param value Option value (empty for flags).
+     * @throws std::invalid_argument On unknown keys or invalid values.
+     */
+    void set(const std::string& key, const std::string& value);
+};
+
+#endif // BENCH_CONFIG_H
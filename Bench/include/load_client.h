@@ -0,0 +1,138 @@
+#ifndef LOAD_CLIENT_H
+#define LOAD_CLIENT_H
+
+#include <boost/asio.hpp>
+
+#include "compression.h"
+#include "frame.h"
+#include "latency_histogram.h"
+#include "socket_tuning.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+/**
+ * @class LoadClient
+ * @brief One connection of the benchmark: sends records at a fixed rate and measures
+ *        the latency of the records it receives.
+ *
+ * The body of every record starts with the steady_clock time at which it was
+ * encoded, so the receiver (the server callback or another LoadClient, all in the
+ * same process) computes the end-to-end latency. Sends are paced by a timer: every
+ * tick the client writes, in a single gathered write, all the records that are due
+ * since the start. The handlers of a client run on its own strand, so its counters
+ * and its histogram need no lock.
+ *
+ * The body is text made of common words, which compresses about as well as chat
+ * messages do. With a codec, the client announces it in a Hello record, sends its
+ * large records compressed and decompresses the ones it receives.
+ */
+class LoadClient : public std::enable_shared_from_this<LoadClient>
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::size_t TIMESTAMP_SIZE = sizeof(std::int64_t);   ///< Bytes of the body taken by the send time.
+
+    /**
+     * @struct Stats
+     * @brief Counters of the measured interval.
+     */
+    struct Stats
+    {
+        std::uint64_t    sent_messages     = 0;   ///< Records written.
+        std::uint64_t    received_messages = 0;   ///< Records received from the server.
+        std::uint64_t    received_bytes    = 0;   ///< Bytes received, frame headers included.
+        LatencyHistogram latency;                 ///< Latency of the received records.
+    };
+
+private: // Fields
+    using Strand = boost::asio::strand<boost::asio::io_context::executor_type>;
+
+    static constexpr std::chrono::microseconds MIN_TICK{500};   ///< Shortest interval between two writes.
+    static constexpr std::size_t MAX_BATCH = 256;               ///< Records per write at most.
+
+    Strand                         m_strand;       ///< Serializes the handlers of the client.
+    boost::asio::ip::tcp::socket   m_socket;       ///< Connection to the server.
+    boost::asio::steady_timer      m_timer;        ///< Paces the writes.
+    FrameDecoder                   m_decoder;      ///< Receive buffer.
+
+    std::string                    m_sender;       ///< Sender of the records.
+    std::string                    m_body;         ///< Body template; the timestamp is patched in.
+    std::string                    m_decompressed; ///< The last decompressed record.
+    std::vector<SharedFrame>       m_batch;        ///< Frames of the write in flight.
+    std::vector<boost::asio::const_buffer> m_buffers; ///< Buffers of m_batch.
+
+    double                         m_rate;         ///< Records per second, 0 for as fast as possible.
+    Compression::Codec             m_codec;        ///< Codec of the large records, None for none.
+    std::size_t                    m_threshold;    ///< Smallest record that is compressed.
+    Clock::time_point              m_start;        ///< Start of the pacing.
+    std::uint64_t                  m_due;          ///< Records written since m_start, measured or not.
+
+    const std::atomic<bool>&       m_measuring;    ///< Counters are updated only while it is true.
+    std::atomic<bool>              m_running;      ///< Cleared by stop().
+    Stats                          m_stats;        ///< Counters of the measured interval.
+
+private: // Methods
+    /**
+     * @brief recv Reads from the socket and measures the received records.
+     */
+    void recv()                                                                  noexcept;
+    /**
+     * @brief tick Writes the records that are due, then waits for the next tick.
+     */
+    void tick()                                                                  noexcept;
+    /**
+     * @brief write Writes count records in a single gathered write.
+     */
+    void write(const std::size_t count)                                          noexcept;
+
+public:
+    /**
+     * @brief Creates an unconnected client.
+     * @param io_cntxt The io_context that runs the client.
+     * @param index Index of the client, used in the sender name.
+     * @param body_size Size of the record body, at least TIMESTAMP_SIZE.
+     * @param rate Records per second, 0 for as fast as the connection allows.
+     * @param codec Codec of the large records, Compression::Codec::None for none.
+     * @param threshold Smallest record that is compressed.
+     * @param measuring Shared flag telling whether the counters must be updated.
+     */
+    LoadClient(boost::asio::io_context& io_cntxt, const std::size_t index, const std::size_t body_size,
+               const double rate, const Compression::Codec codec, const std::size_t threshold,
+               const std::atomic<bool>& measuring);
+    /**
+     * @brief connect Connects synchronously and sends the Hello record if a codec is used.
+     * @param endpoint The server.
+     * @param tuning TCP options of the socket, set before it connects.
+     * @throws boost::system::system_error If the connection fails.
+     */
+    void connect(const boost::asio::ip::tcp::endpoint& endpoint, const SocketTuning& tuning);
+    /**
+     * @brief start Starts reading and sending.
+     */
+    void start()                                                                 noexcept;
+    /**
+     * @brief stop Stops sending and closes the connection.
+     */
+    void stop()                                                                  noexcept;
+    /**
+     * @brief stats The counters. Read them only once the io_context has stopped.
+     */
+    const Stats& stats()                                                   const noexcept;
+    /**
+     * @brief sendTime Extracts the send time from a record body.
+     * @return The send time, or nullopt if the body is too short.
+     */
+    static std::optional<Clock::time_point> sendTime(std::string_view body)     noexcept;
+};
+
+#endif // LOAD_CLIENT_H
@@ -0,0 +1,419 @@
+#include "bench_config.h"
+#include "file_transfer.h"
+#include "latency_histogram.h"
+#include "load_client.h"
+#include "server.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    /**
+     * @brief Outcome of one run.
+     */
+    struct Result
+    {
+        const char*      mode;                ///< "direct" or "group".
+        double           seconds;             ///< Length of the measured interval.
+        std::uint64_t    sent_messages;       ///< Records written by the clients.
+        std::uint64_t    delivered_messages;  ///< Records received by the server (direct) or the clients (group).
+        std::uint64_t    delivered_bytes;     ///< Bytes of the delivered records, frame headers included.
+        double           cpu_seconds;         ///< User + system time of the whole process.
+        LatencyHistogram latency;             ///< Send to delivery.
+        double           queued_bytes;        ///< Bytes in the server write queues at the end.
+        double           shed_messages;       ///< Messages discarded by the slow consumer policy.
+        double           slow_disconnects;    ///< Clients disconnected by the slow consumer policy.
+        double           reads_paused;        ///< Reads paused by the high-watermark.
+        double           logged_messages;     ///< Messages appended to the server log (whole run).
+        double           log_commits;         ///< Group commits of the server log (whole run).
+        double           log_commit_seconds;  ///< Sum of the commit latencies of the server log.
+        double           decompressed;        ///< Compressed records received by the server (whole run).
+        double           compressed;          ///< Records relayed compressed (whole run).
+        double           compression_saved;   ///< Bytes saved by relaying them compressed (whole run).
+        std::uint64_t    file_bytes;          ///< File data written by the uploader.
+        double           file_chunks;         ///< File chunks relayed by the server (whole run).
+        double           fanned_out;          ///< Broadcasts delivered by the shards, once per shard (whole run).
+        double           fan_outs;            ///< Fan-outs that delivered them (whole run).
+        double           relayed;             ///< Frames queued on the sessions (whole run).
+        double           writes;              ///< Writes of the sessions (whole run).
+    };
+
+    /**
+     * @brief metricValue Reads one value from the server metrics.
+     * @return The value of the first sample of the metric, or 0 if it is missing.
+     */
+    double metricValue(const std::string& metrics, std::string_view name)
+    {
+        std::size_t line = 0;
+
+        while(line < metrics.size())
+        {
+            const std::size_t end = std::min(metrics.find('\n', line), metrics.size());
+            const std::string_view text(metrics.data() + line, end - line);
+
+            if(text.size() > name.size() && text.substr(0, name.size()) == name && text[name.size()] == ' ')
+                return std::strtod(std::string(text.substr(name.size() + 1)).c_str(), nullptr);
+
+            line = end + 1;
+        }
+
+        return 0;
+    }
+
+    double cpuSeconds()
+    {
+        rusage usage{};
+        ::getrusage(RUSAGE_SELF, &usage);
+
+        return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+               static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    }
+
+    void sleepFor(const double seconds)
+    {
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    }
+
+    /**
+     * @brief uploadFiles Sends files of file_size bytes, one after the other, as fast as
+     *        the server reads them, until stop is set or the connection fails. Runs on a
+     *        thread of its own, with blocking writes.
+     * @param sent Incremented with the file data written.
+     */
+    void uploadFiles(boost::asio::ip::tcp::socket& socket, const std::uint64_t file_size,
+                     const std::atomic<bool>& stop, std::atomic<std::uint64_t>& sent)
+    {
+        const std::string data(FileTransfer::CHUNK_SIZE, 'x');
+        boost::system::error_code ec;
+
+        for(std::uint64_t id = 1; !ec && !stop.load(std::memory_order_relaxed); ++id)
+        {
+            const SharedFrame offer = FileTransfer::offerFrame("uploader", FileTransfer::Offer{id, file_size, "bench.bin"});
+            boost::asio::write(socket, offer.buffer(), ec);
+
+            for(std::uint64_t offset = 0; !ec && offset < file_size && !stop.load(std::memory_order_relaxed);)
+            {
+                const std::size_t size = static_cast<std::size_t>(std::min<std::uint64_t>(data.size(), file_size - offset));
+                const SharedFrame chunk = SharedFrame::create(FileTransfer::CHUNK_HEADER_SIZE + size, [&](std::uint8_t* out){
+                    FileTransfer::encodeChunkHeader(out, id, offset);
+                    std::memcpy(out + FileTransfer::CHUNK_HEADER_SIZE, data.data(), size);
+                });
+
+                boost::asio::write(socket, chunk.buffer(), ec);
+                offset += size;
+                sent.fetch_add(size, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    Result run(const BenchConfig& config, const bool group_chat)
+    {
+        Result result{group_chat ? "group" : "direct", 0, 0, 0, 0, 0, {}, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+        std::atomic<bool> measuring(false);
+
+        // In direct mode the records stop at the server, so the latency is measured
+        // by the callback. Calls for the same shard never overlap: one histogram each.
+        Server server(config.clients + config.stalled + 2, config.server_mode);
+
+        struct ShardStats
+        {
+            LatencyHistogram latency;
+            std::uint64_t    messages = 0;
+            std::uint64_t    bytes    = 0;
+        };
+        std::vector<ShardStats> shard_stats(server.getShardNum());
+
+        std::shared_ptr<boost::asio::ip::tcp::endpoint> endpoint;
+        Server::Callbacks callbacks;
+
+        callbacks.listening_on = [&endpoint](const std::shared_ptr<boost::asio::ip::tcp::endpoint>& listening){
+            endpoint = listening;
+        };
+        callbacks.message_received = [&shard_stats, &measuring](const std::size_t shard, std::string_view payload){
+            if(!measuring.load(std::memory_order_relaxed))
+                return;
+
+            const auto now = LoadClient::Clock::now();
+            MessageRecord record;
+            MessageRecord::decode(payload, record);
+
+            ShardStats& stats = shard_stats[shard];
+            ++stats.messages;
+            stats.bytes += Frame::HEADER_SIZE + payload.size();
+
+            if(const auto sent = LoadClient::sendTime(record.body))
+                stats.latency.record(static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(now - sent.value()).count()));
+        };
+        callbacks.connection_status = [](const char* status){
+            if(std::string_view(status) != "  Connected!" && std::string_view(status) != "  A client has disconnected.")
+                std::cerr << "lanchat-bench: server: " << status << '\n';
+        };
+
+        server.setCallbacks(std::move(callbacks));
+        server.setGroupChat(group_chat);
+        server.setFlowControl(config.flow_control);
+        server.setCompression(config.compression);
+        server.setSocketTuning(config.socket_tuning);
+
+        if(!config.chat_log.directory.empty())
+            server.setChatLog(config.chat_log);
+        server.setEndpoint(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 0));
+
+        if(!server.startConnection())
+            throw std::runtime_error("The server could not start.");
+
+        // The clients run on their own threads, so they do not steal the server's.
+        boost::asio::io_context io_cntxt;
+        auto work = boost::asio::make_work_guard(io_cntxt);
+        std::vector<std::thread> threads;
+
+        for(std::size_t i = 0; i < config.threads; ++i)
+            threads.emplace_back([&io_cntxt](){ io_cntxt.run(); });
+
+        std::vector<std::shared_ptr<LoadClient>> clients;
+
+        for(std::size_t i = 0; i < config.clients; ++i)
+        {
+            clients.push_back(std::make_shared<LoadClient>(io_cntxt, i, config.size, config.rate,
+                                                           config.compression.codec, config.compression.threshold,
+                                                           measuring));
+            clients.back()->connect(*endpoint, config.socket_tuning);
+        }
+
+        // The stalled clients never read: with group chat on, their write queues fill
+        // up on the server until the slow consumer policy applies.
+        std::vector<boost::asio::ip::tcp::socket> stalled;
+
+        for(std::size_t i = 0; i < config.stalled; ++i)
+        {
+            stalled.emplace_back(io_cntxt);
+            stalled.back().open(endpoint->protocol());
+            stalled.back().set_option(boost::asio::socket_base::receive_buffer_size(4096));
+            stalled.back().connect(*endpoint);
+        }
+
+        // The uploader reads (and drops) whatever the server relays to it, so that
+        // its own write queue never sheds.
+        boost::asio::ip::tcp::socket uploader(io_cntxt);
+        std::atomic<bool>            upload_stop(false);
+        std::atomic<std::uint64_t>   upload_sent(0);
+        std::vector<std::thread>     upload_threads;
+
+        if(config.file_size > 0)
+            uploader.connect(*endpoint);
+
+        const std::size_t connections = config.clients + config.stalled + (config.file_size > 0 ? 1 : 0);
+
+        // Every session must be registered in its shard before the load starts.
+        while(server.getClientNum() < connections)
+            sleepFor(0.01);
+        sleepFor(0.1);
+
+        for(auto& client : clients)
+            client->start();
+
+        if(config.file_size > 0)
+        {
+            upload_threads.emplace_back([&](){ uploadFiles(uploader, config.file_size, upload_stop, upload_sent); });
+            upload_threads.emplace_back([&uploader](){
+                std::vector<char> buffer(64 * 1024);
+                boost::system::error_code ec;
+
+                while(!ec)
+                    uploader.read_some(boost::asio::buffer(buffer), ec);
+            });
+        }
+
+        sleepFor(config.warmup);
+
+        const auto          start_time  = std::chrono::steady_clock::now();
+        const double        start_cpu   = cpuSeconds();
+        const std::uint64_t start_files = upload_sent.load();
+        measuring = true;
+
+        sleepFor(config.duration);
+
+        measuring = false;
+        result.cpu_seconds = cpuSeconds() - start_cpu;
+        result.seconds     = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        result.file_bytes  = upload_sent.load() - start_files;
+
+        const std::string metrics = server.renderMetrics();
+        result.queued_bytes     = metricValue(metrics, "lanchat_write_queue_bytes");
+        result.shed_messages    = metricValue(metrics, "lanchat_messages_shed_total");
+        result.slow_disconnects = metricValue(metrics, "lanchat_slow_consumer_disconnects_total");
+        result.reads_paused     = metricValue(metrics, "lanchat_reads_paused_total");
+
+        result.logged_messages    = metricValue(metrics, "lanchat_log_messages_total");
+        result.log_commits        = metricValue(metrics, "lanchat_log_commits_total");
+        result.log_commit_seconds = metricValue(metrics, "lanchat_log_commit_latency_seconds_sum");
+
+        result.decompressed      = metricValue(metrics, "lanchat_messages_decompressed_total");
+        result.compressed        = metricValue(metrics, "lanchat_messages_compressed_total");
+        result.compression_saved = metricValue(metrics, "lanchat_compression_saved_bytes_total");
+
+        result.file_chunks = metricValue(metrics, "lanchat_file_chunks_relayed_total");
+
+        result.fanned_out = metricValue(metrics, "lanchat_relay_latency_seconds_count");
+        result.fan_outs   = metricValue(metrics, "lanchat_fan_outs_total");
+        result.relayed    = metricValue(metrics, "lanchat_messages_relayed_total");
+        result.writes     = metricValue(metrics, "lanchat_write_latency_seconds_count");
+
+        for(auto& client : clients)
+            client->stop();
+
+        // The shutdown wakes up the blocked read and write of the uploader.
+        upload_stop = true;
+
+        if(uploader.is_open())
+        {
+            boost::system::error_code ec;
+            uploader.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+        }
+
+        for(auto& thread : upload_threads)
+            thread.join();
+
+        for(auto& socket : stalled)
+        {
+            boost::system::error_code ec;
+            socket.close(ec);
+        }
+
+        work.reset();
+        for(auto& thread : threads)
+            thread.join();
+
+        server.finish();
+
+        for(const auto& client : clients)
+        {
+            result.sent_messages += client->stats().sent_messages;
+
+            if(group_chat)
+            {
+                result.delivered_messages += client->stats().received_messages;
+                result.delivered_bytes    += client->stats().received_bytes;
+                result.latency.merge(client->stats().latency);
+            }
+        }
+
+        if(!group_chat)
+        {
+            for(const auto& stats : shard_stats)
+            {
+                result.delivered_messages += stats.messages;
+                result.delivered_bytes    += stats.bytes;
+                result.latency.merge(stats.latency);
+            }
+        }
+
+        return result;
+    }
+
+    void print(const BenchConfig& config, const Result& result)
+    {
+        const double delivered = static_cast<double>(result.delivered_messages);
+
+        std::printf("mode=%s clients=%zu rate=%.0f/s size=%zuB duration=%.2fs\n",
+                    result.mode, config.clients, config.rate, config.size, result.seconds);
+        std::printf("  sent         %12.0f msg/s\n", static_cast<double>(result.sent_messages) / result.seconds);
+        std::printf("  delivered    %12.0f msg/s  %10.2f MB/s\n",
+                    delivered / result.seconds, static_cast<double>(result.delivered_bytes) / result.seconds / 1e6);
+        std::printf("  latency      p50 %.1f us  p99 %.1f us  p999 %.1f us  max %.1f us\n",
+                    static_cast<double>(result.latency.percentile(0.50))  / 1e3,
+                    static_cast<double>(result.latency.percentile(0.99))  / 1e3,
+                    static_cast<double>(result.latency.percentile(0.999)) / 1e3,
+                    static_cast<double>(result.latency.max())             / 1e3);
+        std::printf("  cpu          %.3f us/msg delivered (server and clients, %.2f cores)\n",
+                    delivered > 0 ? result.cpu_seconds * 1e6 / delivered : 0.0,
+                    result.cpu_seconds / result.seconds);
+
+        if(std::strcmp(result.mode, "group") == 0)
+        {
+            std::printf("  fan-out      %.1f msg per fan-out, %.1f frames per write\n",
+                        result.fan_outs > 0 ? result.fanned_out / result.fan_outs : 0.0,
+                        result.writes > 0 ? result.relayed / result.writes : 0.0);
+        }
+
+        if(config.stalled > 0)
+        {
+            std::printf("  stalled      %zu clients: %.2f MB queued, %.0f msg shed, %.0f disconnected, "
+                        "reads paused %.0f times\n",
+                        config.stalled, result.queued_bytes / 1e6, result.shed_messages,
+                        result.slow_disconnects, result.reads_paused);
+        }
+
+        if(!config.chat_log.directory.empty())
+        {
+            std::printf("  log          %.0f msg in %.0f commits (%.1f msg/commit), mean commit %.1f us\n",
+                        result.logged_messages, result.log_commits,
+                        result.log_commits > 0 ? result.logged_messages / result.log_commits : 0.0,
+                        result.log_commits > 0 ? result.log_commit_seconds * 1e6 / result.log_commits : 0.0);
+        }
+
+        if(config.file_size > 0)
+        {
+            std::printf("  files        %.2f MB/s uploaded, %.0f chunks relayed\n",
+                        static_cast<double>(result.file_bytes) / result.seconds / 1e6, result.file_chunks);
+        }
+
+        if(config.compression.codec != Compression::Codec::None)
+        {
+            std::printf("  compression  %s: %.0f msg received and %.0f relayed compressed, %.2f MB saved\n",
+                        std::string(Compression::name(config.compression.codec)).c_str(),
+                        result.decompressed, result.compressed, result.compression_saved / 1e6);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    BenchConfig config;
+
+    try
+    {
+        config = BenchConfig::fromCommandLine(argc, argv);
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << "lanchat-bench: " << e.what() << '\n' << BenchConfig::USAGE;
+        return 2;
+    }
+
+    if(config.show_help)
+    {
+        std::cout << BenchConfig::USAGE;
+        return 0;
+    }
+
+    try
+    {
+        if(config.mode != BenchConfig::Mode::Group)
+            print(config, run(config, false));
+
+        if(config.mode != BenchConfig::Mode::Direct)
+            print(config, run(config, true));
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << "lanchat-bench: " << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,525 @@
+// Micro-benchmarks of the per-message hot paths.
+//
+// Run with --benchmark_format=json (or the run-microbench target, which writes
+// microbench.json in the build directory) and compare two runs with the
+// compare.py tool of Google Benchmark.
+//
+// The global operator new is replaced by a counting one, and the relay paths
+// report the heap allocations per message ("allocs/msg"), which must stay at 0
+// in the steady state.
+
+#include <benchmark/benchmark.h>
+
+#include "compression.h"
+#include "frame.h"
+#include "message_inbox.h"
+#include "message_record.h"
+#include "room_index.h"
+#include "session.h"
+#include "slot_table.h"
+#include "timing_wheel.h"
+
+#ifdef LANCHAT_MICROBENCH_GUI
+#include "chat_log_model.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::atomic<std::uint64_t> allocation_count(0);   ///< Calls of the global operator new.
+}
+
+void* operator new(const std::size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+    if(void* block = std::malloc(size ? size : 1))
+        return block;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept
+{
+    std::free(block);
+}
+
+namespace
+{
+    constexpr std::size_t FRAMES_PER_READ = 64;   ///< Frames in the buffer of one simulated read.
+
+    MessageRecord makeRecord(const std::string& body)
+    {
+        MessageRecord record;
+        record.type      = MessageRecord::Type::Chat;
+        record.timestamp = MessageRecord::now();
+        record.sender    = "benchmark";
+        record.body      = body;
+
+        return record;
+    }
+
+    // Chat-like text: common words in a pseudo-random order. A run of identical bytes
+    // would make every codec look far better than on real messages.
+    std::string makeText(const std::size_t size)
+    {
+        static const char* const WORDS[] = {"the", "meeting", "is", "moved", "to", "room", "three", "can",
+                                            "you", "send", "me", "latest", "build", "log", "please", "thanks"};
+        std::string   text;
+        std::uint64_t seed = 1;
+
+        while(text.size() < size)
+        {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            text += WORDS[(seed >> 33) % 16];
+            text += ' ';
+        }
+
+        text.resize(size);
+        return text;
+    }
+
+    // Bytes of FRAMES_PER_READ encoded records, as a read of Session::readAvailable would see them.
+    std::vector<std::uint8_t> makeStream(const std::size_t body_size)
+    {
+        const std::string body(body_size, 'x');
+        std::vector<std::uint8_t> stream;
+
+        for(std::size_t i = 0; i < FRAMES_PER_READ; ++i)
+        {
+            const SharedFrame frame = makeRecord(body).toFrame();
+            const auto* data = static_cast<const std::uint8_t*>(frame.buffer().data());
+
+            stream.insert(stream.end(), data, data + frame.size());
+        }
+
+        return stream;
+    }
+
+    /**
+     * @brief Counts the heap allocations of the measured loop of a benchmark.
+     */
+    class AllocationCounter
+    {
+    private: // Fields
+        std::uint64_t m_start;   ///< Allocations before the loop.
+
+    public:
+        AllocationCounter() : m_start(allocation_count.load(std::memory_order_relaxed)) {}
+
+        /**
+         * @brief report Sets the allocs/msg counter of the benchmark.
+         * @param messages Messages handled by the loop.
+         */
+        void report(benchmark::State& state, const std::uint64_t messages) const
+        {
+            const std::uint64_t allocations = allocation_count.load(std::memory_order_relaxed) - m_start;
+
+            state.counters["allocs/msg"] = messages ? static_cast<double>(allocations) / static_cast<double>(messages)
+                                                    : 0.0;
+        }
+    };
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// RECEIVE PATH (Session::readAvailable)
+///
+static void BM_FrameDecode(benchmark::State& state)
+{
+    const std::vector<std::uint8_t> stream = makeStream(static_cast<std::size_t>(state.range(0)));
+    FrameDecoder decoder;
+
+    for(auto _ : state)
+    {
+        // The stream arrives in reads as large as the free space of the buffer.
+        for(std::size_t offset = 0; offset < stream.size();)
+        {
+            const boost::asio::mutable_buffer buffer = decoder.prepare();
+            const std::size_t bytes = std::min(buffer.size(), stream.size() - offset);
+
+            std::memcpy(buffer.data(), stream.data() + offset, bytes);
+            decoder.commit(bytes);
+            offset += bytes;
+
+            std::string_view payload;
+            while(decoder.next(payload) == FrameDecoder::Status::Ok)
+                benchmark::DoNotOptimize(payload);
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * FRAMES_PER_READ));
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * stream.size()));
+}
+BENCHMARK(BM_FrameDecode)->Arg(64)->Arg(1024);
+
+static void BM_RecordDecode(benchmark::State& state)
+{
+    const SharedFrame frame = makeRecord(std::string(static_cast<std::size_t>(state.range(0)), 'x')).toFrame();
+
+    for(auto _ : state)
+    {
+        MessageRecord record;
+        benchmark::DoNotOptimize(MessageRecord::decode(frame.payload(), record));
+        benchmark::DoNotOptimize(record);
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+}
+BENCHMARK(BM_RecordDecode)->Arg(64)->Arg(1024);
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// SEND PATH (Server::send, group-chat echo)
+///
+static void BM_RecordEncode(benchmark::State& state)
+{
+    const std::string   body(static_cast<std::size_t>(state.range(0)), 'x');
+    const MessageRecord record = makeRecord(body);
+
+    for(auto _ : state)
+        benchmark::DoNotOptimize(record.toFrame());
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * record.encodedSize()));
+}
+BENCHMARK(BM_RecordEncode)->Arg(64)->Arg(1024);
+
+static void BM_EchoEncode(benchmark::State& state)
+{
+    const SharedFrame frame = makeRecord(std::string(static_cast<std::size_t>(state.range(0)), 'x')).toFrame();
+
+    // The relay copies the received payload into a new frame. The first frame warms
+    // the buffer pool up, the following ones reuse its block.
+    benchmark::DoNotOptimize(SharedFrame::encode(frame.payload()));
+
+    const AllocationCounter allocations;
+
+    for(auto _ : state)
+        benchmark::DoNotOptimize(SharedFrame::encode(frame.payload()));
+
+    allocations.report(state, state.iterations());
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+}
+BENCHMARK(BM_EchoEncode)->Arg(64)->Arg(1024);
+
+static void BM_BroadcastFanOut(benchmark::State& state)
+{
+    // Mirrors Server::broadcast on one shard: walk the slot table and queue a
+    // reference to the same frame on every session, then let the writes drain.
+    struct FakeSession
+    {
+        Session::WriteQueue write_queue;
+    };
+
+    const std::size_t session_num = static_cast<std::size_t>(state.range(0));
+    SlotTable<std::shared_ptr<FakeSession>> sessions(session_num);
+
+    for(std::size_t i = 0; i < session_num; ++i)
+        sessions.insert(std::make_shared<FakeSession>());
+
+    const SharedFrame frame = makeRecord(std::string(64, 'x')).toFrame();
+    const AllocationCounter allocations;
+
+    for(auto _ : state)
+    {
+        sessions.forEach([&frame](std::shared_ptr<FakeSession>& session){
+            session->write_queue.push_back(frame);
+        });
+        sessions.forEach([](std::shared_ptr<FakeSession>& session){
+            session->write_queue.pop_front();
+        });
+    }
+
+    allocations.report(state, state.iterations() * session_num);
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * session_num));
+}
+BENCHMARK(BM_BroadcastFanOut)->Arg(8)->Arg(64)->Arg(1024);
+
+static void BM_RelaySteadyState(benchmark::State& state)
+{
+    // The whole relay of a read of FRAMES_PER_READ messages on one shard: decode,
+    // copy each payload into a frame, queue it on 8 sessions, then complete the
+    // writes. Nothing may allocate once the pool and the queues are warm.
+    struct FakeSession
+    {
+        Session::WriteQueue write_queue;
+    };
+
+    const std::vector<std::uint8_t> stream = makeStream(static_cast<std::size_t>(state.range(0)));
+    std::vector<FakeSession> sessions(8);
+    FrameDecoder decoder(stream.size());
+
+    const auto relay = [&](){
+        const boost::asio::mutable_buffer buffer = decoder.prepare();
+        std::memcpy(buffer.data(), stream.data(), stream.size());
+        decoder.commit(stream.size());
+
+        std::string_view payload;
+        while(decoder.next(payload) == FrameDecoder::Status::Ok)
+        {
+            const SharedFrame frame = SharedFrame::encode(payload);
+
+            for(auto& session : sessions)
+                session.write_queue.push_back(frame);
+        }
+
+        for(auto& session : sessions)
+            while(!session.write_queue.empty())
+                session.write_queue.pop_front();
+    };
+
+    relay();
+
+    const AllocationCounter allocations;
+
+    for(auto _ : state)
+        relay();
+
+    allocations.report(state, state.iterations() * FRAMES_PER_READ);
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * FRAMES_PER_READ));
+}
+BENCHMARK(BM_RelaySteadyState)->Arg(64)->Arg(1024)->Arg(16384);
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// COMPRESSION (Server::broadcast, Client::send, Client::decompress)
+///
+static void BM_Compress(benchmark::State& state)
+{
+    // Arguments: codec, body size. The ratio counter is original size / compressed size;
+    // with the bytes per second it gives the CPU spent per byte saved.
+    const auto codec = static_cast<Compression::Codec>(state.range(0));
+
+    if(!Compression::contains(Compression::available(), codec))
+    {
+        state.SkipWithError("codec not built");
+        return;
+    }
+
+    const std::string body  = makeText(static_cast<std::size_t>(state.range(1)));
+    const SharedFrame frame = makeRecord(body).toFrame();
+    std::size_t       size  = 0;
+
+    for(auto _ : state)
+    {
+        const SharedFrame compressed = Compression::compress(frame.payload(), codec);
+        size = compressed ? compressed.size() : frame.size();
+        benchmark::DoNotOptimize(size);
+    }
+
+    state.counters["ratio"] = static_cast<double>(frame.size()) / static_cast<double>(size);
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * frame.size()));
+}
+BENCHMARK(BM_Compress)->ArgsProduct({{1, 2, 3}, {256, 1024, 16384}});
+
+static void BM_Decompress(benchmark::State& state)
+{
+    // Same arguments; done once per receiving client.
+    const auto codec = static_cast<Compression::Codec>(state.range(0));
+
+    if(!Compression::contains(Compression::available(), codec))
+    {
+        state.SkipWithError("codec not built");
+        return;
+    }
+
+    const std::string body       = makeText(static_cast<std::size_t>(state.range(1)));
+    const SharedFrame frame      = makeRecord(body).toFrame();
+    const SharedFrame compressed = Compression::compress(frame.payload(), codec);
+
+    MessageRecord record;
+    std::string   original;
+
+    if(!compressed || !MessageRecord::decode(compressed.payload(), record))
+    {
+        state.SkipWithError("not compressible");
+        return;
+    }
+
+    for(auto _ : state)
+    {
+        Compression::decompress(record, original);
+        benchmark::DoNotOptimize(original.data());
+    }
+
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * frame.size()));
+}
+BENCHMARK(BM_Decompress)->ArgsProduct({{1, 2, 3}, {256, 1024, 16384}});
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// IDLE CHECKS (Server::tickIdleWheel)
+///
+static void BM_IdleWheelTick(benchmark::State& state)
+{
+    // state.range(0) sessions, each checked every 40 ticks (10 s at 250 ms) and
+    // scheduled again, as Server::checkIdle does for a live session. One tick only
+    // touches its own slot, so its cost follows the checks due, not the sessions.
+    constexpr Session::IdleWheel::Tick INTERVAL = 40;
+
+    const std::size_t session_num = static_cast<std::size_t>(state.range(0));
+    Session::IdleWheel wheel(256);
+
+    for(std::size_t i = 0; i < session_num; ++i)
+        wheel.schedule(i, 1 + i % INTERVAL);
+
+    // A full interval warms every slot up.
+    for(Session::IdleWheel::Tick i = 0; i < INTERVAL; ++i)
+        wheel.advance([&wheel](const Session::Id slot){ wheel.schedule(slot, INTERVAL); });
+
+    const AllocationCounter allocations;
+
+    for(auto _ : state)
+        wheel.advance([&wheel](const Session::Id slot){ wheel.schedule(slot, INTERVAL); });
+
+    allocations.report(state, state.iterations() * session_num / INTERVAL);
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * session_num / INTERVAL));
+}
+BENCHMARK(BM_IdleWheelTick)->Arg(1000)->Arg(100000);
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// CHANNELS (Server::broadcast to a channel, Server::subscribe)
+///
+static void BM_RoomFanOut(benchmark::State& state)
+{
+    // state.range(0) sessions in rooms of state.range(1) members each. A message to a
+    // room looks the room up and walks its members only, so the cost follows the
+    // size of the room, not the number of sessions or rooms.
+    const std::size_t session_num = static_cast<std::size_t>(state.range(0));
+    const std::size_t room_size   = static_cast<std::size_t>(state.range(1));
+    const std::size_t room_num    = session_num / room_size;
+
+    RoomIndex rooms;
+    std::vector<std::string> names;
+
+    for(std::size_t i = 0; i < room_num; ++i)
+        names.push_back("#room" + std::to_string(i));
+
+    for(std::size_t i = 0; i < session_num; ++i)
+        rooms.join(names[i % room_num], i);
+
+    std::size_t next = 0;
+
+    for(auto _ : state)
+    {
+        RoomIndex::Member sum = 0;
+
+        for(const RoomIndex::Member member : *rooms.members(names[next]))
+            sum += member;
+
+        benchmark::DoNotOptimize(sum);
+        next = (next + 1) % room_num;
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * room_size));
+}
+BENCHMARK(BM_RoomFanOut)->Args({1000, 8})->Args({100000, 8})->Args({100000, 1000});
+
+static void BM_RoomJoinLeave(benchmark::State& state)
+{
+    // Every session is in 4 of state.range(0) rooms; each iteration moves one of
+    // them to another room. Both operations take constant time; the storage of the
+    // rooms is reused, so only the growth of a room past its capacity allocates.
+    constexpr std::size_t SESSION_NUM = 10000;
+    constexpr std::size_t PER_SESSION = 4;
+
+    const std::size_t room_num = static_cast<std::size_t>(state.range(0));
+
+    RoomIndex rooms;
+    std::vector<std::string> names;
+
+    for(std::size_t i = 0; i < room_num; ++i)
+        names.push_back("#room" + std::to_string(i));
+
+    for(std::size_t i = 0; i < SESSION_NUM; ++i)
+        for(std::size_t j = 0; j < PER_SESSION; ++j)
+            rooms.join(names[(i + j * 7) % room_num], i);
+
+    std::size_t next = 0;
+
+    // A session leaves the room it joined last and joins the next one, round-robin.
+    const auto move = [&](){
+        const std::size_t session = next % SESSION_NUM;
+        const std::size_t shift   = next / SESSION_NUM;
+
+        rooms.leave(names[(session + shift) % room_num], session);
+        rooms.join(names[(session + shift + PER_SESSION * 7) % room_num], session);
+        ++next;
+    };
+
+    for(std::size_t i = 0; i < SESSION_NUM; ++i)
+        move();
+
+    const AllocationCounter allocations;
+
+    for(auto _ : state)
+        move();
+
+    allocations.report(state, state.iterations());
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+}
+BENCHMARK(BM_RoomJoinLeave)->Arg(100)->Arg(10000);
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// GUI HAND-OFF AND APPEND PATH
+///
+static void BM_InboxPushDrain(benchmark::State& state)
+{
+    // One producer and one consumer on the same thread: the cost of the hand-off
+    // itself, without the wakeup (which is once per burst).
+    const std::size_t batch = static_cast<std::size_t>(state.range(0));
+    const std::string message(64, 'x');
+    MessageInbox inbox(1, nullptr);
+
+    for(auto _ : state)
+    {
+        for(std::size_t i = 0; i < batch; ++i)
+            inbox.push(0, message);
+
+        inbox.drain([](std::string_view payload){ benchmark::DoNotOptimize(payload); }, batch);
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * batch));
+}
+BENCHMARK(BM_InboxPushDrain)->Arg(1)->Arg(256);
+
+#ifdef LANCHAT_MICROBENCH_GUI
+static void BM_ChatLogAppend(benchmark::State& state)
+{
+    // The append cost must not depend on the history length (state.range(0)).
+    const SharedFrame frame = makeRecord(std::string(64, 'x')).toFrame();
+    ChatLogModel model;
+
+    QList<ChatMessage> history;
+    for(std::int64_t i = 0; i < state.range(0); ++i)
+    {
+        MessageRecord record;
+        MessageRecord::decode(frame.payload(), record);
+        history.append(ChatMessage::fromRecord(record));
+    }
+    model.appendMessages(history);
+
+    for(auto _ : state)
+    {
+        MessageRecord record;
+        MessageRecord::decode(frame.payload(), record);
+
+        model.appendMessages(QList<ChatMessage>{ChatMessage::fromRecord(record)});
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+}
+BENCHMARK(BM_ChatLogAppend)->Arg(0)->Arg(100000);
+#endif
+
+BENCHMARK_MAIN();
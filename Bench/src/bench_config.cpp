@@ -0,0 +1,111 @@
+#include "bench_config.h"
+
+#include <stdexcept>
+
+namespace
+{
+    double parseNumber(const std::string& key, const std::string& value, const double min, const double max)
+    {
+        try
+        {
+            std::size_t end = 0;
+            const double number = std::stod(value, &end);
+
+            if(end == value.size() && number >= min && number <= max)
+                return number;
+        }
+        catch(const std::exception&)
+        {
+        }
+
+        throw std::invalid_argument("Invalid value for " + key + ": " + value);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+BenchConfig BenchConfig::fromCommandLine(const int argc, char* argv[])
+{
+    BenchConfig config;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+
+        if(arg.rfind("--", 0) != 0)
+            throw std::invalid_argument("Unexpected argument: " + arg);
+
+        const std::string key = arg.substr(2);
+
+        if(key == "help")
+            config.set(key, "");
+        else if(i + 1 < argc)
+            config.set(key, argv[++i]);
+        else
+            throw std::invalid_argument("Missing value for " + arg);
+    }
+
+    return config;
+}
+
+void BenchConfig::set(const std::string& key, const std::string& value)
+{
+    if(key == "clients")
+        clients = static_cast<std::size_t>(parseNumber(key, value, 1, 100000));
+    else if(key == "rate")
+        rate = parseNumber(key, value, 0, 1e9);
+    else if(key == "size")
+        size = static_cast<std::size_t>(parseNumber(key, value, 8, Frame::MAX_PAYLOAD_SIZE - 1024));
+    else if(key == "duration")
+        duration = parseNumber(key, value, 0.1, 3600);
+    else if(key == "warmup")
+        warmup = parseNumber(key, value, 0, 3600);
+    else if(key == "threads")
+        threads = static_cast<std::size_t>(parseNumber(key, value, 1, 1024));
+    else if(key == "stalled")
+        stalled = static_cast<std::size_t>(parseNumber(key, value, 0, 100000));
+    else if(key == "session-budget")
+        flow_control.session_budget = static_cast<std::size_t>(parseNumber(key, value, 0, 1e15));
+    else if(key == "high-watermark")
+        flow_control.high_watermark = static_cast<std::size_t>(parseNumber(key, value, 0, 1e15));
+    else if(key == "log-dir")
+        chat_log.directory = value;
+    else if(key == "log-fsync" && (value == "on" || value == "off"))
+        chat_log.fsync = value == "on";
+    else if(key == "compression" && Compression::fromName(value))
+        compression.codec = *Compression::fromName(value);
+    else if(key == "file-size")
+        file_size = static_cast<std::uint64_t>(parseNumber(key, value, 0, 1e15));
+    else if(key == "compression-threshold")
+        compression.threshold = static_cast<std::size_t>(parseNumber(key, value, 0, Frame::MAX_PAYLOAD_SIZE));
+    else if(key == "slow-consumer" && value == "drop-oldest")
+        flow_control.policy = Server::SlowConsumerPolicy::DropOldest;
+    else if(key == "slow-consumer" && value == "drop-newest")
+        flow_control.policy = Server::SlowConsumerPolicy::DropNewest;
+    else if(key == "slow-consumer" && value == "disconnect")
+        flow_control.policy = Server::SlowConsumerPolicy::Disconnect;
+    else if(key == "mode" && value == "direct")
+        mode = Mode::Direct;
+    else if(key == "mode" && value == "group")
+        mode = Mode::Group;
+    else if(key == "mode" && value == "both")
+        mode = Mode::Both;
+    else if(key == "server-mode" && value == "shared")
+        server_mode = Server::ExecutionMode::Shared;
+    else if(key == "server-mode" && value == "per-core")
+        server_mode = Server::ExecutionMode::PerCore;
+    else if(key == "tcp-profile" && SocketTuning::fromName(value))
+        socket_tuning = *SocketTuning::fromName(value);
+    else if(key == "mode" || key == "server-mode" || key == "slow-consumer" || key == "log-fsync" || key == "compression" ||
+            key == "tcp-profile")
+        throw std::invalid_argument("Invalid value for " + key + ": " + value);
+    else if(key == "help")
+        show_help = true;
+    else
+        throw std::invalid_argument("Unknown option: " + key);
+
+    if(key == "compression" && compression.codec != Compression::Codec::None &&
+       !Compression::contains(Compression::available(), compression.codec))
+        throw std::invalid_argument("Compression codec not available in this build: " + value);
+}
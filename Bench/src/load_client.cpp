@@ -0,0 +1,251 @@
+#include "load_client.h"
+#include "message_record.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace
+{
+    // Body of the records: everyday chat words in a pseudo-random order, which
+    // compress about like real messages do, unlike a run of identical bytes.
+    std::string chatText(const std::size_t size, std::uint64_t seed)
+    {
+        static constexpr std::array<std::string_view, 32> WORDS = {
+            "the", "meeting", "is", "moved", "to", "room", "at", "three", "can", "you", "send", "me",
+            "latest", "build", "log", "please", "thanks", "I", "will", "check", "it", "after", "lunch",
+            "server", "looks", "fine", "now", "but", "tests", "failed", "again", "today"
+        };
+
+        std::string text;
+        text.reserve(size + 16);
+
+        while(text.size() < size)
+        {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            text += WORDS[(seed >> 33) % WORDS.size()];
+            text += ((seed >> 40) % 8 == 0) ? ". " : " ";
+        }
+
+        text.resize(size);
+        return text;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PRIVATE METHODS
+///
+void LoadClient::recv() noexcept
+{
+    try
+    {
+        m_socket.async_read_some(m_decoder.prepare(),
+                                 boost::asio::bind_executor(m_strand,
+                                     [self = shared_from_this()](const boost::system::error_code& ec,
+                                                                 const std::size_t bytes){
+            if(ec)
+                return;
+
+            self->m_decoder.commit(bytes);
+
+            const Clock::time_point now = Clock::now();
+            std::string_view payload;
+            MessageRecord record;
+
+            while(self->m_decoder.next(payload) == FrameDecoder::Status::Ok)
+            {
+                // The heartbeats, the Hello of the server and the files of --file-size are not
+                // part of the measured traffic.
+                if(!self->m_measuring.load(std::memory_order_relaxed) || !MessageRecord::decode(payload, record) ||
+                   record.type == MessageRecord::Type::Heartbeat || record.type == MessageRecord::Type::Hello ||
+                   record.type == MessageRecord::Type::FileOffer || record.type == MessageRecord::Type::FileChunk)
+                    continue;
+
+                // The bytes counted are the ones on the wire; the latency includes the decompression.
+                const std::size_t bytes = Frame::HEADER_SIZE + payload.size();
+
+                if(record.type == MessageRecord::Type::Compressed &&
+                   (!Compression::decompress(record, self->m_decompressed) ||
+                    !MessageRecord::decode(self->m_decompressed, record)))
+                    continue;
+
+                ++self->m_stats.received_messages;
+                self->m_stats.received_bytes += bytes;
+
+                if(const auto sent = sendTime(record.body))
+                    self->m_stats.latency.record(static_cast<std::uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(now - sent.value()).count()));
+            }
+
+            self->recv();
+        }));
+    }
+    catch(const std::exception&)
+    {
+    }
+}
+
+void LoadClient::tick() noexcept
+{
+    if(!m_running)
+        return;
+
+    // Records due since the start; if a write is still in flight they are
+    // written together with the following ones.
+    std::size_t count = MAX_BATCH;
+
+    if(m_rate > 0)
+    {
+        const double elapsed = std::chrono::duration<double>(Clock::now() - m_start).count();
+        const auto   target  = static_cast<std::uint64_t>(elapsed * m_rate);
+
+        count = static_cast<std::size_t>(std::min<std::uint64_t>(target - std::min(target, m_due), MAX_BATCH));
+    }
+
+    if(m_batch.empty() && count > 0)
+        this->write(count);
+
+    if(m_rate > 0 || m_batch.empty())
+    {
+        // With an unlimited rate the next write is started by the completion of this one.
+        Clock::duration interval = MIN_TICK;
+
+        if(m_rate > 0)
+            interval = std::max<Clock::duration>(interval, std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(1.0 / m_rate)));
+
+        m_timer.expires_after(interval);
+        m_timer.async_wait(boost::asio::bind_executor(m_strand,
+            [self = shared_from_this()](const boost::system::error_code& ec){
+                if(!ec)
+                    self->tick();
+            }));
+    }
+}
+
+void LoadClient::write(const std::size_t count) noexcept
+{
+    try
+    {
+        MessageRecord record;
+        record.type      = MessageRecord::Type::Chat;
+        record.timestamp = MessageRecord::now();
+        record.sender    = m_sender;
+
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            const std::int64_t now = Clock::now().time_since_epoch().count();
+            std::memcpy(m_body.data(), &now, TIMESTAMP_SIZE);
+
+            record.body = m_body;
+            m_batch.push_back(record.toFrame());
+
+            if(m_codec != Compression::Codec::None && m_batch.back().payload().size() >= m_threshold)
+            {
+                if(SharedFrame compressed = Compression::compress(m_batch.back().payload(), m_codec))
+                    m_batch.back() = std::move(compressed);
+            }
+
+            m_buffers.push_back(m_batch.back().buffer());
+        }
+
+        m_due += count;
+
+        if(m_measuring.load(std::memory_order_relaxed))
+            m_stats.sent_messages += count;
+
+        boost::asio::async_write(m_socket, m_buffers, boost::asio::bind_executor(m_strand,
+            [self = shared_from_this()](const boost::system::error_code& ec, const std::size_t){
+                self->m_batch.clear();
+                self->m_buffers.clear();
+
+                if(!ec && self->m_rate <= 0)
+                    self->tick();
+            }));
+    }
+    catch(const std::exception&)
+    {
+        m_batch.clear();
+        m_buffers.clear();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+LoadClient::LoadClient(boost::asio::io_context& io_cntxt, const std::size_t index, const std::size_t body_size,
+                       const double rate, const Compression::Codec codec, const std::size_t threshold,
+                       const std::atomic<bool>& measuring)
+    : m_strand(boost::asio::make_strand(io_cntxt)),
+      m_socket(m_strand),
+      m_timer(m_strand),
+      m_sender("bench-" + std::to_string(index)),
+      m_body(chatText(std::max(body_size, TIMESTAMP_SIZE), index)),
+      m_rate(rate),
+      m_codec(codec),
+      m_threshold(threshold),
+      m_due(0),
+      m_measuring(measuring),
+      m_running(false)
+{
+    m_batch.reserve(MAX_BATCH);
+    m_buffers.reserve(MAX_BATCH);
+}
+
+void LoadClient::connect(const boost::asio::ip::tcp::endpoint& endpoint, const SocketTuning& tuning)
+{
+    boost::system::error_code ec;
+
+    m_socket.open(endpoint.protocol());
+    tuning.apply(m_socket, ec);
+    m_socket.connect(endpoint);
+
+    if(m_codec != Compression::Codec::None)
+    {
+        MessageRecord hello;
+        hello.type = MessageRecord::Type::Hello;
+        hello.body = Compression::name(m_codec);
+
+        boost::asio::write(m_socket, hello.toFrame().buffer());
+    }
+}
+
+void LoadClient::start() noexcept
+{
+    m_running = true;
+
+    boost::asio::post(m_strand, [self = shared_from_this()](){
+        self->m_start = Clock::now();
+        self->recv();
+        self->tick();
+    });
+}
+
+void LoadClient::stop() noexcept
+{
+    m_running = false;
+
+    boost::asio::post(m_strand, [self = shared_from_this()](){
+        boost::system::error_code ec;
+
+        self->m_timer.cancel();
+        self->m_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+        self->m_socket.close(ec);
+    });
+}
+
+const LoadClient::Stats& LoadClient::stats() const noexcept
+{
+    return m_stats;
+}
+
+std::optional<LoadClient::Clock::time_point> LoadClient::sendTime(std::string_view body) noexcept
+{
+    if(body.size() < TIMESTAMP_SIZE)
+        return std::nullopt;
+
+    std::int64_t ticks = 0;
+    std::memcpy(&ticks, body.data(), TIMESTAMP_SIZE);
+
+    return Clock::time_point(Clock::duration(ticks));
+}
@@ -5,84 +5,304 @@
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
 
-#include <QDebug>
-#include <QObject>
+#include "channel.h"
+#include "compression.h"
+#include "file_transfer.h"
+#include "frame.h"
+#include "message_record.h"
+#include "socket_tuning.h"
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
 #include <vector>
 #include <memory>
 #include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
 
 /**
  * @class Client
  * @brief This class manages a TCP client for communication with a server.
  *        It provides methods for connecting to the server, sending/receiving messages,
  *        and managing the client lifecycle.
+ *
+ * The client does not depend on Qt: events are reported through the callbacks set
+ * with setCallbacks(), which are called from the worker threads. The GUI uses it
+ * through ClientAdapter.
+ *
+ * When an established connection drops, the client reconnects by itself. It waits
+ * a random time up to a ceiling that doubles after every failed attempt (from
+ * RECONNECT_MIN_DELAY to RECONNECT_MAX_DELAY), so the clients dropped together by
+ * a server restart come back spread out. Once reconnected it sends a History
+ * request for the messages after the last sequence it received, and drops the
+ * copies of a message that arrive both live and with the replay. The first
+ * connection is tried once, so that a wrong address is reported at once.
+ *
+ * A connection can also die without being closed (the server host lost power, a
+ * NAT dropped the flow), and then nothing tells the reads. The client sends a
+ * Heartbeat record after HEARTBEAT_INTERVAL without sending anything, so the
+ * server keeps it, and treats the connection as dropped after IDLE_TIMEOUT
+ * without receiving anything; the server sends heartbeats to quiet clients.
+ *
+ * Every connection starts with a Hello record listing the compression codecs of
+ * the client. The server answers with its own, and from then on the messages of
+ * at least Compression::DEFAULT_THRESHOLD bytes are sent compressed with the
+ * preferred codec of both. Compressed messages from the server are decompressed
+ * before they are reported, so the callback always gets the original.
+ *
+ * The frames are written one write at a time, from a queue on the strand. Files
+ * are sent in chunks of FileTransfer::CHUNK_SIZE bytes, read from the disk only
+ * when the queue is empty and the previous chunk is written, so a chat message
+ * typed during a transfer waits for one chunk at most. Received files are written
+ * to the download directory, if one is set.
  */
-class Client : public QObject
+class Client
 {
-    Q_OBJECT // For the use of signals.
+public:
+    /**
+     * @struct Callbacks
+     * @brief Events reported by the client. They are called from the worker threads
+     *        and must be set before connect().
+     */
+    struct Callbacks
+    {
+        /// Called for every message received from the server; the view is valid only during the call.
+        std::function<void(std::string_view)>   message_received;
+        /// Called to report the connection status.
+        std::function<void(const char*)>        connection_status;
+        /// Called when a file has been received completely, with the path it was saved to.
+        std::function<void(const std::string&)> file_received;
+    };
 
 private: // Fields
-    static constexpr unsigned short THREAD_NR   = 2;              ///< Number of worker threads.
+    static constexpr unsigned short            THREAD_NR           = 2;        ///< Number of worker threads.
+    static constexpr std::chrono::milliseconds RECONNECT_MIN_DELAY{250};       ///< Backoff ceiling of the first attempt.
+    static constexpr std::chrono::milliseconds RECONNECT_MAX_DELAY{30000};     ///< Largest backoff ceiling.
+    static constexpr std::chrono::milliseconds HEARTBEAT_INTERVAL{10000};      ///< Silence after which a heartbeat is sent.
+    static constexpr std::chrono::milliseconds IDLE_TIMEOUT{30000};            ///< Silence of the server that drops the link.
+    static constexpr std::chrono::milliseconds HEARTBEAT_CHECK{1000};          ///< How often both are checked.
+
+    /**
+     * @struct Upload
+     * @brief A file being sent.
+     */
+    struct Upload
+    {
+        std::unique_ptr<std::FILE, int(*)(std::FILE*)> file{nullptr, std::fclose};   ///< The file, open for reading.
+        std::uint64_t                                  id   = 0;   ///< Id of the transfer.
+        std::uint64_t                                  size = 0;   ///< Size of the file.
+        std::uint64_t                                  sent = 0;   ///< Bytes read into chunks so far.
+        std::string                                    channel;    ///< Where the file goes, empty for everyone.
+    };
+
+    /**
+     * @struct Download
+     * @brief A file being received.
+     */
+    struct Download
+    {
+        std::unique_ptr<std::FILE, int(*)(std::FILE*)> file{nullptr, std::fclose};   ///< The partial file.
+        std::string                                    name;           ///< Name of the file, made safe.
+        std::uint64_t                                  size     = 0;   ///< Size announced by the offer.
+        std::uint64_t                                  received = 0;   ///< Bytes written so far.
+    };
 
     std::unique_ptr<boost::asio::io_context>        m_io_cntxt;   ///< IO context for asynchronous operations.
     std::unique_ptr<boost::asio::io_context::work>  m_work;       ///< Keeps the IO context alive.
     std::unique_ptr<boost::asio::ip::tcp::socket>   m_sckt;       ///< TCP socket for communication.
+    /// Waits between two reconnect attempts. Its strand runs the connect and read coroutines.
+    std::unique_ptr<boost::asio::steady_timer>      m_retryTimer;
+    std::unique_ptr<boost::asio::steady_timer>      m_heartbeatTimer; ///< Paces the heartbeat checks (same strand).
 
     // It is passed by signal, therefore it must have a copy constructor
     std::shared_ptr<boost::asio::ip::tcp::endpoint> m_endpoint;   ///< Server endpoint.
+    SocketTuning                                    m_socketTuning; ///< TCP options of the socket.
 
     boost::thread_group              m_threads;                   ///< Thread group for worker threads.
 
-    std::vector<boost::uint8_t>      m_received_buffer;           ///< Buffer for received data.
-    std::vector<boost::uint8_t>      m_send_buffer;               ///< Buffer for data to send.
+    FrameDecoder                     m_decoder;                   ///< Receive buffer, split into frames.
 
     std::optional<std::atomic<bool>> m_clientStatus;              ///< Indicates if the client is connected.
 
+    Callbacks                        m_callbacks;                 ///< Event callbacks.
+
+    std::atomic<std::chrono::steady_clock::rep> m_lastSend;       ///< When a frame was last sent (any thread).
+    std::chrono::steady_clock::time_point       m_lastReceive;    ///< When bytes were last received (strand only).
+    bool                                        m_linkUp;         ///< False while reconnecting (strand only).
+
+    std::atomic<Compression::CodecSet>          m_serverCodecs;   ///< Codecs the server decodes, from its Hello.
+    std::string                                 m_decompressed;   ///< The last decompressed message (strand only).
+
+    // Write queue and file transfers, only touched on the strand of m_retryTimer.
+    std::deque<SharedFrame>                     m_writeQueue;     ///< Frames waiting to be written, oldest first.
+    std::vector<boost::asio::const_buffer>      m_writeBuffers;   ///< Buffer sequence of the write in flight.
+    std::size_t                                 m_writeBatch;     ///< Frames of m_writeQueue in the write in flight.
+    SharedFrame                                 m_chunk;          ///< File chunk in flight, if any.
+    bool                                        m_writing;        ///< True while a write is in flight.
+    std::deque<Upload>                          m_uploads;        ///< Files to send; the first one is being sent.
+    std::map<std::uint64_t, Download>           m_downloads;      ///< Files being received, by transfer id.
+    std::string                                 m_downloadDir;    ///< Where the files are saved; empty to ignore them.
+
+    // Resume state, only touched on the strand of m_retryTimer.
+    std::mt19937_64                  m_random;                    ///< Draws the reconnect delays.
+    std::uint64_t                    m_lastSequence;              ///< Highest logged sequence received, 0 if none.
+    std::uint64_t                    m_resumeFrom;                ///< Sequence of the last History request.
+    std::uint64_t                    m_resumeUntil;               ///< Last sequence of its replay.
+    bool                             m_resuming;                  ///< Set until the end of the replay arrives.
+    std::set<std::uint64_t>          m_resumed;                   ///< Sequences above m_resumeFrom received while resuming.
+    std::set<std::string>            m_channels;                  ///< Channels joined, joined again on every connection.
+
 private:
     /**
-     * @brief Handles connection result.
-     * @param ec The error code resulting from the connection attempt.
+     * @brief connectTo Connects the socket and reports the result.
+     * @param endpoint The server endpoint; the coroutine keeps it alive.
      */
-    void onConnect(const boost::system::error_code& ec)                   noexcept;
+    boost::asio::awaitable<void> connectTo(std::shared_ptr<boost::asio::ip::tcp::endpoint> endpoint);
     /**
      * @brief Executes worker threads to process IO context tasks.
      */
     void workerThread()                                                   noexcept;
     /**
-     * @brief Handles completion of a send operation.
+     * @brief Handles completion of a send operation: removes what was written and
+     *        starts the next write. A batch that failed stays at the front of the
+     *        queue, to be sent again on the next connection. Runs on the strand.
      * @param ec The error code from the operation.
-     * @param n_bytes The number of bytes sent.
+     * @param n_bytes The number of bytes sent (unused: a write completes whole or fails).
      */
     void onSend(const boost::system::error_code& ec, std::size_t n_bytes) noexcept;
     /**
-     * @brief Handles completion of a receive operation.
-     * @param ec The error code from the operation.
-     * @param bytes The number of bytes received.
+     * @brief writeNext Starts the next write unless one is in flight or the link is
+     *        down: all the queued frames in one gathered write or, if none is queued,
+     *        the next chunk of the file being sent. Runs on the strand.
      */
-    void onRecv(const boost::system::error_code& ec, const size_t bytes)  noexcept;
-
-
-signals:
+    void writeNext()                                                      noexcept;
     /**
-     * @brief message_received It is emitted when the client receives a message from the server.
-     * @param message Message received
+     * @brief sendHeld Queues the frames held while the link was down behind the
+     *        records that open the new connection (Hello, joins, History request),
+     *        and starts writing. Runs on the strand.
+     * @param held The frames, oldest first.
      */
-    void message_received(const std::string& message);
+    void sendHeld(std::deque<SharedFrame> held)                           noexcept;
     /**
-     * @brief Emitted to inform about the connection status.
+     * @brief nextChunk Reads the next chunk of the file being sent directly into a frame.
+     * @return The frame of the chunk.
+     * @throws std::runtime_error If the file cannot be read.
+     */
+    SharedFrame nextChunk();
+    /**
+     * @brief receiveFile Handles a FileOffer or a FileChunk record from the server:
+     *        starts, continues or completes a download. Runs on the strand.
+     * @param record The record.
+     */
+    void receiveFile(const MessageRecord& record)                         noexcept;
+    /**
+     * @brief saveFile Closes a complete download and gives it its name in the
+     *        download directory, with a number if the name is taken. Runs on the strand.
+     * @param id The id of its transfer.
+     */
+    void saveFile(const std::uint64_t id);
+    /**
+     * @brief abortTransfers Drops the files being sent and received, when the
+     *        connection they were using is gone. Runs on the strand.
+     */
+    void abortTransfers()                                                 noexcept;
+    /**
+     * @brief readLoop Reads the server stream and reconnects whenever the connection
+     *        drops, until it is closed.
+     */
+    boost::asio::awaitable<void> readLoop();
+    /**
+     * @brief readStream Reads the server stream and reports every new message.
+     * @return True if the connection dropped, false if it was closed or the stream is invalid.
+     */
+    boost::asio::awaitable<bool> readStream();
+    /**
+     * @brief reconnect Connects the socket again, with a jittered exponential backoff,
+     *        and asks for the messages missed in the meantime.
+     * @return True once connected, false if the connection was closed in the meantime.
+     */
+    boost::asio::awaitable<bool> reconnect();
+    /**
+     * @brief heartbeatLoop Sends the heartbeats and drops a connection on which
+     *        nothing arrives, until the client is closed.
+     */
+    boost::asio::awaitable<void> heartbeatLoop();
+    /**
+     * @brief hello Sends the Hello record that starts a connection, and forgets the
+     *        codecs of the previous one until the server answers.
+     */
+    void hello()                                                          noexcept;
+    /**
+     * @brief openSocket Opens the socket afresh for a connect attempt and sets its
+     *        TCP options, so that its buffers are sized before the handshake.
+     * @param endpoint The server; only its protocol is used.
+     */
+    void openSocket(const boost::asio::ip::tcp::endpoint& endpoint)       noexcept;
+    /**
+     * @brief resume Sends a History request for the messages after m_lastSequence.
+     */
+    void resume()                                                         noexcept;
+    /**
+     * @brief rejoin Joins m_channels on a new connection, before the History request,
+     *        so that the replay includes their messages. Runs on the strand.
+     */
+    void rejoin()                                                         noexcept;
+    /**
+     * @brief subscription Queues a Join or Leave record for a channel, and updates
+     *        m_channels on the strand.
+     * @return False if the name is not a valid channel.
+     */
+    bool subscription(const MessageRecord::Type type, const std::string& channel) noexcept;
+    /**
+     * @brief isNew Tracks the sequence of a received message and filters the
+     *        messages that are not for the callback: heartbeats, the server's Hello,
+     *        the records of the file transfers (handed to receiveFile()), the
+     *        refusal of a Join (whose channel leaves m_channels), the end of a
+     *        replay, and the second copy of a message received both live and
+     *        replayed.
+     * @param payload The frame payload.
+     * @return True if the message is to be reported.
+     */
+    bool isNew(std::string_view payload)                                  noexcept;
+    /**
+     * @brief decompress Replaces a Compressed record by the original.
+     * @param payload The frame payload; if compressed, it is made to point to the
+     *        original, valid until the next call.
+     * @return False if the record could not be decompressed.
+     */
+    bool decompress(std::string_view& payload)                            noexcept;
+    /**
+     * @brief compress Compresses a large frame with the preferred codec of the server.
+     * @param frame The frame of a record.
+     * @return The compressed frame, or the frame itself if it is small, the server
+     *         decodes no common codec, or compression does not make it smaller.
+     */
+    SharedFrame compress(SharedFrame frame)                         const;
+    /**
+     * @brief sendFrame Queues an encoded frame for writing. Can be called from any thread.
+     * @param frame The frame; the queue keeps a reference to it until it is written.
+     */
+    void sendFrame(const SharedFrame& frame)                              noexcept;
+    /**
+     * @brief notifyStatus Calls the connection_status callback, if any.
      * @param status The connection status message.
      */
-    void connectionStatus(const char* status);
+    void notifyStatus(const char* status)                                 noexcept;
 
 
 public:
     /**
      * @brief Constructs a Client instance.
-     * @param parent The parent QObject.
      */
-    Client(QObject* parent = nullptr);
+    Client();
     /**
      * @brief Destructor for the Client.
      */
@@ -92,6 +312,11 @@ public:
      * @return An optional boolean indicating the client status.
      */
     const std::optional<std::atomic<bool>>& is_working() const       noexcept;
+    /**
+     * @brief setCallbacks Sets the event callbacks. Must be called before connect().
+     * @param callbacks The callbacks; empty ones are ignored.
+     */
+    void setCallbacks(Callbacks callbacks)                           noexcept;
     /**
      * @brief Initiates a connection to a server.
      * @param ip_address The server IP address.
@@ -99,10 +324,65 @@ public:
      */
     void connect(const char* ip_address, const unsigned port)        noexcept;
     /**
-     * @brief Sends data to the server.
-     * @param send_buffer The data buffer to send.
+     * @brief Sends a chat message to the server. The record is serialized directly
+     *        into the frame.
+     * @param record The message.
+     */
+    void send(const MessageRecord& record)                           noexcept;
+    /**
+     * @brief join Receives the messages of a channel (see Channel) from now on; the
+     *        channel is joined again after every reconnect. A message is sent to a
+     *        channel by setting the channel of its record.
+     * @param channel "#room", or "@nickname" for the direct messages to a nickname.
+     * @return False if the name is not a valid channel.
+     */
+    bool join(const std::string& channel)                            noexcept;
+    /**
+     * @brief leave Stops receiving the messages of a channel.
+     * @param channel The channel.
+     * @return False if the name is not a valid channel.
+     */
+    bool leave(const std::string& channel)                           noexcept;
+    /**
+     * @brief sendFile Sends a file to the server, which relays it to the other
+     *        clients and, if it stores files, keeps it. The chunks are read while
+     *        they are sent, behind the chat messages.
+     * @param path Path of the file.
+     * @param sender Nickname of the sender, written in the offer.
+     * @param channel "#room" or "@nickname" to send the file to that channel only,
+     *        empty for everyone.
+     * @return The id of the transfer, with which a client can fetch the file from a
+     *         server that stores it; 0 if the file cannot be read.
+     */
+    std::uint64_t sendFile(const std::string& path, std::string_view sender,
+                           const std::string& channel = {})                  noexcept;
+    /**
+     * @brief requestHistory Asks the server for the last messages of its log, those of
+     *        the everyone channel and of the channels joined. They arrive like the live
+     *        ones, oldest first; a message also relayed live meanwhile is reported
+     *        once. Meant for a connection that has shown nothing yet: the messages
+     *        already received may come again.
+     * @param count How many, 0 for as many as the server replays.
+     */
+    void requestHistory(const std::size_t count)                     noexcept;
+    /**
+     * @brief requestFile Asks the server for a file it stores; the file arrives like
+     *        a relayed one.
+     * @param id The id of its transfer.
+     */
+    void requestFile(const std::uint64_t id)                         noexcept;
+    /**
+     * @brief setDownloadDirectory Sets where the received files are saved (created if
+     *        needed). Without one, they are ignored. Must be called before connect().
+     * @param directory The directory.
+     */
+    void setDownloadDirectory(const std::string& directory)          noexcept;
+    /**
+     * @brief setSocketTuning Sets the TCP options of the connection ("low-latency"
+     *        by default). Must be called before connect().
+     * @param tuning The options.
      */
-    void send(const std::vector<boost::uint8_t>& send_buffer)        noexcept;
+    void setSocketTuning(const SocketTuning& tuning)                 noexcept;
     /**
      * @brief Starts receiving data from the server.
      */
@@ -0,0 +1,116 @@
+#ifndef CLIENT_ADAPTER_H
+#define CLIENT_ADAPTER_H
+
+#include <QObject>
+#include <QList>
+#include <QString>
+
+#include "client.h"
+#include "chat_log_model.h"
+#include "message_inbox.h"
+
+#include <memory>
+#include <string>
+
+
+/**
+ * @class ClientAdapter
+ * @brief Thin Qt layer over the Qt-free Client.
+ *
+ * It turns the client callbacks into Qt signals, which are delivered to the
+ * GUI thread through queued connections. Received messages are queued in a
+ * MessageInbox and handed to the GUI in batches, see ServerAdapter.
+ */
+class ClientAdapter : public QObject
+{
+    Q_OBJECT // For the use of signals.
+
+private: // Fields
+    static constexpr std::size_t MAX_DRAIN_BATCH = 1024;   ///< Messages handed to the GUI per event-loop iteration.
+
+    std::unique_ptr<Client>       m_client;   ///< The networking core.
+    std::unique_ptr<MessageInbox> m_inbox;    ///< Received messages, waiting for the GUI thread.
+
+private: // Methods
+    /**
+     * @brief drainMessages Runs on the GUI thread; decodes the queued records and emits
+     *        them as one batch. Payloads that are not valid records are skipped.
+     */
+    void drainMessages() noexcept;
+
+signals:
+    /**
+     * @brief messages_received It is emitted on the GUI thread with the messages received
+     *        from the server since the previous emission.
+     * @param messages Messages received, oldest first.
+     */
+    void messages_received(const QList<ChatMessage>& messages);
+    /**
+     * @brief Emitted to inform about the connection status.
+     * @param status The connection status message.
+     */
+    void connectionStatus(const QString& status);
+    /**
+     * @brief fileReceived Emitted when a file has been received and saved.
+     * @param path Where it was saved.
+     */
+    void fileReceived(const QString& path);
+
+public:
+    /**
+     * @brief Constructs the adapter and the client it wraps.
+     * @param parent The parent QObject.
+     */
+    ClientAdapter(QObject* parent = nullptr);
+    /**
+     * @brief Destructor. Shuts the client down.
+     */
+    ~ClientAdapter();
+    /**
+     * @brief is_working See Client::is_working.
+     */
+    const std::optional<std::atomic<bool>>& is_working() const       noexcept;
+    /**
+     * @brief connect See Client::connect.
+     */
+    void connect(const char* ip_address, const unsigned port)        noexcept;
+    /**
+     * @brief send See Client::send.
+     */
+    void send(const MessageRecord& record)                           noexcept;
+    /**
+     * @brief join See Client::join.
+     */
+    bool join(const std::string& channel)                            noexcept;
+    /**
+     * @brief leave See Client::leave.
+     */
+    bool leave(const std::string& channel)                           noexcept;
+    /**
+     * @brief sendFile See Client::sendFile.
+     */
+    std::uint64_t sendFile(const std::string& path, std::string_view sender,
+                           const std::string& channel = {})                  noexcept;
+    /**
+     * @brief requestHistory See Client::requestHistory.
+     */
+    void requestHistory(const std::size_t count)                     noexcept;
+    /**
+     * @brief setDownloadDirectory See Client::setDownloadDirectory.
+     */
+    void setDownloadDirectory(const std::string& directory)          noexcept;
+    /**
+     * @brief recv See Client::recv.
+     */
+    void recv()                                                      noexcept;
+    /**
+     * @brief closeConnection See Client::closeConnection.
+     */
+    void closeConnection()                                           noexcept;
+    /**
+     * @brief finish See Client::finish.
+     */
+    void finish()                                                    noexcept;
+};
+
+#endif // CLIENT_ADAPTER_H
@@ -1,8 +1,6 @@
 #ifndef CLIENT_CMAINWINDOW_H
 #define CLIENT_CMAINWINDOW_H
 
-#include <QScrollArea>
-#include <QScrollBar>
 #include <QMainWindow>
 #include <QPalette>
 #include <QApplication>
@@ -14,7 +12,9 @@
 #include <QLabel>
 #include <QString>
 
-#include "client.h"
+#include "chat_log_model.h"
+#include "chat_log_view.h"
+#include "client_adapter.h"
 
 
 /**
@@ -31,6 +31,7 @@ class CMainWindow : public QMainWindow
 public:
 
     static inline const char* WINDOWNAME = "Client LANChat";
+    static constexpr std::size_t HISTORY_SIZE = 100;   ///< Logged messages shown when connecting.
 
 private:
     // Fields
@@ -43,13 +44,14 @@ private:
     QAction*        m_quitAction            {nullptr};
     QAction*        m_connectAction         {nullptr};
     QAction*        m_clearMessagesAction   {nullptr};
+    QAction*        m_sendFileAction        {nullptr};
 
     QLabel*         m_welcomeLabel          {nullptr};
     QLabel*         m_connectionStatusLabel {nullptr};
-    QLabel*         m_messagesLabel         {nullptr};
+    ChatLogView*    m_messagesView          {nullptr};
+    ChatLogModel*   m_messagesModel         {nullptr};
 
-    QScrollArea*    m_messagesLabelScroll   {nullptr};
-    QHBoxLayout*    m_messagesLabelLayout   {nullptr};
+    QHBoxLayout*    m_messagesLayout        {nullptr};
 
     QLineEdit*      m_userInputLEdit        {nullptr};
 
@@ -68,12 +70,9 @@ private:
     std::string                        m_serverPort;
     std::string                        m_serverIPaddress;
 
-    Client*                            m_client;
+    ClientAdapter*                     m_client;
     std::unique_ptr<boost::thread>     m_clientThread;
 
-    std::vector<boost::uint8_t>        m_send_buffer;
-
-    boost::mutex                       m_messageLabelMutex;
 
     bool                               m_hasEverConnected;
 
@@ -118,17 +117,17 @@ private:
      *        It is called in the addServerInfo and onConnection methods.
      * @param status Connection status message.
      */
-    void addStatusLable(const char* status);
+    void addStatusLable(const QString& status);
     /**
      * @brief Initializes the widgets to be able to read data from the user.
      *        It is called in the onConnection method.
      */
     void addUserInput();
     /**
-     * @brief Adds a label for messages.
+     * @brief Adds the view of the message history.
      *        It is called in the onConnection method.
      */
-    void addMessagesLabel();
+    void addMessagesView();
     /**
      * @brief Starts the connection to the server by calling the Client::connect method
      *        in a temporary thread.
@@ -141,12 +140,17 @@ private:
      *        It is called when the connectButton button is pressed.
      * @param status Connection status message.
      */
-    void onConnection(const char* status);
+    void onConnection(const QString& status);
     /**
-     * @brief displayMessage Display messages in messageLabel.
+     * @brief displayMessage Appends a message to the message history.
      * @param message The message to display.
      */
-    void displayMessage(const std::string& message);
+    void displayMessage(const ChatMessage& message);
+    /**
+     * @brief displayMessages Appends a batch of messages to the message history.
+     * @param messages The messages to display.
+     */
+    void displayMessages(const QList<ChatMessage>& messages);
     /**
      * @brief cleanup Freeing memory allocated that was not freed through the parent-child relationship.
      */
@@ -165,16 +169,27 @@ private slots:
      *        It is connected to the Client::connectionStatus signal.
      * @param status Connection status given by the client object.
      */
-    void setConnectionStatus(const char* status);
+    void setConnectionStatus(const QString& status);
     /**
      * @brief Calls the Client::send method with the argument being the text from userInputLine.
      *        It is called when the sendButton is clicked.
      */
     void sendingMessages();
     /**
-     * @brief Deleting messages from messageLabel
+     * @brief Deleting messages from the message history
      */
     void clearMessages();
+    /**
+     * @brief Asks for a file and sends it to the server.
+     *        It is called when the Send File action in the Connection menu is clicked.
+     */
+    void sendFile();
+    /**
+     * @brief Adds a line about a received file to the message history.
+     *        It is connected to the ClientAdapter::fileReceived signal.
+     * @param path Where the file was saved.
+     */
+    void onFileReceived(const QString& path);
 
 protected:
     /**
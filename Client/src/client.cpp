@@ -1,15 +1,39 @@
 #include "client.h"
 
+#include <filesystem>
 
-Client::Client(QObject* parent) : QObject(parent),
-                                  m_endpoint(nullptr),
-                                  m_clientStatus(std::nullopt)
+namespace
+{
+    // Where a file is written while it is received: hidden, and named after its
+    // transfer, so that two files with the same name never collide.
+    std::string partPath(const std::string& directory, const std::uint64_t id)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), ".%016llx.part", static_cast<unsigned long long>(id));
+
+        return (std::filesystem::path(directory) / name).string();
+    }
+}
+
+Client::Client() : m_endpoint(nullptr),
+                   m_socketTuning(SocketTuning::lowLatency()),
+                   m_clientStatus(std::nullopt),
+                   m_lastSend(0),
+                   m_linkUp(false),
+                   m_serverCodecs(0),
+                   m_writeBatch(0),
+                   m_writing(false),
+                   m_random(std::random_device{}()),
+                   m_lastSequence(0),
+                   m_resumeFrom(0),
+                   m_resumeUntil(0),
+                   m_resuming(false)
 {
     m_io_cntxt   = std::make_unique<boost::asio::io_context>();
     m_work       = std::make_unique<boost::asio::io_service::work>(*m_io_cntxt);
     m_sckt       = std::make_unique<boost::asio::ip::tcp::socket>(*m_io_cntxt);
-
-    m_received_buffer.resize(4096);
+    m_retryTimer = std::make_unique<boost::asio::steady_timer>(boost::asio::make_strand(*m_io_cntxt));
+    m_heartbeatTimer = std::make_unique<boost::asio::steady_timer>(m_retryTimer->get_executor());
 
     for(short i = 0; i < THREAD_NR; ++i)
         m_threads.create_thread(boost::bind(&Client::workerThread, this));
@@ -27,13 +51,13 @@ void Client::workerThread() noexcept
 
             if(ec)
             {
-                emit this->connectionStatus("Error workerThread");
+                this->notifyStatus("Error workerThread");
             }
             break;
         }
         catch(const std::exception& e)
         {
-            emit this->connectionStatus("Exception workerThread");
+            this->notifyStatus("Exception workerThread");
         }
     }
 }
@@ -51,119 +75,971 @@ const std::optional<std::atomic<bool>> &Client::is_working() const noexcept
     return m_clientStatus;
 }
 
+void Client::setCallbacks(Callbacks callbacks) noexcept
+{
+    m_callbacks = std::move(callbacks);
+}
+
+void Client::notifyStatus(const char* status) noexcept
+{
+    if(m_callbacks.connection_status)
+        m_callbacks.connection_status(status);
+}
+
 void Client::connect(const char* ip_address, const unsigned port) noexcept
 {
     try
     {
+        // Bytes left over from a previous connection do not belong to the new stream.
+        m_decoder.reset();
+
         m_endpoint = std::make_shared<boost::asio::ip::tcp::endpoint>(
                 boost::asio::ip::make_address(ip_address), port
             );
 
-        m_sckt->async_connect(*m_endpoint,
-                              boost::bind(&Client::onConnect,
-                                          this,
-                                          boost::asio::placeholders::error
-                                          )
-                             );
+        boost::asio::co_spawn(m_retryTimer->get_executor(), this->connectTo(m_endpoint), boost::asio::detached);
     }
     catch (const std::exception& e)
     {
-        emit this->connectionStatus("  Connection failed (exception)!");
+        this->notifyStatus("  Connection failed (exception)!");
     }
 }
 
-void Client::onConnect(const boost::system::error_code &ec) noexcept
+boost::asio::awaitable<void> Client::connectTo(std::shared_ptr<boost::asio::ip::tcp::endpoint> endpoint)
 {
+    boost::system::error_code ec;
+
+    this->openSocket(*endpoint);
+    co_await m_sckt->async_connect(*endpoint, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
     if(ec)
     {
-        emit this->connectionStatus("  Connection failed (error)!");
+        this->notifyStatus("  Connection failed (error)!");
     }
     else
     {
+        // A new connection, maybe to another server: nothing to resume yet.
+        m_lastSequence = 0;
+        m_resuming     = false;
+        m_resumeFrom   = 0;
+        m_resumeUntil  = 0;
+        m_resumed.clear();
+
+        // The frames sent before the connection wait behind its first records.
+        std::deque<SharedFrame> held;
+        held.swap(m_writeQueue);
+
+        m_lastReceive = std::chrono::steady_clock::now();
+        m_linkUp      = true;
+
         m_clientStatus = true;
-        emit this->connectionStatus("  Connected!");
+        this->hello();
+        this->rejoin();
+        this->sendHeld(std::move(held));
+        this->notifyStatus("  Connected!");
     }
 }
 
 
-void Client::send(const std::vector<boost::uint8_t>& send_buffer) noexcept
+void Client::send(const MessageRecord& record) noexcept
 {
     try
     {
-        boost::asio::async_write(*m_sckt, boost::asio::buffer(send_buffer),
-                                 [this](const boost::system::error_code& ec, const std::size_t bytes){
-                                     if(ec)
-                                     {
-                                         emit this->connectionStatus("An error occurred while transmitting data.");
-                                     }
-                                 });
+        this->sendFrame(this->compress(record.toFrame()));
     }
     catch (const std::exception& e)
     {
-        emit this->connectionStatus(e.what());
+        this->notifyStatus(e.what());
     }
+}
 
+
+SharedFrame Client::compress(SharedFrame frame) const
+{
+    const Compression::Codec codec =
+        Compression::preferred(m_serverCodecs.load(std::memory_order_relaxed) & Compression::available());
+
+    if(codec == Compression::Codec::None || frame.payload().size() < Compression::DEFAULT_THRESHOLD)
+        return frame;
+
+    SharedFrame compressed = Compression::compress(frame.payload(), codec);
+
+    return compressed ? compressed : frame;
 }
 
 
-void Client::recv() noexcept
+void Client::sendFrame(const SharedFrame& frame) noexcept
 {
     try
     {
-        if(m_clientStatus.has_value() && m_clientStatus.value())
-            m_sckt->async_read_some(boost::asio::buffer(m_received_buffer, m_received_buffer.size()),
-                                  boost::bind(&Client::onRecv,
-                                              this,
-                                              boost::asio::placeholders::error,
-                                              boost::asio::placeholders::bytes_transferred
-                                              )
-                                  );
+        m_lastSend.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+
+        // The frame is queued on the strand, which starts one write at a time: two
+        // frames sent from different threads can never interleave on the socket.
+        boost::asio::post(m_retryTimer->get_executor(), [this, frame](){
+            try
+            {
+                m_writeQueue.push_back(frame);
+                this->writeNext();
+            }
+            catch (const std::exception& e)
+            {
+                this->notifyStatus(e.what());
+            }
+        });
     }
-    catch(const std::exception& e)
+    catch (const std::exception& e)
     {
-        if(m_clientStatus.has_value() && m_clientStatus.value())
-            emit this->connectionStatus(e.what());
+        this->notifyStatus(e.what());
+    }
+}
+
+
+void Client::writeNext() noexcept
+{
+    // While the link is down the frames only queue up; the connection sends them.
+    if(m_writing || !m_linkUp)
+        return;
+
+    try
+    {
+        m_writeBuffers.clear();
+
+        if(!m_writeQueue.empty())
+        {
+            // Everything queued so far leaves in a single gathered write.
+            m_writeBatch = m_writeQueue.size();
+
+            for(const SharedFrame& frame : m_writeQueue)
+                m_writeBuffers.push_back(frame.buffer());
+        }
+        else
+        {
+            // The next chunk is only read once nothing else waits; a file that cannot
+            // be read is dropped, and the next one is tried.
+            while(!m_chunk && !m_uploads.empty())
+                m_chunk = this->nextChunk();
+
+            if(!m_chunk)
+                return;
+
+            m_writeBuffers.push_back(m_chunk.buffer());
+        }
+
+        // The queue and m_chunk hold the frames until the write completes.
+        boost::asio::async_write(*m_sckt, m_writeBuffers,
+                                 boost::asio::bind_executor(m_retryTimer->get_executor(),
+                                     [this](const boost::system::error_code& ec, const std::size_t bytes){
+                                         this->onSend(ec, bytes);
+                                     }));
+        m_writing = true;
+    }
+    catch (const std::exception& e)
+    {
+        this->notifyStatus(e.what());
     }
 }
 
-void Client::onRecv(const boost::system::error_code& ec, const size_t bytes)   noexcept
+
+void Client::onSend(const boost::system::error_code& ec, std::size_t /* n_bytes */) noexcept
 {
+    m_writing = false;
+
     if(ec)
     {
+        m_chunk      = SharedFrame();
+        m_writeBatch = 0;
+
+        // The files cannot continue on another connection. The failed batch stays at
+        // the front of the queue and, with the frames queued in the meantime, goes out
+        // once the client is connected again, unless it was closed.
+        this->abortTransfers();
+
         if(m_clientStatus.has_value() && m_clientStatus.value())
-            emit this->connectionStatus("Async_read_some error!");
+            this->notifyStatus("An error occurred while transmitting data.");
+        else
+            m_writeQueue.clear();
 
         return;
     }
 
-    std::string received_message(m_received_buffer.begin(), m_received_buffer.begin() + bytes);
+    m_writeQueue.erase(m_writeQueue.begin(), m_writeQueue.begin() + static_cast<std::ptrdiff_t>(m_writeBatch));
+    m_writeBatch = 0;
 
-    emit this->message_received(received_message);
+    if(m_chunk)
+    {
+        m_chunk = SharedFrame();
 
-    if(m_clientStatus.has_value() && m_clientStatus.value())
-        this->recv();
+        if(!m_uploads.empty() && m_uploads.front().sent == m_uploads.front().size)
+        {
+            m_uploads.pop_front();
+            this->notifyStatus("  File sent.");
+        }
+    }
+
+    this->writeNext();
 }
 
 
-void Client::closeConnection() noexcept
+void Client::sendHeld(std::deque<SharedFrame> held) noexcept
 {
-    m_clientStatus = false;
+    if(held.empty())
+        return;
+
+    try
+    {
+        // Posted like the records that open the connection, so it runs after them.
+        boost::asio::post(m_retryTimer->get_executor(), [this, held = std::move(held)](){
+            try
+            {
+                m_writeQueue.insert(m_writeQueue.end(), held.begin(), held.end());
+                this->writeNext();
+            }
+            catch (const std::exception& e)
+            {
+                this->notifyStatus(e.what());
+            }
+        });
+    }
+    catch (const std::exception& e)
+    {
+        this->notifyStatus(e.what());
+    }
+}
+
+
+SharedFrame Client::nextChunk()
+{
+    Upload&           upload = m_uploads.front();
+    const std::size_t size   = static_cast<std::size_t>(std::min<std::uint64_t>(FileTransfer::CHUNK_SIZE,
+                                                                                 upload.size - upload.sent));
+    bool read = false;
+
+    // The data is read straight into the frame, behind the headers.
+    const std::size_t head = FileTransfer::chunkHeaderSize(upload.channel);
+
+    SharedFrame chunk = SharedFrame::create(head + size, [&](std::uint8_t* out){
+        FileTransfer::encodeChunkHeader(out, upload.id, upload.sent, upload.channel);
+        read = std::fread(out + head, 1, size, upload.file.get()) == size;
+    });
+
+    if(!read)
+    {
+        m_uploads.pop_front();
+        this->notifyStatus("A file could not be read; its transfer was cancelled.");
+        return SharedFrame();
+    }
+
+    upload.sent += size;
+    return chunk;
+}
+
+
+std::uint64_t Client::sendFile(const std::string& path, std::string_view sender, const std::string& channel) noexcept
+{
+    if(!channel.empty() && !Channel::isValid(channel))
+    {
+        this->notifyStatus("Invalid channel: the file was not sent.");
+        return 0;
+    }
+
+    try
+    {
+        auto upload = std::make_shared<Upload>();
+        upload->channel = channel;
+
+        std::error_code ec;
+        upload->size = std::filesystem::file_size(path, ec);
+        upload->file.reset(std::fopen(path.c_str(), "rb"));
+
+        if(ec || !upload->file)
+        {
+            this->notifyStatus("The file cannot be read.");
+            return 0;
+        }
+
+        // Drawn by the sender: the ids of different clients need no coordination.
+        std::random_device random;
+
+        while(upload->id == 0)
+            upload->id = (std::uint64_t(random()) << 32) | random();
+
+        const std::string name  = FileTransfer::safeName(std::filesystem::path(path).filename().string());
+        const SharedFrame offer = FileTransfer::offerFrame(sender, FileTransfer::Offer{upload->id, upload->size, name},
+                                                           channel);
+        const std::uint64_t id  = upload->id;
+
+        m_lastSend.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
 
+        // The offer is queued before the chunks exist, so it always leaves first.
+        boost::asio::post(m_retryTimer->get_executor(), [this, upload, offer](){
+            try
+            {
+                m_writeQueue.push_back(offer);
+
+                if(upload->size > 0)
+                    m_uploads.push_back(std::move(*upload));
+
+                this->writeNext();
+            }
+            catch (const std::exception& e)
+            {
+                this->notifyStatus(e.what());
+            }
+        });
+
+        return id;
+    }
+    catch (const std::exception& e)
+    {
+        this->notifyStatus(e.what());
+    }
+
+    return 0;
+}
+
+
+bool Client::join(const std::string& channel) noexcept
+{
+    return this->subscription(MessageRecord::Type::Join, channel);
+}
+
+bool Client::leave(const std::string& channel) noexcept
+{
+    return this->subscription(MessageRecord::Type::Leave, channel);
+}
+
+void Client::requestHistory(const std::size_t count) noexcept
+{
+    try
+    {
+        // The replay is tracked like a resume from the start of the log, on the strand.
+        boost::asio::post(m_retryTimer->get_executor(), [this, count](){
+            if(!m_linkUp)
+            {
+                this->notifyStatus("Not connected: the history was not requested.");
+                return;
+            }
+
+            if(m_resuming)
+            {
+                this->notifyStatus("A replay is already in progress.");
+                return;
+            }
+
+            try
+            {
+                const std::string body = count > 0 ? std::to_string(count) : std::string();
+
+                MessageRecord request;
+                request.type      = MessageRecord::Type::History;
+                request.timestamp = MessageRecord::now();
+                request.sequence  = 0;
+                request.body      = body;
+
+                m_resuming   = true;
+                m_resumeFrom = 0;
+                m_resumed.clear();
+
+                this->sendFrame(request.toFrame());
+            }
+            catch(const std::exception& e)
+            {
+                this->notifyStatus(e.what());
+            }
+        });
+    }
+    catch(const std::exception& e)
+    {
+        this->notifyStatus(e.what());
+    }
+}
+
+void Client::requestFile(const std::uint64_t id) noexcept
+{
+    try
+    {
+        this->sendFrame(FileTransfer::fetchFrame(id));
+    }
+    catch (const std::exception& e)
+    {
+        this->notifyStatus(e.what());
+    }
+}
+
+
+void Client::setSocketTuning(const SocketTuning& tuning) noexcept
+{
+    m_socketTuning = tuning;
+}
+
+void Client::setDownloadDirectory(const std::string& directory) noexcept
+{
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+
+    if(ec)
+    {
+        this->notifyStatus("The download directory cannot be created.");
+        return;
+    }
+
+    m_downloadDir = directory;
+}
+
+
+void Client::recv() noexcept
+{
+    try
+    {
+        if(m_clientStatus.has_value() && m_clientStatus.value())
+        {
+            boost::asio::co_spawn(m_retryTimer->get_executor(), this->readLoop(), boost::asio::detached);
+            boost::asio::co_spawn(m_retryTimer->get_executor(), this->heartbeatLoop(), boost::asio::detached);
+        }
+    }
+    catch(const std::exception& e)
+    {
+        this->notifyStatus(e.what());
+    }
+}
+
+boost::asio::awaitable<void> Client::readLoop()
+{
+    while(true)
+    {
+        const bool dropped = co_await this->readStream();
+
+        if(!dropped)
+            co_return;
+
+        const bool connected = co_await this->reconnect();
+
+        if(!connected)
+            co_return;
+    }
+}
+
+boost::asio::awaitable<bool> Client::readStream()
+{
     boost::system::error_code ec;
 
     try
     {
-        if(m_sckt->is_open())
+        while(m_clientStatus.has_value() && m_clientStatus.value())
+        {
+            const std::size_t bytes =
+                co_await m_sckt->async_read_some(m_decoder.prepare(),
+                                                 boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
+            if(ec)
+            {
+                // closeConnection() aborts the read; any other error means the link dropped.
+                co_return ec != boost::asio::error::operation_aborted
+                       && m_clientStatus.has_value() && m_clientStatus.value();
+            }
+
+            m_decoder.commit(bytes);
+            m_lastReceive = std::chrono::steady_clock::now();
+
+            m_socketTuning.rearm(*m_sckt);
+
+            // A single read may contain several frames, or only a part of one.
+            std::string_view payload;
+            FrameDecoder::Status status;
+
+            while((status = m_decoder.next(payload)) == FrameDecoder::Status::Ok)
+            {
+                // A compressed message is only decompressed once it is known to be new.
+                if(this->isNew(payload) && this->decompress(payload) && m_callbacks.message_received)
+                    m_callbacks.message_received(payload);
+            }
+
+            if(status == FrameDecoder::Status::Oversized)
+            {
+                this->notifyStatus("Invalid frame received from the server!");
+                co_return false;
+            }
+        }
+    }
+    catch(const std::exception& e)
+    {
+        if(m_clientStatus.has_value() && m_clientStatus.value())
+            this->notifyStatus(e.what());
+    }
+
+    co_return false;
+}
+
+boost::asio::awaitable<bool> Client::reconnect()
+{
+    boost::system::error_code ec;
+
+    m_linkUp = false;
+    this->notifyStatus("  Connection lost, reconnecting...");
+
+    // The bytes of a frame cut by the drop do not belong to the new stream.
+    m_sckt->close(ec);
+    m_decoder.reset();
+
+    for(unsigned attempt = 0; m_clientStatus.has_value() && m_clientStatus.value(); ++attempt)
+    {
+        // Full jitter: a uniform wait below a ceiling that doubles with every attempt,
+        // so that the clients dropped by a server restart do not all come back at once.
+        const std::chrono::milliseconds ceiling =
+            std::min<std::chrono::milliseconds>(RECONNECT_MAX_DELAY, RECONNECT_MIN_DELAY * (1 << std::min(attempt, 16u)));
+        std::uniform_int_distribution<std::chrono::milliseconds::rep> delay(0, ceiling.count());
+
+        m_retryTimer->expires_after(std::chrono::milliseconds(delay(m_random)));
+        co_await m_retryTimer->async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
+        if(ec == boost::asio::error::operation_aborted || !(m_clientStatus.has_value() && m_clientStatus.value()))
+            co_return false;
+
+        this->openSocket(*m_endpoint);
+        co_await m_sckt->async_connect(*m_endpoint, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
+        if(!ec)
+        {
+            // The messages typed during the outage, and the batch whose write failed,
+            // leave after the Hello, the joins and the History request. The failed
+            // write completed before the first attempt, so no write is in flight.
+            std::deque<SharedFrame> held;
+            held.swap(m_writeQueue);
+
+            m_lastReceive = std::chrono::steady_clock::now();
+            m_linkUp      = true;
+
+            // The server dropped the files of the old connection.
+            this->abortTransfers();
+
+            this->hello();
+            this->rejoin();
+            this->notifyStatus("  Reconnected!");
+            this->resume();
+            this->sendHeld(std::move(held));
+            co_return true;
+        }
+
+        // A failed connect leaves the socket open.
+        m_sckt->close(ec);
+    }
+
+    co_return false;
+}
+
+boost::asio::awaitable<void> Client::heartbeatLoop()
+{
+    boost::system::error_code ec;
+
+    // Every heartbeat is the same frame.
+    MessageRecord heartbeat;
+    heartbeat.type = MessageRecord::Type::Heartbeat;
+
+    const SharedFrame frame = heartbeat.toFrame();
+
+    while(m_clientStatus.has_value() && m_clientStatus.value())
+    {
+        m_heartbeatTimer->expires_after(HEARTBEAT_CHECK);
+        co_await m_heartbeatTimer->async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
+        if(ec == boost::asio::error::operation_aborted || !(m_clientStatus.has_value() && m_clientStatus.value()))
+            co_return;
+
+        // The reconnect restarts the clock once it has a new connection.
+        if(!m_linkUp)
+            continue;
+
+        const auto now = std::chrono::steady_clock::now();
+
+        if(now - m_lastReceive >= IDLE_TIMEOUT)
         {
+            // The shutdown ends the pending read like a drop, and the read loop reconnects.
+            m_linkUp = false;
             m_sckt->shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
-            m_sckt->close(ec);
+            continue;
+        }
+
+        const std::chrono::steady_clock::time_point last_send(
+            std::chrono::steady_clock::duration(m_lastSend.load(std::memory_order_relaxed)));
+
+        if(now - last_send >= HEARTBEAT_INTERVAL)
+            this->sendFrame(frame);
+    }
+}
+
+void Client::openSocket(const boost::asio::ip::tcp::endpoint& endpoint) noexcept
+{
+    boost::system::error_code ec;
+
+    // A socket whose connect failed is not reused. If it cannot be opened here,
+    // the connect reports the error; an option that cannot be set only leaves the
+    // system's value.
+    m_sckt->close(ec);
+    m_sckt->open(endpoint.protocol(), ec);
+
+    if(!ec)
+        m_socketTuning.apply(*m_sckt, ec);
+}
+
+void Client::hello() noexcept
+{
+    try
+    {
+        // Until the server answers, nothing is sent compressed.
+        m_serverCodecs.store(0, std::memory_order_relaxed);
+
+        const std::string codecs = Compression::names(Compression::available());
+
+        MessageRecord hello;
+        hello.type      = MessageRecord::Type::Hello;
+        hello.timestamp = MessageRecord::now();
+        hello.body      = codecs;
+
+        this->sendFrame(hello.toFrame());
+    }
+    catch(const std::exception& e)
+    {
+        this->notifyStatus(e.what());
+    }
+}
+
+void Client::rejoin() noexcept
+{
+    try
+    {
+        for(const std::string& channel : m_channels)
+        {
+            MessageRecord join;
+            join.type      = MessageRecord::Type::Join;
+            join.timestamp = MessageRecord::now();
+            join.channel   = channel;
 
-            if(ec) emit this->connectionStatus("Error on socket shutdown/close!");
+            this->sendFrame(join.toFrame());
         }
     }
+    catch(const std::exception& e)
+    {
+        this->notifyStatus(e.what());
+    }
+}
+
+bool Client::subscription(const MessageRecord::Type type, const std::string& channel) noexcept
+{
+    if(!Channel::isValid(channel))
+        return false;
+
+    try
+    {
+        MessageRecord record;
+        record.type      = type;
+        record.timestamp = MessageRecord::now();
+        record.channel   = channel;
+
+        // The set changes on the strand, where the connections are made: a reconnect
+        // that comes later joins the channel again by itself.
+        boost::asio::post(m_retryTimer->get_executor(), [this, type, channel, frame = record.toFrame()](){
+            try
+            {
+                if(type == MessageRecord::Type::Join)
+                    m_channels.insert(channel);
+                else
+                    m_channels.erase(channel);
+
+                this->sendFrame(frame);
+            }
+            catch(const std::exception& e)
+            {
+                this->notifyStatus(e.what());
+            }
+        });
+    }
+    catch(const std::exception& e)
+    {
+        this->notifyStatus(e.what());
+    }
+
+    return true;
+}
+
+void Client::resume() noexcept
+{
+    // Nothing logged was received: there is nothing to resume from.
+    if(m_lastSequence == 0)
+        return;
+
+    try
+    {
+        // An empty body asks for as many messages as the server replays.
+        MessageRecord request;
+        request.type      = MessageRecord::Type::History;
+        request.timestamp = MessageRecord::now();
+        request.sequence  = m_lastSequence;
+
+        m_resuming   = true;
+        m_resumeFrom = m_lastSequence;
+        m_resumed.clear();
+
+        this->sendFrame(request.toFrame());
+    }
+    catch(const std::exception& e)
+    {
+        this->notifyStatus(e.what());
+    }
+}
+
+bool Client::isNew(std::string_view payload) noexcept
+{
+    MessageRecord record;
+
+    // Payloads that are not records are up to the receiver.
+    if(!MessageRecord::decode(payload, record))
+        return true;
+
+    if(record.type == MessageRecord::Type::Heartbeat)
+        return false;
+
+    if(record.type == MessageRecord::Type::Hello)
+    {
+        m_serverCodecs.store(Compression::parseNames(record.body), std::memory_order_relaxed);
+        return false;
+    }
+
+    if(record.type == MessageRecord::Type::FileOffer || record.type == MessageRecord::Type::FileChunk)
+    {
+        this->receiveFile(record);
+        return false;
+    }
+
+    if(record.type == MessageRecord::Type::Leave)
+    {
+        // The server refused a Join: it is not joined again on the next connection.
+        const std::string channel(record.channel);
+
+        m_channels.erase(channel);
+        this->notifyStatus(("The server refused to join " + channel + ".").c_str());
+        return false;
+    }
+
+    if(record.type == MessageRecord::Type::History)
+    {
+        // End of the replay. A last sequence below the one asked for means that
+        // the server started a new log: from now on its sequences are followed.
+        if(m_resuming)
+        {
+            m_resuming    = false;
+            m_resumeUntil = record.sequence;
+            m_resumed.clear();
+
+            if(record.sequence < m_resumeFrom)
+                m_lastSequence = record.sequence;
+        }
+
+        return false;
+    }
+
+    // Messages that are not logged cannot be replayed, hence never come twice.
+    if(record.sequence == 0)
+        return true;
+
+    if(m_resuming)
+    {
+        // The live messages relayed before the replay are all replayed again.
+        if(record.sequence > m_resumeFrom && !m_resumed.insert(record.sequence).second)
+            return false;
+    }
+    else if(record.sequence > m_resumeFrom && record.sequence <= m_resumeUntil)
+    {
+        // A live copy of a replayed message that reached this connection after the replay.
+        return false;
+    }
+
+    m_lastSequence = std::max(m_lastSequence, record.sequence);
+    return true;
+}
+
+void Client::receiveFile(const MessageRecord& record) noexcept
+{
+    FileTransfer::Offer offer;
+    FileTransfer::Chunk chunk;
+
+    try
+    {
+        if(FileTransfer::decodeOffer(record, offer))
+        {
+            if(offer.name.empty())
+            {
+                this->notifyStatus("The requested file is not available on the server.");
+                return;
+            }
+
+            if(m_downloadDir.empty())
+                return;
+
+            // A file received again starts over.
+            std::error_code ec;
+            m_downloads.erase(offer.id);
+            std::filesystem::remove(partPath(m_downloadDir, offer.id), ec);
+
+            Download download;
+            download.name = FileTransfer::safeName(offer.name);
+            download.size = offer.size;
+            download.file.reset(std::fopen(partPath(m_downloadDir, offer.id).c_str(), "wb"));
+
+            if(!download.file)
+            {
+                this->notifyStatus("A received file cannot be written to the download directory.");
+                return;
+            }
+
+            m_downloads.emplace(offer.id, std::move(download));
+
+            if(offer.size == 0)
+                this->saveFile(offer.id);
+        }
+        else if(FileTransfer::decodeChunk(record, chunk))
+        {
+            const auto it = m_downloads.find(chunk.id);
+
+            // Not a file being downloaded.
+            if(it == m_downloads.end())
+                return;
+
+            Download& download = it->second;
+
+            // A chunk that does not follow the previous one means that some were lost.
+            if(chunk.offset != download.received || chunk.data.size() > download.size - download.received ||
+               std::fwrite(chunk.data.data(), 1, chunk.data.size(), download.file.get()) != chunk.data.size())
+            {
+                std::error_code ec;
+                m_downloads.erase(it);
+                std::filesystem::remove(partPath(m_downloadDir, chunk.id), ec);
+
+                this->notifyStatus("A file was not received completely and was discarded.");
+                return;
+            }
+
+            download.received += chunk.data.size();
+
+            if(download.received == download.size)
+                this->saveFile(chunk.id);
+        }
+    }
+    catch(const std::exception& e)
+    {
+        this->notifyStatus(e.what());
+    }
+}
+
+void Client::saveFile(const std::uint64_t id)
+{
+    namespace fs = std::filesystem;
+
+    const auto it = m_downloads.find(id);
+    Download download = std::move(it->second);
+    m_downloads.erase(it);
+
+    const std::string part = partPath(m_downloadDir, id);
+    const bool flushed = std::fclose(download.file.release()) == 0;
+
+    // An existing file is never replaced: the new one gets a number.
+    const fs::path name(download.name);
+    fs::path       target = fs::path(m_downloadDir) / name;
+    std::error_code ec;
+
+    for(unsigned n = 1; fs::exists(target, ec); ++n)
+    {
+        target = fs::path(m_downloadDir) /
+                 (name.stem().string() + " (" + std::to_string(n) + ")" + name.extension().string());
+    }
+
+    if(flushed)
+        fs::rename(part, target, ec);
+
+    if(!flushed || ec)
+    {
+        fs::remove(part, ec);
+        this->notifyStatus("A received file could not be saved.");
+        return;
+    }
+
+    if(m_callbacks.file_received)
+        m_callbacks.file_received(target.string());
+}
+
+void Client::abortTransfers() noexcept
+{
+    m_uploads.clear();
+
+    for(auto& [id, download] : m_downloads)
+    {
+        std::error_code ec;
+        download.file.reset();
+        std::filesystem::remove(partPath(m_downloadDir, id), ec);
+    }
+
+    m_downloads.clear();
+}
+
+bool Client::decompress(std::string_view& payload) noexcept
+{
+    MessageRecord record;
+
+    if(!MessageRecord::decode(payload, record) || record.type != MessageRecord::Type::Compressed)
+        return true;
+
+    try
+    {
+        if(Compression::decompress(record, m_decompressed))
+        {
+            payload = m_decompressed;
+            return true;
+        }
+
+        this->notifyStatus("Invalid compressed message received from the server!");
+    }
+    catch(const std::exception& e)
+    {
+        this->notifyStatus(e.what());
+    }
+
+    return false;
+}
+
+
+void Client::closeConnection() noexcept
+{
+    m_clientStatus = false;
+
+    try
+    {
+        // Everything runs on the strand, where the read, write, heartbeat and reconnect
+        // loops use the socket. A write in flight fails with the socket and empties
+        // the queue itself; the cancelled timers stop a reconnect waiting for its next
+        // attempt, and the heartbeats.
+        boost::asio::post(m_retryTimer->get_executor(), [this](){
+            if(m_sckt->is_open())
+            {
+                boost::system::error_code ec;
+
+                m_sckt->shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+                m_sckt->close(ec);
+
+                if(ec) this->notifyStatus("Error on socket shutdown/close!");
+            }
+
+            m_retryTimer->cancel();
+            m_heartbeatTimer->cancel();
+
+            this->abortTransfers();
+
+            if(!m_writing)
+                m_writeQueue.clear();
+        });
+    }
     catch (const std::exception& e)
     {
-        emit this->connectionStatus(e.what());
+        this->notifyStatus(e.what());
     }
 }
 
@@ -175,4 +1051,13 @@ void Client::finish() noexcept
     m_work.reset();
     m_io_cntxt->stop();
     m_threads.join_all();
+
+    // The stop may have come before the posted close: no thread uses the socket now.
+    if(m_sckt->is_open())
+    {
+        boost::system::error_code ec;
+
+        m_sckt->shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+        m_sckt->close(ec);
+    }
 }
@@ -0,0 +1,120 @@
+#include "client_adapter.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PRIVATE METHODS
+///
+void ClientAdapter::drainMessages() noexcept
+{
+    try
+    {
+        QList<ChatMessage> messages;
+
+        m_inbox->drain([&messages](std::string_view payload){
+            MessageRecord record;
+
+            if(MessageRecord::decode(payload, record))
+                messages.append(ChatMessage::fromRecord(record));
+        }, MAX_DRAIN_BATCH);
+
+        if(!messages.isEmpty())
+            emit this->messages_received(messages);
+    }
+    catch(const std::exception& e)
+    {
+        emit this->connectionStatus(e.what());
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+ClientAdapter::ClientAdapter(QObject* parent)
+    : QObject(parent),
+      m_client(std::make_unique<Client>())
+{
+    // The callbacks run on the worker threads; the signals reach the GUI
+    // through queued connections. Reads of the connection never overlap, so
+    // the client is the single producer of the inbox.
+    m_inbox = std::make_unique<MessageInbox>(1, [this](){
+        QMetaObject::invokeMethod(this, [this](){ this->drainMessages(); }, Qt::QueuedConnection);
+    });
+
+    Client::Callbacks callbacks;
+
+    callbacks.message_received = [this](std::string_view message){
+        m_inbox->push(0, message);
+    };
+    callbacks.connection_status = [this](const char* status){
+        // The text is copied before the thread hop: a queued signal keeps its
+        // arguments, and a status may point into an exception that is gone by then.
+        emit this->connectionStatus(QString::fromUtf8(status));
+    };
+    callbacks.file_received = [this](const std::string& path){
+        emit this->fileReceived(QString::fromStdString(path));
+    };
+
+    m_client->setCallbacks(std::move(callbacks));
+}
+
+ClientAdapter::~ClientAdapter()
+{
+    // The worker threads may still call back into the adapter while the
+    // client shuts down, so the client goes first.
+    m_client.reset();
+}
+
+const std::optional<std::atomic<bool>>& ClientAdapter::is_working() const noexcept
+{
+    return m_client->is_working();
+}
+
+void ClientAdapter::connect(const char* ip_address, const unsigned port) noexcept
+{
+    m_client->connect(ip_address, port);
+}
+
+void ClientAdapter::send(const MessageRecord& record) noexcept
+{
+    m_client->send(record);
+}
+
+bool ClientAdapter::join(const std::string& channel) noexcept
+{
+    return m_client->join(channel);
+}
+
+bool ClientAdapter::leave(const std::string& channel) noexcept
+{
+    return m_client->leave(channel);
+}
+
+std::uint64_t ClientAdapter::sendFile(const std::string& path, std::string_view sender,
+                                      const std::string& channel) noexcept
+{
+    return m_client->sendFile(path, sender, channel);
+}
+
+void ClientAdapter::requestHistory(const std::size_t count) noexcept
+{
+    m_client->requestHistory(count);
+}
+
+void ClientAdapter::setDownloadDirectory(const std::string& directory) noexcept
+{
+    m_client->setDownloadDirectory(directory);
+}
+
+void ClientAdapter::recv() noexcept
+{
+    m_client->recv();
+}
+
+void ClientAdapter::closeConnection() noexcept
+{
+    m_client->closeConnection();
+}
+
+void ClientAdapter::finish() noexcept
+{
+    m_client->finish();
+}
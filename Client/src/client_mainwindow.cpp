@@ -1,5 +1,9 @@
 #include "client_mainwindow.h"
 
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QStandardPaths>
+
 //////////////////////////////////////////////////////////////////////////////////////////////////
 /// PRIVATE METHODS
 ///
@@ -33,10 +37,9 @@ void CMainWindow::resetAtributes()
         m_welcomeLabel = nullptr;
 
     m_connectionStatusLabel = nullptr;
-    m_messagesLabel         = nullptr;
-
-    m_messagesLabelScroll   = nullptr;
-    m_messagesLabelLayout   = nullptr;
+    m_messagesView          = nullptr;
+    m_messagesModel         = nullptr;
+    m_messagesLayout        = nullptr;
 
     m_userInputLEdit        = nullptr;
 
@@ -113,26 +116,29 @@ void CMainWindow::addMenu()
     m_quitAction          = new QAction("Quit", this);
     m_connectAction       = new QAction("New Connetion", this);
     m_clearMessagesAction = new QAction("Clear", this);
+    m_sendFileAction      = new QAction("Send File...", this);
 
     m_appMenu->addAction(m_quitAction);
     m_connectionMenu->addAction(m_connectAction);
+    m_connectionMenu->addAction(m_sendFileAction);
     m_optionsMenu->addAction(m_clearMessagesAction);
 
     connect(m_quitAction, &QAction::triggered, this, [this](){ QApplication::quit(); });
     connect(m_connectAction, &QAction::triggered, this, &CMainWindow::getServerInfo);
     connect(m_clearMessagesAction, &QAction::triggered, this, &CMainWindow::clearMessages);
+    connect(m_sendFileAction, &QAction::triggered, this, &CMainWindow::sendFile);
 }
 
-void CMainWindow::addStatusLable(const char* status)
+void CMainWindow::addStatusLable(const QString& status)
 {
     m_connectionStatusLabel = new QLabel(status, m_centralWidget);
 
     QPalette labelPalette;
 
-    labelPalette.setColor(QPalette::WindowText, [status](){
-        if(!std::strcmp(status, "  Connected!"))
+    labelPalette.setColor(QPalette::WindowText, [&status](){
+        if(status == "  Connected!")
             return Qt::green;
-        else if(!std::strcmp(status, "Waiting for IP address and port..."))
+        else if(status == "Waiting for IP address and port...")
             return Qt::cyan;
         else
             return Qt::red;
@@ -172,24 +178,22 @@ void CMainWindow::addUserInput()
     connect(m_userInputLEdit, &QLineEdit::returnPressed, this, &CMainWindow::sendingMessages);
 }
 
-void CMainWindow::addMessagesLabel()
+void CMainWindow::addMessagesView()
 {
-    m_messagesLabel = new QLabel(m_centralWidget);
-    m_messagesLabel->setFrameStyle(QFrame::Panel | QFrame::Sunken);
-    m_messagesLabel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
-    m_messagesLabel->setTextInteractionFlags(Qt::TextSelectableByMouse | Qt::TextSelectableByKeyboard);
-    m_messagesLabel->setWordWrap(true);
-    m_messagesLabel->setAlignment(Qt::AlignBottom);
-
-    m_messagesLabelScroll = new QScrollArea(m_centralWidget);
-    m_messagesLabelScroll->setWidget(m_messagesLabel);
-    m_messagesLabelScroll->setWidgetResizable(true);
-    m_messagesLabelScroll->setPalette(*m_widgetsPalette);
-
-    m_messagesLabelLayout = new QHBoxLayout();
-    m_messagesLabelLayout->addWidget(m_messagesLabelScroll);
-
-    m_verticalLayout->addLayout(m_messagesLabelLayout, Qt::AlignCenter);
+    // Only the visible messages are laid out, so the cost of a new message does not
+    // grow with the length of the history.
+    m_messagesView  = new ChatLogView(m_centralWidget);
+    m_messagesModel = new ChatLogModel(m_messagesView);
+
+    m_messagesView->setModel(m_messagesModel);
+    m_messagesView->setFrameStyle(QFrame::Panel | QFrame::Sunken);
+    m_messagesView->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+    m_messagesView->setPalette(*m_widgetsPalette);
+
+    m_messagesLayout = new QHBoxLayout();
+    m_messagesLayout->addWidget(m_messagesView);
+
+    m_verticalLayout->addLayout(m_messagesLayout, Qt::AlignCenter);
 }
 
 void CMainWindow::startConnection()
@@ -215,8 +219,11 @@ void CMainWindow::startConnection()
         }
     }
 
+    // The direct messages to the nickname come on every connection.
+    m_client->join(std::string(1, Channel::NICKNAME_PREFIX) + m_clientName);
+
     m_clientThread =
-        std::make_unique<boost::thread>(boost::bind(&Client::connect,
+        std::make_unique<boost::thread>(boost::bind(&ClientAdapter::connect,
                                                     m_client,
                                                     m_serverIPaddress.c_str(),
                                                     std::atoi(m_serverPort.c_str())
@@ -224,33 +231,34 @@ void CMainWindow::startConnection()
                                         );
 }
 
-void CMainWindow::onConnection(const char* status)
+void CMainWindow::onConnection(const QString& status)
 {
     delete m_centralWidget; // Upon this destruction all child widgets are destroyed
     this->resetAtributes();
 
     this->addLayouts();
     this->addStatusLable(status);
-    this->addMessagesLabel();
+    this->addMessagesView();
     this->addUserInput();
 
     m_client->recv();
 
-    connect(m_client, &Client::message_received, this, &CMainWindow::displayMessage);
+    connect(m_client, &ClientAdapter::messages_received, this, &CMainWindow::displayMessages);
+
+    // What was said before the connection, if the server keeps a log.
+    m_client->requestHistory(HISTORY_SIZE);
 }
 
-void CMainWindow::displayMessage(const std::string &message)
+void CMainWindow::displayMessage(const ChatMessage& message)
 {
-    boost::lock_guard<boost::mutex> lckgrd(m_messageLabelMutex);
-
-    m_messagesLabel->setText(m_messagesLabel->text() + QString::fromStdString(message));
-
-    m_messagesLabel->adjustSize();
+    this->displayMessages(QList<ChatMessage>{message});
+}
 
-    // Set scroll bar in the bottom position
-    m_messagesLabelScroll->verticalScrollBar()->setSliderPosition(
-        m_messagesLabelScroll->verticalScrollBar()->maximum()
-    );
+void CMainWindow::displayMessages(const QList<ChatMessage>& messages)
+{
+    // One rowsInserted for the whole batch; the view follows the new messages
+    // if it was showing the latest ones.
+    m_messagesModel->appendMessages(messages);
 }
 
 void CMainWindow::cleanup()
@@ -268,7 +276,7 @@ void CMainWindow::getServerInfo()
 {
     if(m_centralWidget && m_hasEverConnected)
     {
-        disconnect(m_client, &Client::message_received, nullptr, nullptr);
+        disconnect(m_client, &ClientAdapter::messages_received, nullptr, nullptr);
 
         delete m_centralWidget;
         this->resetAtributes();
@@ -300,10 +308,14 @@ void CMainWindow::getServerInfo()
         }
 
         this->addServerInfo();
-        connect(m_client, &Client::connectionStatus, this, &CMainWindow::setConnectionStatus);
+        connect(m_client, &ClientAdapter::connectionStatus, this, &CMainWindow::setConnectionStatus);
     }
 
     connect(m_connectButton, &QPushButton::clicked, this, [this](){
+        // Under a new nickname, the direct messages to the old one stop.
+        if(!m_clientName.empty() && m_clientName != m_clientNameLEdit->text().toStdString())
+            m_client->leave(std::string(1, Channel::NICKNAME_PREFIX) + m_clientName);
+
         m_clientName      = m_clientNameLEdit->text().toStdString();
         m_serverIPaddress = m_ipAddressLEdit->text().toStdString();
         m_serverPort      = m_portLEdit->text().toStdString();
@@ -313,7 +325,7 @@ void CMainWindow::getServerInfo()
 }
 
 
-void CMainWindow::setConnectionStatus(const char* status)
+void CMainWindow::setConnectionStatus(const QString& status)
 {
     if(m_clientThread != nullptr)
     {
@@ -323,7 +335,7 @@ void CMainWindow::setConnectionStatus(const char* status)
         m_clientThread = nullptr;
     }
 
-    if(!std::strcmp(status, "  Connected!"))
+    if(status == "  Connected!")
     {
         this->onConnection(status);
     }
@@ -332,35 +344,106 @@ void CMainWindow::setConnectionStatus(const char* status)
         m_connectionStatusLabel->setText(status);
 
         QPalette labelPalette;
-        labelPalette.setColor(QPalette::WindowText,
-                              (!std::strcmp(status, "Waiting for IP address and port...")? Qt::cyan : Qt::red));
+        labelPalette.setColor(QPalette::WindowText, [&status](){
+            // The client reconnects by itself; the chat view stays as it is.
+            if(status == "  Reconnected!")
+                return Qt::green;
+            else if(status == "Waiting for IP address and port..." ||
+                    status == "  Connection lost, reconnecting...")
+                return Qt::cyan;
+            else
+                return Qt::red;
+        }());
         m_connectionStatusLabel->setPalette(labelPalette);
     }
 }
 
 void CMainWindow::sendingMessages()
 {
-    std::string input = m_userInputLEdit->text().toStdString();
+    const std::string input = m_userInputLEdit->text().toStdString();
     m_userInputLEdit->clear();
 
     if(input.empty())
         return;
 
-    input = std::string("<span style='color: green;'>") + m_clientName + ": </span>" + input + "<br>";
+    // "/join #room" and "/leave #room" change the rooms; "/msg <#room|@nickname> text"
+    // writes to one of them, or to someone. Anything else goes to everyone.
+    std::string_view channel;
+    std::string_view text = input;
+    std::string_view rest;
+
+    if(Channel::parseCommand(input, "join", channel, rest) || Channel::parseCommand(input, "leave", channel, rest))
+    {
+        const bool join = input.compare(0, 5, "/join") == 0;
+        const bool done = join ? m_client->join(std::string(channel)) : m_client->leave(std::string(channel));
+
+        ChatMessage message;
+        message.type      = MessageRecord::Type::Broadcast;
+        message.timestamp = static_cast<qint64>(MessageRecord::now());
+        message.body      = QString::fromStdString((done ? (join ? "Joined " : "Left ") : "Invalid channel: ") +
+                                                   std::string(channel));
+
+        this->displayMessage(message);
+        return;
+    }
+
+    if(Channel::parseCommand(input, "msg", channel, rest))
+        text = rest;
 
-    std::copy(input.begin(), input.end(), std::back_inserter(m_send_buffer));
+    // Only the fields travel; how the message looks is decided by each receiver.
+    MessageRecord record;
+    record.type      = MessageRecord::Type::Chat;
+    record.timestamp = MessageRecord::now();
+    record.channel   = channel;
+    record.sender    = m_clientName;
+    record.body      = text;
 
-    m_client->send(m_send_buffer);
-    m_send_buffer.clear();
+    m_client->send(record);
 
-    // Adding text to the messageLabel
-    this->displayMessage(input);
+    // Adding the message to the history
+    this->displayMessage(ChatMessage::fromRecord(record));
 }
 
 void CMainWindow::clearMessages()
 {
-    if(m_messagesLabel)
-        m_messagesLabel->clear();
+    if(m_messagesModel)
+        m_messagesModel->clear();
+}
+
+void CMainWindow::sendFile()
+{
+    if(!m_messagesModel || !m_client->is_working().has_value() || !m_client->is_working().value())
+        return;
+
+    const QString path = QFileDialog::getOpenFileName(this, "Send File");
+
+    if(path.isEmpty())
+        return;
+
+    // The file is read while it is sent; the chat stays usable in the meantime.
+    if(m_client->sendFile(path.toStdString(), m_clientName) == 0)
+        return;
+
+    ChatMessage message;
+    message.type      = MessageRecord::Type::Chat;
+    message.timestamp = static_cast<qint64>(MessageRecord::now());
+    message.sender    = QString::fromStdString(m_clientName);
+    message.body      = "Sending the file " + QFileInfo(path).fileName() + "...";
+
+    this->displayMessage(message);
+}
+
+void CMainWindow::onFileReceived(const QString& path)
+{
+    if(!m_messagesModel)
+        return;
+
+    ChatMessage message;
+    message.type      = MessageRecord::Type::Broadcast;
+    message.timestamp = static_cast<qint64>(MessageRecord::now());
+    message.body      = "File received: " + path;
+
+    this->displayMessage(message);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////
@@ -383,7 +466,7 @@ void CMainWindow::resizeEvent(QResizeEvent *event)
 /// PUBLIC METHODS
 ///
 CMainWindow::CMainWindow(QWidget *parent) : QMainWindow(parent),
-                                            m_client(new Client(this)),
+                                            m_client(new ClientAdapter(this)),
                                             m_clientThread(nullptr),
                                             m_hasEverConnected(false)
 {
@@ -391,6 +474,14 @@ CMainWindow::CMainWindow(QWidget *parent) : QMainWindow(parent),
 
     this->addPalettes();
     this->addMenu();
+
+    // The files sent by the other clients are saved with the user's downloads.
+    const QString downloads = QStandardPaths::writableLocation(QStandardPaths::DownloadLocation);
+
+    if(!downloads.isEmpty())
+        m_client->setDownloadDirectory((downloads + "/LANChat").toStdString());
+
+    connect(m_client, &ClientAdapter::fileReceived, this, &CMainWindow::onFileReceived);
 }
 
 CMainWindow::~CMainWindow()
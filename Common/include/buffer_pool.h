@@ -0,0 +1,145 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * @class BufferPool
+ * @brief Process-wide pool of memory blocks in power-of-two size classes.
+ *
+ * Frames are allocated on the thread that receives a message and released on the
+ * thread that completes the last write of it, so the blocks travel between the
+ * threads. Every thread keeps a small cache of free blocks per size class and
+ * allocates and releases from it without any lock; a full cache hands half of its
+ * blocks to a shared depot, an empty one takes a batch back from it. Once the
+ * caches and the depot hold the working set, relaying a message does not reach
+ * the heap at all.
+ *
+ * Both the caches and the depot are bounded in bytes as well as in blocks, so a
+ * class of large blocks keeps only a few of them: after a burst, the memory
+ * beyond the bounds goes back to the heap instead of staying in the pool.
+ *
+ * Requests larger than the largest class go to operator new directly.
+ */
+class BufferPool
+{
+public:
+    static constexpr std::size_t MIN_BLOCK_SIZE     = 64;                                  ///< Size of the smallest class.
+    static constexpr std::size_t CLASS_NUM          = 11;                                  ///< 64 B to 64 KiB.
+    static constexpr std::size_t MAX_BLOCK_SIZE     = MIN_BLOCK_SIZE << (CLASS_NUM - 1);   ///< Size of the largest class.
+    static constexpr std::size_t THREAD_CACHE_SIZE  = 128;                                 ///< Free blocks a thread keeps per class,
+    static constexpr std::size_t THREAD_CACHE_BYTES = std::size_t(1) << 20;                ///< and at most 1 MiB of them.
+    static constexpr std::size_t DEPOT_SIZE         = 8192;                                ///< Free blocks the depot keeps per class,
+    static constexpr std::size_t DEPOT_BYTES        = std::size_t(4) << 20;                ///< and at most 4 MiB of them; beyond
+                                                                                           ///< that they return to the heap.
+
+    /**
+     * @brief allocate
+     * @param size Number of bytes.
+     * @return A block of at least size bytes, aligned like operator new.
+     * @throws std::bad_alloc
+     */
+    static void* allocate(const std::size_t size);
+    /**
+     * @brief deallocate Returns a block to the cache of the calling thread.
+     * @param block A block returned by allocate().
+     * @param size The size passed to allocate().
+     */
+    static void deallocate(void* block, const std::size_t size) noexcept;
+
+private: // Fields
+    struct FreeBlock
+    {
+        FreeBlock* next;   ///< Next free block of the same class.
+    };
+
+    /**
+     * @struct FreeList
+     * @brief Singly linked list of free blocks of one class.
+     */
+    struct FreeList
+    {
+        FreeBlock*  head  = nullptr;   ///< First block.
+        std::size_t count = 0;         ///< Number of blocks.
+
+        void push(FreeBlock* block) noexcept { block->next = head; head = block; ++count; }
+        FreeBlock* pop() noexcept            { FreeBlock* block = head; head = block->next; --count; return block; }
+        /**
+         * @brief moveTo Moves up to n blocks to another list.
+         */
+        void moveTo(FreeList& other, std::size_t n) noexcept
+        {
+            while(n-- > 0 && head)
+                other.push(this->pop());
+        }
+    };
+
+    struct ThreadCache;
+    struct Depot;
+
+private: // Methods
+    /**
+     * @brief classOf
+     * @return The index of the smallest class holding size bytes (size <= MAX_BLOCK_SIZE).
+     */
+    static std::size_t classOf(const std::size_t size)                      noexcept;
+    /**
+     * @brief blockSizeOf
+     * @return The size of the blocks of a class.
+     */
+    static std::size_t blockSizeOf(const std::size_t size_class)            noexcept;
+    /**
+     * @brief cacheCapacity / depotCapacity
+     * @return The number of free blocks of a class a thread cache, or the depot, keeps.
+     */
+    static std::size_t cacheCapacity(const std::size_t size_class)          noexcept;
+    static std::size_t depotCapacity(const std::size_t size_class)          noexcept;
+    /**
+     * @brief threadCache
+     * @return The cache of the calling thread, or nullptr if the thread is exiting
+     *         and its cache has already been destroyed.
+     */
+    static ThreadCache* threadCache()                                       noexcept;
+    static Depot&       depot()                                             noexcept;
+    /**
+     * @brief release Moves n blocks of a list to the depot, or to the heap once the
+     *        depot is full.
+     */
+    static void release(FreeList& list, const std::size_t size_class, const std::size_t n) noexcept;
+};
+
+/**
+ * @class PoolAllocator
+ * @brief Standard allocator over BufferPool, for the shared frames and the write queues.
+ */
+template<typename T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept
+    {
+    }
+
+    T* allocate(const std::size_t n)
+    {
+        return static_cast<T*>(BufferPool::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* block, const std::size_t n) noexcept
+    {
+        BufferPool::deallocate(block, n * sizeof(T));
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U>&)                 const noexcept { return true; }
+};
+
+#endif // BUFFER_POOL_H
@@ -0,0 +1,54 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <string_view>
+
+
+/**
+ * @namespace Channel
+ * @brief Names of the channels a message can be sent to (see MessageRecord::channel).
+ *
+ * A room is "#" followed by its name: its members receive what any of them writes
+ * to it, and only members may write to it. A nickname is "@" followed by the
+ * nickname: the client that joined it receives the direct messages anyone writes
+ * to it. The server gives a nickname to the first connection that joins it, until
+ * that one leaves it or closes, and refuses it to the others. The empty channel
+ * is everyone, as without channels.
+ *
+ * A name is at most MessageRecord::MAX_CHANNEL_SIZE bytes of UTF-8 and contains no
+ * whitespace or control characters, so it can be typed as a command argument.
+ */
+namespace Channel
+{
+    constexpr char ROOM_PREFIX     = '#';   ///< First character of a room.
+    constexpr char NICKNAME_PREFIX = '@';   ///< First character of a nickname.
+
+    /**
+     * @brief isValid
+     * @return True if the name is a room or a nickname with a valid name.
+     */
+    bool isValid(std::string_view channel)                                       noexcept;
+    /**
+     * @brief isRoom
+     * @return True if the channel is a room (it may still be invalid).
+     */
+    bool isRoom(std::string_view channel)                                        noexcept;
+    /**
+     * @brief isNickname
+     * @return True if the channel is a nickname (it may still be invalid).
+     */
+    bool isNickname(std::string_view channel)                                    noexcept;
+    /**
+     * @brief parseCommand Reads a command typed in a chat input: "/name channel rest",
+     *        as in "/join #lan" or "/msg @ana see you".
+     * @param input The text typed by the user.
+     * @param name The command, without the slash.
+     * @param channel Receives the channel (not checked).
+     * @param rest Receives what follows the channel, possibly empty.
+     * @return False if the input is not this command, or has no channel.
+     */
+    bool parseCommand(std::string_view input, std::string_view name,
+                      std::string_view& channel, std::string_view& rest)          noexcept;
+}
+
+#endif // CHANNEL_H
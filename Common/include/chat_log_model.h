@@ -0,0 +1,81 @@
+#ifndef CHAT_LOG_MODEL_H
+#define CHAT_LOG_MODEL_H
+
+#include <QAbstractListModel>
+#include <QList>
+#include <QString>
+
+#include "message_record.h"
+
+#include <vector>
+
+
+/**
+ * @struct ChatMessage
+ * @brief A message of the history, decoded from a MessageRecord. How it looks on
+ *        screen is decided by the view.
+ */
+struct ChatMessage
+{
+    MessageRecord::Type type      = MessageRecord::Type::Chat;   ///< Kind of message.
+    qint64              timestamp = 0;                           ///< Milliseconds since the Unix epoch (UTC).
+    QString             channel;                                 ///< Room or nickname it was sent to, empty for everyone.
+    QString             sender;                                  ///< Nickname of the author.
+    QString             body;                                    ///< Text of the message (plain text).
+
+    /**
+     * @brief fromRecord Copies the fields of a record, whose views may not outlive the call.
+     */
+    static ChatMessage fromRecord(const MessageRecord& record);
+};
+
+
+/**
+ * @class ChatLogModel
+ * @brief Append-only list of chat messages, one row per message.
+ *
+ * Appending a batch costs one rowsInserted notification and is O(1) amortized per
+ * message, whatever the length of the history; nothing already stored is touched.
+ */
+class ChatLogModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+private: // Fields
+    std::vector<ChatMessage> m_messages;   ///< The history, oldest first.
+
+public:
+    /**
+     * @brief Constructs an empty log.
+     * @param parent The parent QObject.
+     */
+    explicit ChatLogModel(QObject* parent = nullptr);
+    /**
+     * @brief rowCount
+     * @return The number of messages (0 for any valid parent, the model is a flat list).
+     */
+    int rowCount(const QModelIndex& parent = QModelIndex())             const override;
+    /**
+     * @brief data
+     * @return "sender: body" (or "[channel] sender: body") for Qt::DisplayRole, an
+     *         invalid QVariant otherwise.
+     */
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    /**
+     * @brief message Direct access for the view, without going through QVariant.
+     * @param row A row smaller than rowCount().
+     * @return The message.
+     */
+    const ChatMessage& message(const int row)                           const noexcept;
+    /**
+     * @brief appendMessages Appends a batch of messages at the end of the log.
+     * @param messages The messages, oldest first.
+     */
+    void appendMessages(const QList<ChatMessage>& messages);
+    /**
+     * @brief clear Removes all the messages.
+     */
+    void clear();
+};
+
+#endif // CHAT_LOG_MODEL_H
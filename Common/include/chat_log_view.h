@@ -0,0 +1,99 @@
+#ifndef CHAT_LOG_VIEW_H
+#define CHAT_LOG_VIEW_H
+
+#include <QAbstractScrollArea>
+#include <QPaintEvent>
+#include <QTextDocument>
+
+#include "chat_log_model.h"
+
+#include <vector>
+
+
+/**
+ * @class ChatLogView
+ * @brief Scrollable view of a ChatLogModel that lays out and paints only the visible rows.
+ *
+ * The view scrolls per message: the scroll bar value is the row shown at the bottom of
+ * the viewport, so the range is known without measuring the history. Row heights are
+ * measured only when a row is painted and are cached for the current width. Appending
+ * messages therefore costs O(1) regardless of the history length; if the view was at
+ * the bottom it follows the new messages, otherwise it stays where the user scrolled.
+ */
+class ChatLogView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+private: // Fields
+    static constexpr int ROW_SPACING = 2;   ///< Vertical gap between two messages, in pixels.
+
+    /**
+     * @struct RowHeight
+     * @brief Cached height of a row, valid only for the width it was measured at.
+     */
+    struct RowHeight
+    {
+        int width;    ///< Width used for the layout, -1 if never measured.
+        int height;   ///< Height of the laid out message.
+    };
+
+    ChatLogModel*          m_model;     ///< The messages; not owned.
+    std::vector<RowHeight> m_heights;   ///< One entry per row of the model.
+
+private: // Methods
+    /**
+     * @brief toHtml Presentation of a message: time, colored sender and escaped body.
+     */
+    static QString toHtml(const ChatMessage& message);
+    /**
+     * @brief layoutMessage Lays out a row at the given width.
+     */
+    void layoutMessage(QTextDocument& document, const int row, const int width) const;
+    /**
+     * @brief rowHeight Height of a row at the given width, measured on first use.
+     */
+    int rowHeight(const int row, const int width);
+
+private slots:
+    /**
+     * @brief onRowsInserted Extends the scroll range and follows the new rows if the
+     *        view was at the bottom.
+     */
+    void onRowsInserted(const QModelIndex& parent, const int first, const int last);
+    /**
+     * @brief onModelReset Drops the cached heights and goes back to the top.
+     */
+    void onModelReset();
+
+protected:
+    /**
+     * @brief paintEvent Paints the rows that fit in the viewport, upwards from the bottom row.
+     */
+    void paintEvent(QPaintEvent* event) override;
+    /**
+     * @brief scrollContentsBy Repaints the viewport; the content is not a pixel surface.
+     */
+    void scrollContentsBy(int dx, int dy) override;
+
+public:
+    /**
+     * @brief Constructs a view without a model.
+     * @param parent The parent widget.
+     */
+    explicit ChatLogView(QWidget* parent = nullptr);
+    /**
+     * @brief setModel Shows the given model; the view does not take ownership.
+     */
+    void setModel(ChatLogModel* model);
+    /**
+     * @brief model
+     * @return The shown model, or nullptr.
+     */
+    ChatLogModel* model()                                   const noexcept;
+    /**
+     * @brief scrollToBottom Shows the latest message.
+     */
+    void scrollToBottom();
+};
+
+#endif // CHAT_LOG_VIEW_H
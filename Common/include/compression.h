@@ -0,0 +1,106 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include "frame.h"
+#include "message_record.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+
+/**
+ * @namespace Compression
+ * @brief Compression of large messages, with the codecs found at build time.
+ *
+ * Each codec is compiled in only if its library was found: deflate (zlib,
+ * LANCHAT_HAVE_ZLIB), LZ4 (LANCHAT_HAVE_LZ4) and zstd (LANCHAT_HAVE_ZSTD). The two
+ * sides of a connection tell each other which codecs they can decode with a Hello
+ * record, and a sender only uses a codec its peer listed.
+ *
+ * A message is compressed whole: its record payload becomes the body of a
+ * Compressed record,
+ *
+ *     offset 0   u8   codec
+ *     offset 1   u32  size of the original payload (big-endian)
+ *     offset 5        the compressed payload
+ *
+ * whose timestamp and sequence are those of the original, so that a receiver can
+ * order and deduplicate it before decompressing it.
+ */
+namespace Compression
+{
+    /**
+     * @brief Codec of a Compressed record; the value is written on the wire.
+     */
+    enum class Codec : std::uint8_t
+    {
+        None    = 0,   ///< Not compressed.
+        Deflate = 1,   ///< zlib, at its fastest level.
+        Lz4     = 2,   ///< LZ4, default acceleration.
+        Zstd    = 3    ///< zstd, at its fastest regular level.
+    };
+
+    using CodecSet = std::uint8_t;   ///< Set of codecs, bit (1 << codec) per codec.
+
+    constexpr std::size_t HEADER_SIZE       = 5;      ///< Codec and original size, before the data.
+    constexpr std::size_t DEFAULT_THRESHOLD = 1024;   ///< Smaller payloads are sent as they are.
+
+    /**
+     * @brief available
+     * @return The codecs compiled in, which this side can both compress and decompress.
+     */
+    CodecSet available()                                                            noexcept;
+    /**
+     * @brief contains
+     * @return True if the set holds the codec (never for Codec::None).
+     */
+    bool contains(const CodecSet codecs, const Codec codec)                         noexcept;
+    /**
+     * @brief preferred
+     * @return The preferred codec of the set (zstd, then LZ4, then deflate), or
+     *         Codec::None if the set is empty.
+     */
+    Codec preferred(const CodecSet codecs)                                          noexcept;
+    /**
+     * @brief name
+     * @return The name of a codec: "none", "deflate", "lz4" or "zstd".
+     */
+    std::string_view name(const Codec codec)                                        noexcept;
+    /**
+     * @brief fromName Parses the name of a codec; "off" is the same as "none".
+     * @return The codec, or nullopt if the name is unknown.
+     */
+    std::optional<Codec> fromName(std::string_view name)                            noexcept;
+    /**
+     * @brief names
+     * @return The codecs of a set as the comma-separated list of a Hello record,
+     *         preferred first.
+     */
+    std::string names(const CodecSet codecs);
+    /**
+     * @brief parseNames Reads the list of a Hello record; unknown names are skipped,
+     *        so that a newer peer can list codecs this side does not know.
+     * @return The codecs of the list.
+     */
+    CodecSet parseNames(std::string_view list)                                      noexcept;
+    /**
+     * @brief compress Compresses a record payload into a Compressed record.
+     * @param payload The payload of a valid record.
+     * @param codec An available codec.
+     * @return The frame of the Compressed record, or an empty frame if the payload
+     *         is not a record, the codec failed or the result is not smaller.
+     */
+    SharedFrame compress(std::string_view payload, const Codec codec);
+    /**
+     * @brief decompress Restores the payload of a Compressed record.
+     * @param record The Compressed record.
+     * @param out Receives the original payload; its capacity is reused between calls.
+     * @return False if the body is invalid or its codec is not available.
+     */
+    bool decompress(const MessageRecord& record, std::string& out);
+}
+
+#endif // COMPRESSION_H
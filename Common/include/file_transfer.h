@@ -0,0 +1,121 @@
+#ifndef FILE_TRANSFER_H
+#define FILE_TRANSFER_H
+
+#include "frame.h"
+#include "message_record.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+
+/**
+ * @namespace FileTransfer
+ * @brief Records of the file transfers, which share the connection with the chat.
+ *
+ * A file travels as a FileOffer record followed by FileChunk records, in order,
+ * all of them carrying the id the sender drew for the transfer:
+ *
+ *     FileOffer   offset 0   u64  id
+ *                 offset 8   u64  size of the file
+ *                 offset 16       name of the file, UTF-8, without any directory
+ *     FileChunk   offset 0   u64  id
+ *                 offset 8   u64  offset of the data in the file
+ *                 offset 16       data, at most CHUNK_SIZE bytes
+ *     FileFetch   offset 0   u64  id of a file stored by the server
+ *
+ * (offsets in the record body, integers big-endian). A file is complete once its
+ * chunks covered its size; a chunk that does not start where the previous one
+ * ended means that the receiver lost a part of it. A FileOffer with an empty name
+ * answers a FileFetch for a file the server does not have.
+ *
+ * The chunks are small enough to go behind the chat messages: a chat message
+ * queued after a chunk waits for that chunk only, never for the rest of the file.
+ *
+ * The offer and the chunks of a file sent to a channel (see Channel) all carry it
+ * in their record header, and the server routes them like the chat messages.
+ */
+namespace FileTransfer
+{
+    constexpr std::size_t CHUNK_SIZE        = 64 * 1024;   ///< Largest data of a chunk.
+    constexpr std::size_t HEADER_SIZE       = 16;          ///< Id and size (or offset) before the name (or data).
+    constexpr std::size_t CHUNK_HEADER_SIZE = MessageRecord::HEADER_SIZE + HEADER_SIZE;   ///< Payload before the data
+                                                                                         ///< of a chunk.
+
+    /**
+     * @struct Offer
+     * @brief The body of a FileOffer record.
+     */
+    struct Offer
+    {
+        std::uint64_t    id   = 0;   ///< Id of the transfer.
+        std::uint64_t    size = 0;   ///< Size of the file.
+        std::string_view name;       ///< Name of the file, empty if the file is not available.
+    };
+
+    /**
+     * @struct Chunk
+     * @brief The body of a FileChunk record.
+     */
+    struct Chunk
+    {
+        std::uint64_t    id     = 0;   ///< Id of the transfer.
+        std::uint64_t    offset = 0;   ///< Offset of the data in the file.
+        std::string_view data;         ///< The data.
+    };
+
+    /**
+     * @brief decodeOffer Reads the body of a FileOffer record.
+     * @return False if the body is too short.
+     */
+    bool decodeOffer(const MessageRecord& record, Offer& offer)                        noexcept;
+    /**
+     * @brief decodeChunk Reads the body of a FileChunk record.
+     * @return False if the body is too short or its data larger than CHUNK_SIZE.
+     */
+    bool decodeChunk(const MessageRecord& record, Chunk& chunk)                        noexcept;
+    /**
+     * @brief decodeFetch Reads the body of a FileFetch record.
+     * @return False if the body is too short.
+     */
+    bool decodeFetch(const MessageRecord& record, std::uint64_t& id)                   noexcept;
+    /**
+     * @brief offerFrame Encodes a FileOffer record.
+     * @param sender Nickname of the sender.
+     * @param offer The offer; the name is reduced with safeName().
+     * @param channel Where the file goes, empty for everyone.
+     */
+    SharedFrame offerFrame(std::string_view sender, const Offer& offer, std::string_view channel = {});
+    /**
+     * @brief fetchFrame Encodes a FileFetch record.
+     * @param id Id of the stored file.
+     */
+    SharedFrame fetchFrame(const std::uint64_t id);
+    /**
+     * @brief chunkHeaderSize
+     * @return The payload before the data of a chunk sent to a channel:
+     *         CHUNK_HEADER_SIZE plus the channel.
+     */
+    std::size_t chunkHeaderSize(std::string_view channel)                              noexcept;
+    /**
+     * @brief encodeChunkHeader Writes the record header and the id and offset of a
+     *        chunk (no sender), so that its data can follow directly.
+     * @param out Destination, at least chunkHeaderSize(channel) bytes long.
+     * @param id Id of the transfer.
+     * @param offset Offset of the data in the file.
+     * @param channel Where the file goes, empty for everyone.
+     */
+    void encodeChunkHeader(std::uint8_t* out, const std::uint64_t id, const std::uint64_t offset,
+                           std::string_view channel = {})                              noexcept;
+    /**
+     * @brief safeName Reduces the name of a received file to something that can be
+     *        created in a directory: the last path component, without control
+     *        characters, never empty, "." or "..".
+     * @param name The name from an offer.
+     * @return The name to create the file with.
+     */
+    std::string safeName(std::string_view name);
+}
+
+#endif // FILE_TRANSFER_H
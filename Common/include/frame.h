@@ -0,0 +1,217 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <boost/asio/buffer.hpp>
+
+#include "buffer_pool.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+
+/**
+ * @namespace Frame
+ * @brief Wire format shared by the server and the client.
+ *
+ * Every message travels as a frame: a 4-byte big-endian payload length followed
+ * by the payload itself. TCP is a byte stream, so the length header is the only
+ * thing that tells the receiver where one message ends and the next one begins.
+ */
+namespace Frame
+{
+    constexpr std::size_t   HEADER_SIZE      = 4;          ///< Size of the length prefix in bytes.
+    constexpr std::uint32_t MAX_PAYLOAD_SIZE = 1u << 24;   ///< Frames larger than 16 MiB are rejected.
+
+    /**
+     * @brief encodeHeader Writes the big-endian length prefix.
+     * @param out Destination, at least HEADER_SIZE bytes long.
+     * @param payload_size Size of the payload that follows the header.
+     */
+    void encodeHeader(std::uint8_t* out, const std::uint32_t payload_size) noexcept;
+    /**
+     * @brief decodeHeader Reads the big-endian length prefix.
+     * @param in Source, at least HEADER_SIZE bytes long.
+     * @return The payload size announced by the header.
+     */
+    std::uint32_t decodeHeader(const std::uint8_t* in)                     noexcept;
+}
+
+
+/**
+ * @class SharedFrame
+ * @brief An encoded frame (header + payload) that is immutable and reference counted.
+ *
+ * The header, the payload and the reference count live in a single allocation.
+ * Copies share the same bytes, so a message sent to N clients is encoded and
+ * allocated once, and every write queue holds a reference to it.
+ */
+class SharedFrame
+{
+private: // Fields
+    std::shared_ptr<const std::uint8_t[]> m_data;   ///< Header followed by the payload.
+    std::size_t                           m_size;   ///< Size of the whole frame.
+
+    SharedFrame(std::shared_ptr<const std::uint8_t[]> data, const std::size_t size) noexcept;
+
+public:
+    /**
+     * @brief Constructs an empty frame.
+     */
+    SharedFrame()                                                 noexcept;
+    /**
+     * @brief encode Builds a complete frame (header + payload).
+     * @param payload The message to be framed.
+     * @return The frame to be written on the socket.
+     */
+    static SharedFrame encode(std::string_view payload);
+    /**
+     * @brief create Builds a frame whose payload is written in place by the caller,
+     *        so a serialized message needs no buffer of its own.
+     * @param payload_size Exact size of the payload.
+     * @param write_payload Callable taking std::uint8_t*; it must write payload_size bytes.
+     * @return The frame to be written on the socket.
+     */
+    template<typename F>
+    static SharedFrame create(const std::size_t payload_size, F&& write_payload)
+    {
+        const std::size_t size = Frame::HEADER_SIZE + payload_size;
+
+        // A single allocation holds the reference count, the header and the payload;
+        // it comes from the buffer pool and returns to it with the last reference.
+        std::shared_ptr<std::uint8_t[]> data =
+            std::allocate_shared_for_overwrite<std::uint8_t[]>(PoolAllocator<std::uint8_t>(), size);
+
+        Frame::encodeHeader(data.get(), static_cast<std::uint32_t>(payload_size));
+        write_payload(data.get() + Frame::HEADER_SIZE);
+
+        return SharedFrame(std::move(data), size);
+    }
+    /**
+     * @brief buffer
+     * @return The whole frame, as it is written on the socket.
+     */
+    boost::asio::const_buffer buffer()                      const noexcept;
+    /**
+     * @brief payload
+     * @return The payload, without the header.
+     */
+    std::string_view payload()                              const noexcept;
+    /**
+     * @brief size
+     * @return The size of the whole frame.
+     */
+    std::size_t size()                                      const noexcept;
+    /**
+     * @brief Checks whether the frame holds any data.
+     */
+    explicit operator bool()                                const noexcept;
+};
+
+
+/**
+ * @class FrameDecoder
+ * @brief Streaming decoder that splits the received byte stream into frames.
+ *
+ * The decoder owns the receive buffer. A read operation fills the region returned
+ * by prepare(), reports the number of bytes through commit() and then calls next()
+ * until it stops returning Status::Ok. A single read may contain several frames or
+ * only a part of one; incomplete frames are kept until the rest arrives.
+ *
+ * The size of the buffer follows the traffic: it doubles (up to MAX_READ_SIZE)
+ * after every read that fills it, and halves (down to MIN_READ_SIZE) after a run
+ * of reads that use less than a quarter of it. release() gives the buffer back to
+ * the pool when no partial frame is pending, so an idle connection holds none; the
+ * next prepare() takes a new one. A frame larger than the buffer always gets room.
+ *
+ * The payloads returned by next() are views into the receive buffer and remain
+ * valid only until the following call to prepare(), append() or release().
+ */
+class FrameDecoder
+{
+public:
+    static constexpr std::size_t MIN_READ_SIZE = 1024;                        ///< Smallest buffer.
+    static constexpr std::size_t MAX_READ_SIZE = BufferPool::MAX_BLOCK_SIZE;  ///< Largest buffer grown by reads.
+    static constexpr std::size_t SHRINK_AFTER  = 8;   ///< Short reads in a row before the buffer halves.
+
+    /**
+     * @brief Result of a call to next().
+     */
+    enum class Status
+    {
+        Ok,         ///< A complete frame was extracted.
+        NeedMore,   ///< The buffer holds no complete frame.
+        Oversized   ///< The peer announced a frame larger than Frame::MAX_PAYLOAD_SIZE.
+    };
+
+private: // Fields
+    std::uint8_t* m_data;         ///< Receive buffer, from the buffer pool (nullptr if released).
+    std::size_t   m_capacity;     ///< Size of the receive buffer.
+    std::size_t   m_begin;        ///< Start of the data not yet consumed by next().
+    std::size_t   m_end;          ///< End of the data received so far.
+    std::size_t   m_prepared;     ///< Size of the region returned by the last prepare().
+    std::size_t   m_readSize;     ///< Buffer size wanted for the next reads; adapts to the traffic.
+    std::size_t   m_shortReads;   ///< Reads in a row that used less than a quarter of m_readSize.
+
+private: // Methods
+    /**
+     * @brief reallocate Moves the pending bytes to the front of a new buffer.
+     * @param capacity Size of the new buffer, at least the number of pending bytes.
+     */
+    void reallocate(const std::size_t capacity);
+
+public:
+    /**
+     * @brief Constructs a decoder. No buffer is allocated before the first prepare().
+     * @param read_size Initial buffer size.
+     */
+    explicit FrameDecoder(const std::size_t read_size = 4096);
+    FrameDecoder(const FrameDecoder&)            = delete;
+    FrameDecoder& operator=(const FrameDecoder&) = delete;
+    /**
+     * @brief Returns the buffer to the pool.
+     */
+    ~FrameDecoder();
+    /**
+     * @brief prepare Makes room for the next read. Consumed bytes are discarded and
+     *        the buffer grows if the pending frame does not fit in it.
+     * @return The writable region to be passed to async_read_some.
+     */
+    boost::asio::mutable_buffer prepare();
+    /**
+     * @brief commit Marks bytes written by the last read as received.
+     * @param bytes The number of bytes transferred by the read.
+     */
+    void commit(const std::size_t bytes)                noexcept;
+    /**
+     * @brief append Copies received bytes that did not fit in the prepared region
+     *        (the second buffer of a scatter read), growing the buffer. Must follow
+     *        a commit() of the whole prepared region.
+     * @param data The bytes.
+     * @param size The number of bytes.
+     */
+    void append(const std::uint8_t* data, const std::size_t size);
+    /**
+     * @brief next Extracts the next complete frame.
+     * @param payload Receives a view of the frame payload when Status::Ok is returned.
+     * @return The decoding status.
+     */
+    Status next(std::string_view& payload)              noexcept;
+    /**
+     * @brief release Returns the buffer to the pool if it holds no pending bytes.
+     * @return True if the decoder holds no buffer anymore.
+     */
+    bool release()                                      noexcept;
+    /**
+     * @brief reset Drops all buffered data (used when the connection is reset).
+     */
+    void reset()                                        noexcept;
+    /**
+     * @brief capacity
+     * @return The size of the receive buffer currently held (0 once released).
+     */
+    std::size_t capacity()                              const noexcept;
+};
+
+#endif // FRAME_H
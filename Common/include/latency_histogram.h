@@ -0,0 +1,136 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+
+
+/**
+ * @class LatencyHistogram
+ * @brief Fixed-size log-linear histogram of durations in nanoseconds.
+ *
+ * Every power of two is split into 16 buckets, so a percentile is reported with a
+ * relative error below 1/16 whatever its magnitude, and recording is a couple of
+ * instructions without any allocation. The histogram is not thread safe: every
+ * producer records into its own and the results are merged at the end.
+ *
+ * The bucket layout is public so that other recorders (the server metrics keep
+ * their buckets in atomics) can be copied into a histogram to be summarized.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr unsigned    SUB_BUCKET_BITS  = 4;
+    static constexpr std::size_t SUB_BUCKETS      = std::size_t(1) << SUB_BUCKET_BITS;
+    static constexpr std::size_t BUCKET_NUM       = 64 * SUB_BUCKETS;
+
+private: // Fields
+    std::array<std::uint64_t, BUCKET_NUM> m_buckets{};   ///< Number of values per bucket.
+    std::uint64_t                         m_count = 0;   ///< Number of recorded values.
+    std::uint64_t                         m_max   = 0;   ///< Largest recorded value.
+
+public:
+    /**
+     * @brief bucketOf
+     * @return The index of the bucket holding a value.
+     */
+    static std::size_t bucketOf(const std::uint64_t value) noexcept
+    {
+        if(value < SUB_BUCKETS)
+            return static_cast<std::size_t>(value);
+
+        const unsigned msb   = 63u - static_cast<unsigned>(std::countl_zero(value));
+        const unsigned shift = msb - SUB_BUCKET_BITS;
+
+        return (msb - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + ((value >> shift) & (SUB_BUCKETS - 1));
+    }
+    /**
+     * @brief upperBoundOf
+     * @return The largest value held by a bucket.
+     */
+    static std::uint64_t upperBoundOf(const std::size_t bucket) noexcept
+    {
+        const std::size_t exponent = bucket / SUB_BUCKETS;
+        const std::size_t mantissa = bucket % SUB_BUCKETS;
+
+        if(exponent == 0)
+            return mantissa;
+
+        return ((SUB_BUCKETS + mantissa + 1) << (exponent - 1)) - 1;
+    }
+    /**
+     * @brief record Adds a value.
+     * @param nanoseconds The measured duration.
+     */
+    void record(const std::uint64_t nanoseconds) noexcept
+    {
+        ++m_buckets[bucketOf(nanoseconds)];
+        ++m_count;
+
+        if(nanoseconds > m_max)
+            m_max = nanoseconds;
+    }
+    /**
+     * @brief add Adds values to a bucket without knowing them exactly; the largest
+     *        one is taken to be the upper bound of the bucket.
+     * @param bucket Index of the bucket, smaller than BUCKET_NUM.
+     * @param count Number of values.
+     */
+    void add(const std::size_t bucket, const std::uint64_t count) noexcept
+    {
+        if(count == 0)
+            return;
+
+        m_buckets[bucket] += count;
+        m_count           += count;
+
+        if(upperBoundOf(bucket) > m_max)
+            m_max = upperBoundOf(bucket);
+    }
+    /**
+     * @brief merge Adds all the values of another histogram.
+     */
+    void merge(const LatencyHistogram& other) noexcept
+    {
+        for(std::size_t i = 0; i < BUCKET_NUM; ++i)
+            m_buckets[i] += other.m_buckets[i];
+
+        m_count += other.m_count;
+
+        if(other.m_max > m_max)
+            m_max = other.m_max;
+    }
+    /**
+     * @brief percentile
+     * @param fraction Between 0 and 1 (0.99 for p99).
+     * @return An upper bound of the percentile, or 0 if the histogram is empty.
+     */
+    std::uint64_t percentile(const double fraction) const noexcept
+    {
+        if(m_count == 0)
+            return 0;
+
+        // The rank of the value, 1-based, rounded up.
+        std::uint64_t rank = static_cast<std::uint64_t>(fraction * static_cast<double>(m_count) + 0.999999);
+        rank = rank == 0 ? 1 : (rank > m_count ? m_count : rank);
+
+        std::uint64_t seen = 0;
+
+        for(std::size_t i = 0; i < BUCKET_NUM; ++i)
+        {
+            seen += m_buckets[i];
+
+            if(seen >= rank)
+                return upperBoundOf(i) < m_max ? upperBoundOf(i) : m_max;
+        }
+
+        return m_max;
+    }
+
+    std::uint64_t count()                                    const noexcept { return m_count; }
+    std::uint64_t max()                                      const noexcept { return m_max; }
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,89 @@
+#ifndef MESSAGE_INBOX_H
+#define MESSAGE_INBOX_H
+
+#include "spsc_ring.h"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_guard.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+/**
+ * @class MessageInbox
+ * @brief Hands the received messages from the network threads to a single consumer
+ *        (the GUI thread) in batches.
+ *
+ * Every producer (a shard of the server, or the client connection) has its own
+ * SpscRing, so pushing a message takes no lock and, once the ring slots have grown,
+ * no allocation. The consumer is woken up once per burst: the wakeup callback is
+ * called only by the push that finds the inbox idle, and the consumer then drains
+ * everything that arrived in the meantime.
+ *
+ * When a ring is full the producer does not wait for the consumer: the messages go
+ * to an overflow list guarded by a mutex until the consumer catches up. Messages
+ * of the same producer are always drained in order.
+ */
+class MessageInbox
+{
+public:
+    using Wakeup   = std::function<void()>;
+    using Consumer = std::function<void(std::string_view)>;
+
+    static constexpr std::size_t DEFAULT_RING_CAPACITY = 4096;   ///< Messages per producer before overflowing.
+
+private: // Fields
+    struct Producer
+    {
+        SpscRing<std::string>   ring;          ///< Lock-free path.
+        std::deque<std::string> overflow;      ///< Messages that did not fit in the ring.
+        std::atomic<bool>       overflowing;   ///< True while overflow is not empty.
+        boost::mutex            mutex;         ///< Guards overflow.
+
+        explicit Producer(const std::size_t capacity) : ring(capacity), overflowing(false) {}
+    };
+
+    std::vector<std::unique_ptr<Producer>> m_producers;   ///< One entry per producer.
+    std::atomic<bool>                      m_pending;     ///< A wakeup was sent and not yet handled.
+    Wakeup                                 m_wakeup;      ///< Schedules drain() on the consumer thread.
+
+private: // Methods
+    /**
+     * @brief notify Calls the wakeup callback unless a wakeup is already pending.
+     */
+    void notify()                                                           noexcept;
+
+public:
+    /**
+     * @brief Constructs an empty inbox.
+     * @param producer_num Number of producers.
+     * @param wakeup Called from a producer thread when the consumer must drain the inbox.
+     * @param ring_capacity Capacity of each producer's ring.
+     */
+    MessageInbox(const std::size_t producer_num, Wakeup wakeup,
+                 const std::size_t ring_capacity = DEFAULT_RING_CAPACITY);
+    /**
+     * @brief push Producer side. Copies a message into the inbox.
+     * @param producer Index of the producer, smaller than the producer_num given to the constructor.
+     * @param message The message; it can be released as soon as push returns.
+     */
+    void push(const std::size_t producer, std::string_view message)               noexcept;
+    /**
+     * @brief drain Consumer side. Passes the queued messages to consume, oldest first
+     *        for every producer.
+     * @param consume Called for every message; the view is valid only during the call.
+     * @param max_messages Maximum number of messages to drain. If more are left, the
+     *        wakeup callback is called again so the consumer can yield in between.
+     * @return The number of drained messages.
+     */
+    std::size_t drain(const Consumer& consume, const std::size_t max_messages);
+};
+
+#endif // MESSAGE_INBOX_H
@@ -0,0 +1,120 @@
+#ifndef MESSAGE_RECORD_H
+#define MESSAGE_RECORD_H
+
+#include "frame.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+
+/**
+ * @struct MessageRecord
+ * @brief A chat message as it travels in the payload of a frame.
+ *
+ * Layout of version 3 (integers are big-endian, like the frame header):
+ *
+ *     offset 0            u8   version
+ *     offset 1            u8   type
+ *     offset 2            u8   header size (offset of the sender, 21 + channel size in version 3)
+ *     offset 3            u8   sender size
+ *     offset 4            u64  timestamp, milliseconds since the Unix epoch (UTC)
+ *     offset 12           u64  sequence number in the server log (since version 2)
+ *     offset 20           u8   channel size (since version 3)
+ *     offset 21                channel, UTF-8 (since version 3)
+ *     header size         sender, UTF-8
+ *     header + sender     body, UTF-8, up to the end of the payload
+ *
+ * Version 1 ends its header at offset 12, version 2 at offset 20. Later versions may
+ * only append fields to the header; thanks to the header size a decoder skips the
+ * fields it does not know, and reads 0 (or nothing) for the fields an older encoder
+ * did not write. The channel is part of the header, so an older decoder sees a
+ * message to a channel as an ordinary one.
+ *
+ * The channel addresses the message: empty for everyone, "#name" for the members
+ * of a room, "@nickname" for the clients that joined that nickname (see Channel).
+ * The record holds views: encode()
+ * writes into a buffer of the caller and decode() points into the payload, so
+ * neither of them allocates. Presentation (colors, markup) is up to the receiver.
+ */
+struct MessageRecord
+{
+    /**
+     * @brief Kind of message.
+     */
+    enum class Type : std::uint8_t
+    {
+        Chat       = 1,   ///< Written by a client.
+        Broadcast  = 2,   ///< Written by the operator of the server.
+        History    = 3,   ///< Sent by a client to replay the server log: the messages after
+                          ///< sequence, at most as many as the body says in decimal (the
+                          ///< server's limit if the body is empty). Never relayed. The server
+                          ///< ends its reply with a History record whose sequence is the last
+                          ///< one of the log when the replay started.
+        Heartbeat  = 4,   ///< Sent by either side after a silence, to show that it is alive.
+                          ///< Carries nothing and is never relayed or shown.
+        Hello      = 5,   ///< Sent by either side when the connection starts: the body lists the
+                          ///< compression codecs the sender can decode (see Compression). The
+                          ///< server answers with its own. Never relayed or shown.
+        Compressed = 6,   ///< Another record, compressed (see Compression); its timestamp and
+                          ///< sequence are those of the original.
+        FileOffer  = 7,   ///< Starts the transfer of a file: id, size and name (see FileTransfer).
+                          ///< Relayed, never logged.
+        FileChunk  = 8,   ///< A piece of a file being transferred, in order. Relayed behind the
+                          ///< chat messages, never logged or shown.
+        FileFetch  = 9,   ///< Sent by a client to get a file stored by the server, which answers
+                          ///< with its FileOffer and its chunks.
+        Join       = 10,  ///< Sent by a client to receive the messages of the channel of the
+                          ///< record from now on. Never relayed.
+        Leave      = 11   ///< Sent by a client to stop receiving the messages of the channel of
+                          ///< the record. Never relayed. Sent by the server to refuse a Join:
+                          ///< the nickname belongs to another client, or the client joined
+                          ///< too many channels.
+    };
+
+    static constexpr std::uint8_t VERSION          = 3;     ///< Version written by encode().
+    static constexpr std::size_t  HEADER_SIZE      = 21;    ///< Fixed header size of VERSION (without the channel).
+    static constexpr std::size_t  MIN_HEADER_SIZE  = 12;    ///< Fixed header size of version 1.
+    static constexpr std::size_t  MAX_SENDER_SIZE  = 255;   ///< Longer senders are truncated.
+    static constexpr std::size_t  MAX_CHANNEL_SIZE = 64;    ///< Longer channels are truncated.
+
+    Type             type      = Type::Chat;   ///< Kind of message.
+    std::uint64_t    timestamp = 0;            ///< Milliseconds since the Unix epoch (UTC).
+    std::uint64_t    sequence  = 0;            ///< Position in the server log, 0 if not logged.
+    std::string_view channel;                  ///< Where the message goes, empty for everyone.
+    std::string_view sender;                   ///< Nickname of the author, UTF-8.
+    std::string_view body;                     ///< Text of the message, UTF-8.
+
+    /**
+     * @brief now
+     * @return The current time, in the unit of the timestamp field.
+     */
+    static std::uint64_t now()                                                   noexcept;
+    /**
+     * @brief encodedSize
+     * @return The number of bytes written by encode().
+     */
+    std::size_t encodedSize()                                              const noexcept;
+    /**
+     * @brief encode Serializes the record. A sender longer than MAX_SENDER_SIZE bytes, or a
+     *        channel longer than MAX_CHANNEL_SIZE bytes, is truncated on a UTF-8
+     *        character boundary.
+     * @param out Destination, at least encodedSize() bytes long.
+     */
+    void encode(std::uint8_t* out)                                         const noexcept;
+    /**
+     * @brief toFrame Serializes the record directly into a new frame (one allocation).
+     * @return The frame to be written on the socket.
+     */
+    SharedFrame toFrame()                                                  const;
+    /**
+     * @brief decode Parses a frame payload. Unknown types are accepted; the caller decides
+     *        what to do with them.
+     * @param payload The payload; the views of the record point into it.
+     * @param record Receives the decoded fields.
+     * @return False if the payload is not a valid record.
+     */
+    static bool decode(std::string_view payload, MessageRecord& record)          noexcept;
+};
+
+#endif // MESSAGE_RECORD_H
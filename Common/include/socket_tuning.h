@@ -0,0 +1,91 @@
+#ifndef SOCKET_TUNING_H
+#define SOCKET_TUNING_H
+
+#include <boost/asio/ip/tcp.hpp>
+
+#include <chrono>
+#include <optional>
+#include <string_view>
+
+
+/**
+ * @struct SocketTuning
+ * @brief TCP options of the chat connections, set on the sockets of both ends.
+ *
+ * Two profiles cover the usual needs:
+ *
+ * - "low-latency" (the default of the server and the client): TCP_NODELAY, so a
+ *   short message leaves at once instead of waiting for the acknowledgement of
+ *   the previous one; TCP_QUICKACK, so the peer's messages are acknowledged at
+ *   once (Linux clears it when it returns to delayed acknowledgements, so the
+ *   readers set it again after every read, see rearm());
+ *   TCP_NOTSENT_LOWAT of 16 KiB, so a message never waits behind more than that
+ *   in the kernel; and keepalive probes after 60 s of silence, which keep NAT and
+ *   firewall entries alive.
+ * - "bulk": Nagle's algorithm on and no limit on the unsent data, for links that
+ *   mostly carry files and where throughput matters more than the delay of a
+ *   single message.
+ *
+ * "system" sets nothing and leaves every option to the system. The buffer sizes
+ * are 0 (autotuning) in every profile: on Linux a fixed size turns autotuning off
+ * and is capped by net.core.wmem_max and rmem_max, usually far below what
+ * autotuning reaches.
+ *
+ * An option the platform lacks (TCP_QUICKACK and TCP_NOTSENT_LOWAT are Linux
+ * ones, the keepalive timings are missing on some systems) is skipped.
+ */
+struct SocketTuning
+{
+    bool                 no_delay            = false;   ///< TCP_NODELAY: small writes leave at once.
+    int                  send_buffer         = 0;       ///< SO_SNDBUF in bytes, 0 for the system's.
+    int                  receive_buffer      = 0;       ///< SO_RCVBUF in bytes, 0 for the system's.
+    bool                 quick_ack           = false;   ///< TCP_QUICKACK: acknowledge without delay.
+    int                  not_sent_lowat      = 0;       ///< TCP_NOTSENT_LOWAT in bytes, 0 for no limit.
+    std::chrono::seconds keep_alive_idle     {0};       ///< Silence before the first keepalive probe,
+                                                        ///< 0 for no keepalive.
+    std::chrono::seconds keep_alive_interval {0};       ///< Between two probes, 0 for the system's.
+    int                  keep_alive_count    = 0;       ///< Unanswered probes before the connection
+                                                        ///< drops, 0 for the system's.
+    int                  backlog             = boost::asio::socket_base::max_listen_connections;
+                                                        ///< Pending connections of the listening socket.
+
+    /**
+     * @brief lowLatency
+     * @return The "low-latency" profile.
+     */
+    static SocketTuning lowLatency()                                                        noexcept;
+    /**
+     * @brief bulk
+     * @return The "bulk" profile.
+     */
+    static SocketTuning bulk()                                                              noexcept;
+    /**
+     * @brief fromName
+     * @return The profile of a name ("system", "low-latency" or "bulk"), or nullopt
+     *         if the name is unknown.
+     */
+    static std::optional<SocketTuning> fromName(std::string_view name)                      noexcept;
+    /**
+     * @brief apply Sets the options on a socket, connected or only open.
+     * @param socket The socket.
+     * @param ec Receives the first error; the other options are set anyway.
+     */
+    void apply(boost::asio::ip::tcp::socket& socket, boost::system::error_code& ec)   const noexcept;
+    /**
+     * @brief rearm Sets again, after a read, the options the kernel does not keep:
+     *        TCP_QUICKACK. Does nothing if the tuning does not ask for it.
+     * @param socket The connected socket.
+     */
+    void rearm(boost::asio::ip::tcp::socket& socket)                                  const noexcept;
+    /**
+     * @brief applyToAcceptor Sets the buffer sizes on a listening socket, before it
+     *        listens, so that the accepted sockets start with them and the window
+     *        scale of their handshake fits the receive buffer.
+     * @param acceptor The open acceptor.
+     * @param ec Receives the first error.
+     */
+    void applyToAcceptor(boost::asio::ip::tcp::acceptor& acceptor,
+                         boost::system::error_code& ec)                               const noexcept;
+};
+
+#endif // SOCKET_TUNING_H
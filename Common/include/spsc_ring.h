@@ -0,0 +1,119 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+
+/**
+ * @class SpscRing
+ * @brief Lock-free ring buffer for exactly one producer thread and one consumer thread.
+ *
+ * The elements are written and read in place: the slots are never destroyed, so an
+ * element that owns memory (a std::string, for instance) keeps its capacity and is
+ * reused by the next push without allocating. The producer only writes m_tail and
+ * the consumer only writes m_head; each of them keeps a cached copy of the other
+ * index, so the shared cache lines are touched only when the ring looks full or empty.
+ *
+ * "One producer" means that pushes never run concurrently and are ordered by
+ * happens-before (for instance, handlers of the same strand), not necessarily that
+ * they come from the same OS thread. The same holds for the consumer.
+ */
+template<typename T>
+class SpscRing
+{
+private: // Fields
+    // A fixed value: std::hardware_destructive_interference_size may differ between
+    // translation units built with different tuning flags.
+    static constexpr std::size_t CACHE_LINE = 64;
+
+    std::vector<T>                               m_slots;        ///< Capacity is a power of two.
+    const std::size_t                            m_mask;         ///< Capacity - 1.
+
+    alignas(CACHE_LINE) std::atomic<std::size_t> m_head;         ///< Next slot to read (written by the consumer).
+    std::size_t                                  m_cachedTail;   ///< Consumer's copy of m_tail.
+
+    alignas(CACHE_LINE) std::atomic<std::size_t> m_tail;         ///< Next slot to write (written by the producer).
+    std::size_t                                  m_cachedHead;   ///< Producer's copy of m_head.
+
+private: // Methods
+    static std::size_t roundUp(const std::size_t capacity) noexcept
+    {
+        std::size_t size = 2;
+
+        while(size < capacity)
+            size <<= 1;
+
+        return size;
+    }
+
+public:
+    /**
+     * @brief Constructs an empty ring.
+     * @param capacity Minimum number of elements; rounded up to a power of two.
+     */
+    explicit SpscRing(const std::size_t capacity)
+        : m_slots(roundUp(capacity)),
+          m_mask(m_slots.size() - 1),
+          m_head(0),
+          m_cachedTail(0),
+          m_tail(0),
+          m_cachedHead(0)
+    {
+    }
+
+    SpscRing(const SpscRing&)            = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /**
+     * @brief tryPush Producer side. Fills the next free slot in place.
+     * @param fill Callable taking T&; it must overwrite the whole element.
+     * @return False, without calling fill, if the ring is full.
+     */
+    template<typename F>
+    bool tryPush(F&& fill)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+
+        if(tail - m_cachedHead == m_slots.size())
+        {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+
+            if(tail - m_cachedHead == m_slots.size())
+                return false;
+        }
+
+        fill(m_slots[tail & m_mask]);
+        m_tail.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+    /**
+     * @brief tryPop Consumer side. Reads the oldest element in place.
+     * @param consume Callable taking T&; the slot is reused after it returns.
+     * @return False, without calling consume, if the ring is empty.
+     */
+    template<typename F>
+    bool tryPop(F&& consume)
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+
+        if(head == m_cachedTail)
+        {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+
+            if(head == m_cachedTail)
+                return false;
+        }
+
+        consume(m_slots[head & m_mask]);
+        m_head.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    std::size_t capacity()                                   const noexcept { return m_slots.size(); }
+};
+
+#endif // SPSC_RING_H
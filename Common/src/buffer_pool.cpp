@@ -0,0 +1,172 @@
+#include "buffer_pool.h"
+
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <new>
+
+namespace
+{
+    // Set when the cache of the thread is destroyed; blocks released later in the
+    // exit of the thread bypass the pool.
+    thread_local bool thread_cache_destroyed = false;
+}
+
+/**
+ * @struct BufferPool::Depot
+ * @brief Free blocks shared by all the threads.
+ */
+struct BufferPool::Depot
+{
+    boost::mutex                       mutex;   ///< Guards lists.
+    std::array<FreeList, CLASS_NUM>    lists;   ///< Free blocks per class.
+};
+
+/**
+ * @struct BufferPool::ThreadCache
+ * @brief Free blocks of one thread. They go back to the depot when the thread exits.
+ */
+struct BufferPool::ThreadCache
+{
+    std::array<FreeList, CLASS_NUM> lists;   ///< Free blocks per class.
+
+    ~ThreadCache()
+    {
+        thread_cache_destroyed = true;
+
+        for(std::size_t i = 0; i < CLASS_NUM; ++i)
+        {
+            while(lists[i].count > 0)
+                BufferPool::release(lists[i], i, lists[i].count);
+        }
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PRIVATE METHODS
+///
+std::size_t BufferPool::classOf(const std::size_t size) noexcept
+{
+    if(size <= MIN_BLOCK_SIZE)
+        return 0;
+
+    return static_cast<std::size_t>(std::bit_width(size - 1)) - std::bit_width(MIN_BLOCK_SIZE - 1);
+}
+
+std::size_t BufferPool::blockSizeOf(const std::size_t size_class) noexcept
+{
+    return MIN_BLOCK_SIZE << size_class;
+}
+
+std::size_t BufferPool::cacheCapacity(const std::size_t size_class) noexcept
+{
+    // At least two, so that a refill of half the cache always brings a block.
+    return std::max<std::size_t>(2, std::min(THREAD_CACHE_SIZE, THREAD_CACHE_BYTES / blockSizeOf(size_class)));
+}
+
+std::size_t BufferPool::depotCapacity(const std::size_t size_class) noexcept
+{
+    return std::max<std::size_t>(1, std::min(DEPOT_SIZE, DEPOT_BYTES / blockSizeOf(size_class)));
+}
+
+BufferPool::ThreadCache* BufferPool::threadCache() noexcept
+{
+    if(thread_cache_destroyed)
+        return nullptr;
+
+    thread_local ThreadCache cache;
+
+    return &cache;
+}
+
+BufferPool::Depot& BufferPool::depot() noexcept
+{
+    // Never destroyed: the caches of threads that outlive main() still return their blocks.
+    static Depot* const depot = new Depot();
+
+    return *depot;
+}
+
+void BufferPool::release(FreeList& list, const std::size_t size_class, const std::size_t n) noexcept
+{
+    FreeList surplus;
+    {
+        Depot& shared = depot();
+        boost::lock_guard<boost::mutex> lckgrd(shared.mutex);
+
+        FreeList& depot_list = shared.lists[size_class];
+        const std::size_t capacity = depotCapacity(size_class);
+        const std::size_t room     = capacity > depot_list.count ? capacity - depot_list.count : 0;
+
+        list.moveTo(depot_list, n < room ? n : room);
+
+        if(n > room)
+            list.moveTo(surplus, n - room);
+    }
+
+    // The depot is full: the rest goes back to the heap, outside the lock.
+    while(surplus.count > 0)
+        ::operator delete(surplus.pop());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+void* BufferPool::allocate(const std::size_t size)
+{
+    if(size > MAX_BLOCK_SIZE)
+        return ::operator new(size);
+
+    const std::size_t size_class = classOf(size);
+    ThreadCache* const cache = threadCache();
+
+    if(!cache)
+        return ::operator new(blockSizeOf(size_class));
+
+    FreeList& list = cache->lists[size_class];
+
+    if(list.count == 0)
+    {
+        // Refilling half of the cache, so that the next allocations are local again.
+        Depot& shared = depot();
+        boost::lock_guard<boost::mutex> lckgrd(shared.mutex);
+
+        shared.lists[size_class].moveTo(list, cacheCapacity(size_class) / 2);
+    }
+
+    if(list.count > 0)
+        return list.pop();
+
+    return ::operator new(blockSizeOf(size_class));
+}
+
+void BufferPool::deallocate(void* block, const std::size_t size) noexcept
+{
+    if(!block)
+        return;
+
+    if(size > MAX_BLOCK_SIZE)
+    {
+        ::operator delete(block);
+        return;
+    }
+
+    ThreadCache* const cache = threadCache();
+
+    if(!cache)
+    {
+        ::operator delete(block);
+        return;
+    }
+
+    const std::size_t size_class = classOf(size);
+    FreeList& list = cache->lists[size_class];
+
+    list.push(static_cast<FreeBlock*>(block));
+
+    // A thread that releases more than it allocates hands half of its cache over.
+    if(list.count > cacheCapacity(size_class))
+        release(list, size_class, cacheCapacity(size_class) / 2);
+}
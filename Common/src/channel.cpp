@@ -0,0 +1,48 @@
+#include "channel.h"
+#include "message_record.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+bool Channel::isValid(std::string_view channel) noexcept
+{
+    if(channel.size() < 2 || channel.size() > MessageRecord::MAX_CHANNEL_SIZE ||
+       (!isRoom(channel) && !isNickname(channel)))
+        return false;
+
+    // Bytes of multi-byte UTF-8 characters are all above 0x7F and pass.
+    for(const char c : channel)
+    {
+        if(static_cast<unsigned char>(c) <= 0x20 || c == 0x7F)
+            return false;
+    }
+
+    return true;
+}
+
+bool Channel::isRoom(std::string_view channel) noexcept
+{
+    return !channel.empty() && channel.front() == ROOM_PREFIX;
+}
+
+bool Channel::isNickname(std::string_view channel) noexcept
+{
+    return !channel.empty() && channel.front() == NICKNAME_PREFIX;
+}
+
+bool Channel::parseCommand(std::string_view input, std::string_view name,
+                           std::string_view& channel, std::string_view& rest) noexcept
+{
+    if(input.size() < name.size() + 2 || input[0] != '/' || input.substr(1, name.size()) != name ||
+       input[name.size() + 1] != ' ')
+        return false;
+
+    input.remove_prefix(name.size() + 2);
+
+    const std::size_t end = input.find(' ');
+
+    channel = input.substr(0, end);
+    rest    = (end == std::string_view::npos) ? std::string_view() : input.substr(end + 1);
+
+    return !channel.empty();
+}
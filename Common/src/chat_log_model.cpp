@@ -0,0 +1,66 @@
+#include "chat_log_model.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// CHAT MESSAGE
+///
+ChatMessage ChatMessage::fromRecord(const MessageRecord& record)
+{
+    ChatMessage message;
+
+    message.type      = record.type;
+    message.timestamp = static_cast<qint64>(record.timestamp);
+    message.channel   = QString::fromUtf8(record.channel.data(), static_cast<int>(record.channel.size()));
+    message.sender    = QString::fromUtf8(record.sender.data(), static_cast<int>(record.sender.size()));
+    message.body      = QString::fromUtf8(record.body.data(), static_cast<int>(record.body.size()));
+
+    return message;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+ChatLogModel::ChatLogModel(QObject* parent) : QAbstractListModel(parent)
+{
+}
+
+int ChatLogModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(m_messages.size());
+}
+
+QVariant ChatLogModel::data(const QModelIndex& index, int role) const
+{
+    if(!index.isValid() || index.row() >= this->rowCount() || role != Qt::DisplayRole)
+        return QVariant();
+
+    const ChatMessage& message = m_messages[static_cast<std::size_t>(index.row())];
+
+    if(!message.channel.isEmpty())
+        return QStringLiteral("[%1] %2: %3").arg(message.channel, message.sender, message.body);
+
+    return message.sender + QLatin1String(": ") + message.body;
+}
+
+const ChatMessage& ChatLogModel::message(const int row) const noexcept
+{
+    return m_messages[static_cast<std::size_t>(row)];
+}
+
+void ChatLogModel::appendMessages(const QList<ChatMessage>& messages)
+{
+    if(messages.isEmpty())
+        return;
+
+    const int first = this->rowCount();
+
+    beginInsertRows(QModelIndex(), first, first + static_cast<int>(messages.size()) - 1);
+    m_messages.insert(m_messages.end(), messages.begin(), messages.end());
+    endInsertRows();
+}
+
+void ChatLogModel::clear()
+{
+    beginResetModel();
+    m_messages.clear();
+    endResetModel();
+}
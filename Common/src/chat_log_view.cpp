@@ -0,0 +1,197 @@
+#include "chat_log_view.h"
+
+#include <QDateTime>
+#include <QPainter>
+#include <QScrollBar>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PRIVATE METHODS
+///
+QString ChatLogView::toHtml(const ChatMessage& message)
+{
+    // Messages written by the operator of the server stand out from the ones of the clients.
+    const QString color = (message.type == MessageRecord::Type::Broadcast) ? QStringLiteral("red")
+                                                                           : QStringLiteral("green");
+    const QString time  = QDateTime::fromMSecsSinceEpoch(message.timestamp).toString(QStringLiteral("HH:mm"));
+
+    // The messages of a room or a direct message show where they were sent.
+    const QString channel = message.channel.isEmpty() ? QString()
+                                                      : QStringLiteral("[%1] ").arg(message.channel.toHtmlEscaped());
+
+    // The text comes from the network, it must never be interpreted as markup.
+    return QStringLiteral("<span style='color: gray;'>%1 %2</span><span style='color: %3;'>%4: </span>%5")
+            .arg(time, channel, color, message.sender.toHtmlEscaped(), message.body.toHtmlEscaped());
+}
+
+void ChatLogView::layoutMessage(QTextDocument& document, const int row, const int width) const
+{
+    document.setDefaultFont(font());
+    document.setDocumentMargin(2);
+    document.setHtml(toHtml(m_model->message(row)));
+    document.setTextWidth(width);
+}
+
+int ChatLogView::rowHeight(const int row, const int width)
+{
+    RowHeight& cached = m_heights[static_cast<std::size_t>(row)];
+
+    if(cached.width != width)
+    {
+        QTextDocument document;
+        this->layoutMessage(document, row, width);
+
+        cached.width  = width;
+        cached.height = static_cast<int>(std::ceil(document.size().height()));
+    }
+
+    return cached.height;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PRIVATE SLOTS
+///
+void ChatLogView::onRowsInserted(const QModelIndex& parent, const int first, const int last)
+{
+    Q_UNUSED(first);
+    Q_UNUSED(last);
+
+    if(parent.isValid())
+        return;
+
+    QScrollBar* scroll_bar = verticalScrollBar();
+    const bool  follow     = scroll_bar->value() == scroll_bar->maximum();
+
+    m_heights.resize(static_cast<std::size_t>(m_model->rowCount()), RowHeight{-1, 0});
+    scroll_bar->setRange(0, m_model->rowCount() - 1);
+
+    if(follow)
+        scroll_bar->setValue(scroll_bar->maximum());
+
+    viewport()->update();
+}
+
+void ChatLogView::onModelReset()
+{
+    m_heights.assign(static_cast<std::size_t>(m_model->rowCount()), RowHeight{-1, 0});
+    verticalScrollBar()->setRange(0, std::max(0, m_model->rowCount() - 1));
+    verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+
+    viewport()->update();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PROTECTED METHODS
+///
+void ChatLogView::paintEvent(QPaintEvent* event)
+{
+    Q_UNUSED(event);
+
+    if(!m_model || m_model->rowCount() == 0)
+        return;
+
+    const int row_count = m_model->rowCount();
+    const int width     = viewport()->width();
+    const int height    = viewport()->height();
+
+    // Rows and the y of their top edge, measured upwards from the bottom row.
+    std::vector<std::pair<int, int>> visible;
+    int y   = height;
+    int row = std::min(verticalScrollBar()->value(), row_count - 1);
+
+    for(; row >= 0 && y > 0; --row)
+    {
+        y -= this->rowHeight(row, width);
+        visible.emplace_back(row, y);
+        y -= ROW_SPACING;
+    }
+
+    if(visible.empty())
+        return;
+
+    // At the top of the history the rows are aligned to the top edge instead, and the
+    // space left below is filled with the following rows.
+    if(row < 0 && visible.back().second > 0)
+    {
+        const int shift = visible.back().second;
+
+        for(auto& row_y : visible)
+            row_y.second -= shift;
+
+        int next_y = height - shift + ROW_SPACING;
+
+        for(int next = visible.front().first + 1; next < row_count && next_y < height; ++next)
+        {
+            visible.emplace_back(next, next_y);
+            next_y += this->rowHeight(next, width) + ROW_SPACING;
+        }
+    }
+
+    QPainter painter(viewport());
+
+    for(const auto& [visible_row, visible_y] : visible)
+    {
+        QTextDocument document;
+        this->layoutMessage(document, visible_row, width);
+
+        painter.save();
+        painter.translate(0, visible_y);
+        document.drawContents(&painter, QRectF(0, 0, width, m_heights[static_cast<std::size_t>(visible_row)].height));
+        painter.restore();
+    }
+}
+
+void ChatLogView::scrollContentsBy(int dx, int dy)
+{
+    Q_UNUSED(dx);
+    Q_UNUSED(dy);
+
+    viewport()->update();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+ChatLogView::ChatLogView(QWidget* parent) : QAbstractScrollArea(parent),
+                                            m_model(nullptr)
+{
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    verticalScrollBar()->setRange(0, 0);
+    verticalScrollBar()->setSingleStep(1);
+    verticalScrollBar()->setPageStep(10);
+}
+
+void ChatLogView::setModel(ChatLogModel* model)
+{
+    if(m_model)
+        disconnect(m_model, nullptr, this, nullptr);
+
+    m_model = model;
+
+    if(m_model)
+    {
+        connect(m_model, &ChatLogModel::rowsInserted, this, &ChatLogView::onRowsInserted);
+        connect(m_model, &ChatLogModel::modelReset, this, &ChatLogView::onModelReset);
+
+        this->onModelReset();
+    }
+    else
+    {
+        m_heights.clear();
+        verticalScrollBar()->setRange(0, 0);
+        viewport()->update();
+    }
+}
+
+ChatLogModel* ChatLogView::model() const noexcept
+{
+    return m_model;
+}
+
+void ChatLogView::scrollToBottom()
+{
+    verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+}
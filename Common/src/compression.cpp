@@ -0,0 +1,332 @@
+#include "compression.h"
+
+#include <array>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#if defined(LANCHAT_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(LANCHAT_HAVE_LZ4)
+#include <lz4.h>
+#endif
+
+#if defined(LANCHAT_HAVE_ZSTD)
+#include <zstd.h>
+#endif
+
+namespace
+{
+    using Compression::Codec;
+
+    // Order of preference: zstd compresses better than deflate at several times its
+    // speed, LZ4 is faster still but compresses less.
+    constexpr std::array<Codec, 3> CODECS = {Codec::Zstd, Codec::Lz4, Codec::Deflate};
+
+#if defined(LANCHAT_HAVE_ZLIB)
+    // zlib allocates about 300 KiB of state per stream; every thread keeps one
+    // stream of each direction and resets it, instead of one per message.
+    struct DeflateStream
+    {
+        z_stream stream{};
+        bool     ready = deflateInit(&stream, Z_BEST_SPEED) == Z_OK;
+
+        ~DeflateStream() { if(ready) deflateEnd(&stream); }
+    };
+
+    struct InflateStream
+    {
+        z_stream stream{};
+        bool     ready = inflateInit(&stream) == Z_OK;
+
+        ~InflateStream() { if(ready) inflateEnd(&stream); }
+    };
+#endif
+
+#if defined(LANCHAT_HAVE_ZSTD)
+    struct ZstdContexts
+    {
+        std::unique_ptr<ZSTD_CCtx, std::size_t(*)(ZSTD_CCtx*)> compress{ZSTD_createCCtx(), ZSTD_freeCCtx};
+        std::unique_ptr<ZSTD_DCtx, std::size_t(*)(ZSTD_DCtx*)> decompress{ZSTD_createDCtx(), ZSTD_freeDCtx};
+    };
+
+    // The contexts of the calling thread, reused for every message.
+    ZstdContexts& zstdContexts()
+    {
+        thread_local ZstdContexts contexts;
+        return contexts;
+    }
+#endif
+
+    // Largest output of a codec for an input of the given size, 0 if it is not available.
+    std::size_t compressBound(const Codec codec, const std::size_t size) noexcept
+    {
+        switch(codec)
+        {
+#if defined(LANCHAT_HAVE_ZLIB)
+        case Codec::Deflate: return ::compressBound(static_cast<uLong>(size));
+#endif
+#if defined(LANCHAT_HAVE_LZ4)
+        case Codec::Lz4:     return static_cast<std::size_t>(LZ4_compressBound(static_cast<int>(size)));
+#endif
+#if defined(LANCHAT_HAVE_ZSTD)
+        case Codec::Zstd:    return ZSTD_compressBound(size);
+#endif
+        default:             return 0;
+        }
+    }
+
+    // Compresses in into out (compressBound() bytes); returns the compressed size, 0 on failure.
+    std::size_t compressInto(const Codec codec, std::string_view in, std::uint8_t* out, const std::size_t capacity) noexcept
+    {
+        switch(codec)
+        {
+#if defined(LANCHAT_HAVE_ZLIB)
+        case Codec::Deflate:
+        {
+            thread_local DeflateStream deflater;
+            z_stream& stream = deflater.stream;
+
+            if(!deflater.ready || deflateReset(&stream) != Z_OK)
+                return 0;
+
+            stream.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+            stream.avail_in  = static_cast<uInt>(in.size());
+            stream.next_out  = out;
+            stream.avail_out = static_cast<uInt>(capacity);
+
+            return deflate(&stream, Z_FINISH) == Z_STREAM_END ? stream.total_out : 0;
+        }
+#endif
+#if defined(LANCHAT_HAVE_LZ4)
+        case Codec::Lz4:
+        {
+            const int size = LZ4_compress_default(in.data(), reinterpret_cast<char*>(out),
+                                                  static_cast<int>(in.size()), static_cast<int>(capacity));
+            return size > 0 ? static_cast<std::size_t>(size) : 0;
+        }
+#endif
+#if defined(LANCHAT_HAVE_ZSTD)
+        case Codec::Zstd:
+        {
+            ZstdContexts& contexts = zstdContexts();
+
+            if(!contexts.compress)
+                return 0;
+
+            const std::size_t size = ZSTD_compressCCtx(contexts.compress.get(), out, capacity, in.data(), in.size(), 1);
+            return ZSTD_isError(size) ? 0 : size;
+        }
+#endif
+        default:
+            return 0;
+        }
+    }
+
+    // Decompresses in into exactly size bytes at out; false if the data does not fill them.
+    bool decompressInto(const Codec codec, std::string_view in, std::uint8_t* out, const std::size_t size) noexcept
+    {
+        switch(codec)
+        {
+#if defined(LANCHAT_HAVE_ZLIB)
+        case Codec::Deflate:
+        {
+            thread_local InflateStream inflater;
+            z_stream& stream = inflater.stream;
+
+            if(!inflater.ready || inflateReset(&stream) != Z_OK)
+                return false;
+
+            stream.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+            stream.avail_in  = static_cast<uInt>(in.size());
+            stream.next_out  = out;
+            stream.avail_out = static_cast<uInt>(size);
+
+            return inflate(&stream, Z_FINISH) == Z_STREAM_END && stream.total_out == size;
+        }
+#endif
+#if defined(LANCHAT_HAVE_LZ4)
+        case Codec::Lz4:
+            return LZ4_decompress_safe(in.data(), reinterpret_cast<char*>(out),
+                                       static_cast<int>(in.size()), static_cast<int>(size)) == static_cast<int>(size);
+#endif
+#if defined(LANCHAT_HAVE_ZSTD)
+        case Codec::Zstd:
+        {
+            ZstdContexts& contexts = zstdContexts();
+
+            if(!contexts.decompress)
+                return false;
+
+            return ZSTD_decompressDCtx(contexts.decompress.get(), out, size, in.data(), in.size()) == size;
+        }
+#endif
+        default:
+            return false;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+Compression::CodecSet Compression::available() noexcept
+{
+    CodecSet codecs = 0;
+
+#if defined(LANCHAT_HAVE_ZLIB)
+    codecs |= CodecSet(1) << static_cast<unsigned>(Codec::Deflate);
+#endif
+#if defined(LANCHAT_HAVE_LZ4)
+    codecs |= CodecSet(1) << static_cast<unsigned>(Codec::Lz4);
+#endif
+#if defined(LANCHAT_HAVE_ZSTD)
+    codecs |= CodecSet(1) << static_cast<unsigned>(Codec::Zstd);
+#endif
+
+    return codecs;
+}
+
+bool Compression::contains(const CodecSet codecs, const Codec codec) noexcept
+{
+    return codec != Codec::None && static_cast<unsigned>(codec) < 8 &&
+           (codecs >> static_cast<unsigned>(codec)) & 1;
+}
+
+Compression::Codec Compression::preferred(const CodecSet codecs) noexcept
+{
+    for(const Codec codec : CODECS)
+    {
+        if(contains(codecs, codec))
+            return codec;
+    }
+
+    return Codec::None;
+}
+
+std::string_view Compression::name(const Codec codec) noexcept
+{
+    switch(codec)
+    {
+    case Codec::Deflate: return "deflate";
+    case Codec::Lz4:     return "lz4";
+    case Codec::Zstd:    return "zstd";
+    default:             return "none";
+    }
+}
+
+std::optional<Compression::Codec> Compression::fromName(std::string_view name) noexcept
+{
+    if(name == "none" || name == "off")
+        return Codec::None;
+
+    for(const Codec codec : CODECS)
+    {
+        if(name == Compression::name(codec))
+            return codec;
+    }
+
+    return std::nullopt;
+}
+
+std::string Compression::names(const CodecSet codecs)
+{
+    std::string list;
+
+    for(const Codec codec : CODECS)
+    {
+        if(!contains(codecs, codec))
+            continue;
+
+        if(!list.empty())
+            list += ',';
+
+        list += name(codec);
+    }
+
+    return list;
+}
+
+Compression::CodecSet Compression::parseNames(std::string_view list) noexcept
+{
+    CodecSet codecs = 0;
+
+    while(!list.empty())
+    {
+        const std::size_t comma = list.find(',');
+        const auto        codec = fromName(list.substr(0, comma));
+
+        if(codec && *codec != Codec::None)
+            codecs |= CodecSet(1) << static_cast<unsigned>(*codec);
+
+        list = (comma == std::string_view::npos) ? std::string_view() : list.substr(comma + 1);
+    }
+
+    return codecs;
+}
+
+SharedFrame Compression::compress(std::string_view payload, const Codec codec)
+{
+    MessageRecord record;
+
+    if(!MessageRecord::decode(payload, record) || record.type == MessageRecord::Type::Compressed)
+        return SharedFrame();
+
+    const std::size_t bound = compressBound(codec, payload.size());
+
+    if(bound == 0)
+        return SharedFrame();
+
+    // The body is built in a buffer of the thread, then copied once into the frame.
+    thread_local std::vector<std::uint8_t> body;
+
+    if(body.size() < HEADER_SIZE + bound)
+        body.resize(HEADER_SIZE + bound);
+
+    const std::size_t size = compressInto(codec, payload, body.data() + HEADER_SIZE, bound);
+
+    // Not worth it if the wrapper is no smaller than the original.
+    if(size == 0 || MessageRecord::HEADER_SIZE + HEADER_SIZE + size >= payload.size())
+        return SharedFrame();
+
+    body[0] = static_cast<std::uint8_t>(codec);
+
+    for(std::size_t i = 0; i < 4; ++i)
+        body[1 + i] = static_cast<std::uint8_t>(payload.size() >> (24 - 8 * i));
+
+    MessageRecord wrapper;
+    wrapper.type      = MessageRecord::Type::Compressed;
+    wrapper.timestamp = record.timestamp;
+    wrapper.sequence  = record.sequence;
+    wrapper.body      = std::string_view(reinterpret_cast<const char*>(body.data()), HEADER_SIZE + size);
+
+    return wrapper.toFrame();
+}
+
+bool Compression::decompress(const MessageRecord& record, std::string& out)
+{
+    if(record.type != MessageRecord::Type::Compressed || record.body.size() < HEADER_SIZE)
+        return false;
+
+    const auto* in    = reinterpret_cast<const std::uint8_t*>(record.body.data());
+    const Codec codec = static_cast<Codec>(in[0]);
+
+    std::size_t size = 0;
+
+    for(std::size_t i = 0; i < 4; ++i)
+        size = (size << 8) | in[1 + i];
+
+    // The size is checked before anything is allocated for it.
+    if(size < MessageRecord::MIN_HEADER_SIZE || size > Frame::MAX_PAYLOAD_SIZE || !contains(available(), codec))
+        return false;
+
+    out.resize(size);
+
+    if(!decompressInto(codec, record.body.substr(HEADER_SIZE), reinterpret_cast<std::uint8_t*>(out.data()), size))
+        return false;
+
+    // The original is never itself compressed.
+    return static_cast<MessageRecord::Type>(out[1]) != MessageRecord::Type::Compressed;
+}
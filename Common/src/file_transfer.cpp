@@ -0,0 +1,159 @@
+#include "file_transfer.h"
+
+#include <cstring>
+
+namespace
+{
+    constexpr std::size_t MAX_NAME_SIZE = 255;   // Longest file name of the usual file systems, in bytes.
+
+    std::uint64_t readU64(const char* in) noexcept
+    {
+        std::uint64_t value = 0;
+
+        for(std::size_t i = 0; i < 8; ++i)
+            value = (value << 8) | static_cast<std::uint8_t>(in[i]);
+
+        return value;
+    }
+
+    void writeU64(std::uint8_t* out, const std::uint64_t value) noexcept
+    {
+        for(std::size_t i = 0; i < 8; ++i)
+            out[i] = static_cast<std::uint8_t>(value >> (56 - 8 * i));
+    }
+
+    // Encodes a record whose body is integers (one or two of them) followed by some
+    // bytes, directly into the frame.
+    SharedFrame recordFrame(const MessageRecord::Type type, std::string_view sender, std::string_view channel,
+                            const std::uint64_t first, const std::uint64_t second, const std::size_t integers,
+                            std::string_view rest)
+    {
+        MessageRecord record;
+        record.type      = type;
+        record.timestamp = MessageRecord::now();
+        record.channel   = channel;
+        record.sender    = sender;
+
+        // Without a body, encode() writes the header and the sender; the body follows them.
+        const std::size_t head = record.encodedSize();
+
+        return SharedFrame::create(head + integers * 8 + rest.size(), [&](std::uint8_t* out){
+            record.encode(out);
+            writeU64(out + head, first);
+
+            if(integers > 1)
+                writeU64(out + head + 8, second);
+
+            if(!rest.empty())
+                std::memcpy(out + head + integers * 8, rest.data(), rest.size());
+        });
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+bool FileTransfer::decodeOffer(const MessageRecord& record, Offer& offer) noexcept
+{
+    if(record.type != MessageRecord::Type::FileOffer || record.body.size() < HEADER_SIZE)
+        return false;
+
+    offer.id   = readU64(record.body.data());
+    offer.size = readU64(record.body.data() + 8);
+    offer.name = record.body.substr(HEADER_SIZE);
+
+    return true;
+}
+
+bool FileTransfer::decodeChunk(const MessageRecord& record, Chunk& chunk) noexcept
+{
+    if(record.type != MessageRecord::Type::FileChunk || record.body.size() < HEADER_SIZE ||
+       record.body.size() > HEADER_SIZE + CHUNK_SIZE)
+        return false;
+
+    chunk.id     = readU64(record.body.data());
+    chunk.offset = readU64(record.body.data() + 8);
+    chunk.data   = record.body.substr(HEADER_SIZE);
+
+    return true;
+}
+
+bool FileTransfer::decodeFetch(const MessageRecord& record, std::uint64_t& id) noexcept
+{
+    if(record.type != MessageRecord::Type::FileFetch || record.body.size() < 8)
+        return false;
+
+    id = readU64(record.body.data());
+    return true;
+}
+
+SharedFrame FileTransfer::offerFrame(std::string_view sender, const Offer& offer, std::string_view channel)
+{
+    // An empty name stays empty: it tells that the file is not available.
+    const std::string name = offer.name.empty() ? std::string() : safeName(offer.name);
+
+    return recordFrame(MessageRecord::Type::FileOffer, sender, channel, offer.id, offer.size, 2, name);
+}
+
+SharedFrame FileTransfer::fetchFrame(const std::uint64_t id)
+{
+    return recordFrame(MessageRecord::Type::FileFetch, std::string_view(), std::string_view(), id, 0, 1, std::string_view());
+}
+
+std::size_t FileTransfer::chunkHeaderSize(std::string_view channel) noexcept
+{
+    MessageRecord record;
+    record.channel = channel;
+
+    return record.encodedSize() + HEADER_SIZE;
+}
+
+void FileTransfer::encodeChunkHeader(std::uint8_t* out, const std::uint64_t id, const std::uint64_t offset,
+                                     std::string_view channel) noexcept
+{
+    MessageRecord record;
+    record.type      = MessageRecord::Type::FileChunk;
+    record.timestamp = MessageRecord::now();
+    record.channel   = channel;
+
+    // Without a sender and a body, encode() writes the header and the channel only.
+    const std::size_t head = record.encodedSize();
+    record.encode(out);
+
+    writeU64(out + head, id);
+    writeU64(out + head + 8, offset);
+}
+
+std::string FileTransfer::safeName(std::string_view name)
+{
+    // Only the last component: a name never leads out of the download directory.
+    const std::size_t slash = name.find_last_of("/\\");
+
+    if(slash != std::string_view::npos)
+        name = name.substr(slash + 1);
+
+    std::string safe;
+    safe.reserve(name.size());
+
+    for(const char c : name)
+    {
+        if(static_cast<unsigned char>(c) >= 0x20 && c != 0x7F && c != ':')
+            safe += c;
+    }
+
+    // Not longer than a file name can be, without cutting a UTF-8 character in half.
+    if(safe.size() > MAX_NAME_SIZE)
+    {
+        std::size_t size = MAX_NAME_SIZE;
+
+        while(size > 0 && (static_cast<std::uint8_t>(safe[size]) & 0xC0) == 0x80)
+            --size;
+
+        safe.resize(size);
+    }
+
+    if(safe.empty() || safe == "." || safe == "..")
+        safe = "file";
+
+    return safe;
+}
@@ -0,0 +1,219 @@
+#include "frame.h"
+
+#include <algorithm>
+#include <cstring>
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// FRAME
+///
+void Frame::encodeHeader(std::uint8_t* out, const std::uint32_t payload_size) noexcept
+{
+    out[0] = static_cast<std::uint8_t>(payload_size >> 24);
+    out[1] = static_cast<std::uint8_t>(payload_size >> 16);
+    out[2] = static_cast<std::uint8_t>(payload_size >> 8);
+    out[3] = static_cast<std::uint8_t>(payload_size);
+}
+
+std::uint32_t Frame::decodeHeader(const std::uint8_t* in) noexcept
+{
+    return (std::uint32_t(in[0]) << 24) |
+           (std::uint32_t(in[1]) << 16) |
+           (std::uint32_t(in[2]) << 8)  |
+            std::uint32_t(in[3]);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// SHARED FRAME
+///
+SharedFrame::SharedFrame(std::shared_ptr<const std::uint8_t[]> data, const std::size_t size) noexcept
+    : m_data(std::move(data)),
+      m_size(size)
+{
+}
+
+SharedFrame::SharedFrame() noexcept
+    : m_data(nullptr),
+      m_size(0)
+{
+}
+
+SharedFrame SharedFrame::encode(std::string_view payload)
+{
+    return SharedFrame::create(payload.size(), [payload](std::uint8_t* out){
+        std::memcpy(out, payload.data(), payload.size());
+    });
+}
+
+boost::asio::const_buffer SharedFrame::buffer() const noexcept
+{
+    return boost::asio::const_buffer(m_data.get(), m_size);
+}
+
+std::string_view SharedFrame::payload() const noexcept
+{
+    if(!m_data)
+        return {};
+
+    return std::string_view(reinterpret_cast<const char*>(m_data.get()) + Frame::HEADER_SIZE,
+                            m_size - Frame::HEADER_SIZE);
+}
+
+std::size_t SharedFrame::size() const noexcept
+{
+    return m_size;
+}
+
+SharedFrame::operator bool() const noexcept
+{
+    return m_data != nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// FRAME DECODER
+///
+void FrameDecoder::reallocate(const std::size_t capacity)
+{
+    auto* data = static_cast<std::uint8_t*>(BufferPool::allocate(capacity));
+
+    if(m_end > m_begin)
+        std::memcpy(data, m_data + m_begin, m_end - m_begin);
+
+    BufferPool::deallocate(m_data, m_capacity);
+
+    m_data     = data;
+    m_capacity = capacity;
+    m_end     -= m_begin;
+    m_begin    = 0;
+}
+
+FrameDecoder::FrameDecoder(const std::size_t read_size)
+    : m_data(nullptr),
+      m_capacity(0),
+      m_begin(0),
+      m_end(0),
+      m_prepared(0),
+      m_readSize(std::max(read_size, MIN_READ_SIZE)),
+      m_shortReads(0)
+{
+}
+
+FrameDecoder::~FrameDecoder()
+{
+    BufferPool::deallocate(m_data, m_capacity);
+}
+
+boost::asio::mutable_buffer FrameDecoder::prepare()
+{
+    // Moving the unconsumed bytes (at most one incomplete frame) to the front
+    // of the buffer, so the free space is contiguous.
+    if(m_begin == m_end)
+    {
+        m_begin = m_end = 0;
+    }
+    else if(m_begin > 0)
+    {
+        std::memmove(m_data, m_data + m_begin, m_end - m_begin);
+        m_end  -= m_begin;
+        m_begin = 0;
+    }
+
+    std::size_t capacity = std::max(m_capacity, m_readSize);
+
+    // If the header of the pending frame is known, the buffer must be able to hold
+    // the whole frame. Oversized frames are reported by next(), not allocated.
+    if(m_end >= Frame::HEADER_SIZE)
+    {
+        const std::uint32_t payload_size = Frame::decodeHeader(m_data);
+
+        if(payload_size <= Frame::MAX_PAYLOAD_SIZE)
+            capacity = std::max(capacity, Frame::HEADER_SIZE + payload_size);
+    }
+
+    if(capacity > m_capacity)
+        this->reallocate(capacity);
+
+    m_prepared = m_capacity - m_end;
+
+    return boost::asio::buffer(m_data + m_end, m_prepared);
+}
+
+void FrameDecoder::commit(const std::size_t bytes) noexcept
+{
+    m_end += bytes;
+
+    // A read that fills the buffer means more is coming: the next buffer is larger.
+    if(bytes == m_prepared)
+    {
+        m_readSize   = std::min(m_readSize * 2, std::max(MAX_READ_SIZE, m_readSize));
+        m_shortReads = 0;
+    }
+    else if(bytes < m_readSize / 4)
+    {
+        if(++m_shortReads >= SHRINK_AFTER)
+        {
+            m_readSize   = std::max(m_readSize / 2, MIN_READ_SIZE);
+            m_shortReads = 0;
+        }
+    }
+    else
+    {
+        m_shortReads = 0;
+    }
+
+    m_prepared = 0;
+}
+
+void FrameDecoder::append(const std::uint8_t* data, const std::size_t size)
+{
+    if(m_capacity - m_end < size)
+        this->reallocate(std::max(m_end - m_begin + size, m_capacity * 2));
+
+    std::memcpy(m_data + m_end, data, size);
+    m_end += size;
+}
+
+FrameDecoder::Status FrameDecoder::next(std::string_view& payload) noexcept
+{
+    const std::size_t available = m_end - m_begin;
+
+    if(available < Frame::HEADER_SIZE)
+        return Status::NeedMore;
+
+    const std::uint32_t payload_size = Frame::decodeHeader(m_data + m_begin);
+
+    if(payload_size > Frame::MAX_PAYLOAD_SIZE)
+        return Status::Oversized;
+
+    if(available < Frame::HEADER_SIZE + payload_size)
+        return Status::NeedMore;
+
+    payload = std::string_view(reinterpret_cast<const char*>(m_data + m_begin + Frame::HEADER_SIZE),
+                               payload_size);
+    m_begin += Frame::HEADER_SIZE + payload_size;
+
+    return Status::Ok;
+}
+
+bool FrameDecoder::release() noexcept
+{
+    if(m_begin != m_end)
+        return false;
+
+    BufferPool::deallocate(m_data, m_capacity);
+
+    m_data     = nullptr;
+    m_capacity = 0;
+    m_begin    = m_end = 0;
+
+    return true;
+}
+
+void FrameDecoder::reset() noexcept
+{
+    m_begin = m_end = 0;
+}
+
+std::size_t FrameDecoder::capacity() const noexcept
+{
+    return m_capacity;
+}
@@ -0,0 +1,93 @@
+#include "message_inbox.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PRIVATE METHODS
+///
+void MessageInbox::notify() noexcept
+{
+    // The fence pairs with the one in drain(): either the consumer sees the message
+    // that was just pushed, or this exchange sees the cleared flag and wakes it up.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if(!m_pending.exchange(true) && m_wakeup)
+        m_wakeup();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+MessageInbox::MessageInbox(const std::size_t producer_num, Wakeup wakeup, const std::size_t ring_capacity)
+    : m_pending(false),
+      m_wakeup(std::move(wakeup))
+{
+    for(std::size_t i = 0; i < (producer_num ? producer_num : 1); ++i)
+        m_producers.push_back(std::make_unique<Producer>(ring_capacity));
+}
+
+void MessageInbox::push(const std::size_t producer, std::string_view message) noexcept
+{
+    Producer& p = *m_producers[producer];
+
+    try
+    {
+        // Once a message has overflowed, the following ones must overflow too,
+        // otherwise they would overtake it.
+        const bool pushed = !p.overflowing.load(std::memory_order_acquire) &&
+                            p.ring.tryPush([message](std::string& slot){ slot.assign(message); });
+
+        if(!pushed)
+        {
+            boost::lock_guard<boost::mutex> lckgrd(p.mutex);
+
+            p.overflow.emplace_back(message);
+            p.overflowing.store(true, std::memory_order_release);
+        }
+    }
+    catch(const std::exception&)
+    {
+        // Out of memory: the message is lost, but the network thread goes on.
+        return;
+    }
+
+    this->notify();
+}
+
+std::size_t MessageInbox::drain(const Consumer& consume, const std::size_t max_messages)
+{
+    m_pending.store(false);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    std::size_t drained = 0;
+
+    for(auto& p : m_producers)
+    {
+        // While the flag is set the producer no longer pushes to the ring, so once
+        // the ring is empty everything older than the overflow has been consumed.
+        const bool overflowing = p->overflowing.load(std::memory_order_acquire);
+
+        while(drained < max_messages &&
+              p->ring.tryPop([&consume](std::string& slot){ consume(slot); }))
+            ++drained;
+
+        if(overflowing && drained < max_messages)
+        {
+            std::deque<std::string> overflow;
+            {
+                boost::lock_guard<boost::mutex> lckgrd(p->mutex);
+
+                overflow.swap(p->overflow);
+                p->overflowing.store(false, std::memory_order_release);
+            }
+
+            for(const auto& message : overflow)
+                consume(message);
+
+            drained += overflow.size();
+        }
+    }
+
+    if(drained >= max_messages)
+        this->notify();
+
+    return drained;
+}
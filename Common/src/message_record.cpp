@@ -0,0 +1,113 @@
+#include "message_record.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+    constexpr std::size_t CHANNEL_SIZE_OFFSET = 20;   // Where version 2 ends its header, after the sequence.
+
+    // Length of a text as it is encoded: at most max_size bytes, without cutting a
+    // multi-byte UTF-8 character in half.
+    std::size_t encodedTextSize(std::string_view text, const std::size_t max_size) noexcept
+    {
+        if(text.size() <= max_size)
+            return text.size();
+
+        std::size_t size = max_size;
+
+        while(size > 0 && (static_cast<std::uint8_t>(text[size]) & 0xC0) == 0x80)
+            --size;
+
+        return size;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+std::uint64_t MessageRecord::now() noexcept
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+std::size_t MessageRecord::encodedSize() const noexcept
+{
+    return HEADER_SIZE + encodedTextSize(channel, MAX_CHANNEL_SIZE) + encodedTextSize(sender, MAX_SENDER_SIZE) +
+           body.size();
+}
+
+void MessageRecord::encode(std::uint8_t* out) const noexcept
+{
+    const std::size_t channel_size = encodedTextSize(channel, MAX_CHANNEL_SIZE);
+    const std::size_t sender_size  = encodedTextSize(sender, MAX_SENDER_SIZE);
+    const std::size_t header_size  = HEADER_SIZE + channel_size;
+
+    out[0] = VERSION;
+    out[1] = static_cast<std::uint8_t>(type);
+    out[2] = static_cast<std::uint8_t>(header_size);
+    out[3] = static_cast<std::uint8_t>(sender_size);
+
+    for(std::size_t i = 0; i < 8; ++i)
+    {
+        out[4 + i]  = static_cast<std::uint8_t>(timestamp >> (56 - 8 * i));
+        out[12 + i] = static_cast<std::uint8_t>(sequence >> (56 - 8 * i));
+    }
+
+    out[CHANNEL_SIZE_OFFSET] = static_cast<std::uint8_t>(channel_size);
+
+    std::memcpy(out + HEADER_SIZE, channel.data(), channel_size);
+    std::memcpy(out + header_size, sender.data(), sender_size);
+    std::memcpy(out + header_size + sender_size, body.data(), body.size());
+}
+
+SharedFrame MessageRecord::toFrame() const
+{
+    return SharedFrame::create(this->encodedSize(), [this](std::uint8_t* out){ this->encode(out); });
+}
+
+bool MessageRecord::decode(std::string_view payload, MessageRecord& record) noexcept
+{
+    const auto* in = reinterpret_cast<const std::uint8_t*>(payload.data());
+
+    // Version 1 is the oldest one; newer versions have at least its header.
+    if(payload.size() < MIN_HEADER_SIZE || in[0] < 1 || in[2] < MIN_HEADER_SIZE)
+        return false;
+
+    const std::size_t header_size = in[2];
+    const std::size_t sender_size = in[3];
+
+    if(payload.size() < header_size + sender_size)
+        return false;
+
+    record.type      = static_cast<Type>(in[1]);
+    record.timestamp = 0;
+    record.sequence  = 0;
+    record.channel   = std::string_view();
+
+    for(std::size_t i = 0; i < 8; ++i)
+        record.timestamp = (record.timestamp << 8) | in[4 + i];
+
+    if(header_size >= CHANNEL_SIZE_OFFSET)
+    {
+        for(std::size_t i = 0; i < 8; ++i)
+            record.sequence = (record.sequence << 8) | in[12 + i];
+    }
+
+    // The channel ends inside the header.
+    if(header_size >= HEADER_SIZE)
+    {
+        const std::size_t channel_size = in[CHANNEL_SIZE_OFFSET];
+
+        if(HEADER_SIZE + channel_size > header_size)
+            return false;
+
+        record.channel = payload.substr(HEADER_SIZE, channel_size);
+    }
+
+    record.sender = payload.substr(header_size, sender_size);
+    record.body   = payload.substr(header_size + sender_size);
+
+    return true;
+}
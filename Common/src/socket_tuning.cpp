@@ -0,0 +1,134 @@
+#include "socket_tuning.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+namespace
+{
+    template<int Level, int Name>
+    using IntegerOption = boost::asio::detail::socket_option::integer<Level, Name>;
+
+    // Keeps the first error: every option is independent, so one that fails does
+    // not stop the others.
+    template<typename Socket, typename Option>
+    void setOption(Socket& socket, const Option& option, boost::system::error_code& ec) noexcept
+    {
+        boost::system::error_code option_ec;
+        socket.set_option(option, option_ec);
+
+        if(option_ec && !ec)
+            ec = option_ec;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+SocketTuning SocketTuning::lowLatency() noexcept
+{
+    SocketTuning tuning;
+    tuning.no_delay            = true;
+    tuning.quick_ack           = true;
+    tuning.not_sent_lowat      = 16 * 1024;
+    tuning.keep_alive_idle     = std::chrono::seconds(60);
+    tuning.keep_alive_interval = std::chrono::seconds(10);
+    tuning.keep_alive_count    = 3;
+
+    return tuning;
+}
+
+SocketTuning SocketTuning::bulk() noexcept
+{
+    SocketTuning tuning;
+    tuning.keep_alive_idle     = std::chrono::seconds(60);
+    tuning.keep_alive_interval = std::chrono::seconds(10);
+    tuning.keep_alive_count    = 3;
+
+    return tuning;
+}
+
+std::optional<SocketTuning> SocketTuning::fromName(std::string_view name) noexcept
+{
+    if(name == "system")
+        return SocketTuning();
+    if(name == "low-latency")
+        return lowLatency();
+    if(name == "bulk")
+        return bulk();
+
+    return std::nullopt;
+}
+
+void SocketTuning::apply(boost::asio::ip::tcp::socket& socket, boost::system::error_code& ec) const noexcept
+{
+    ec.clear();
+
+    // Only what the tuning asks for is set: the rest keeps the system's values,
+    // or the ones inherited from the listening socket.
+    if(no_delay)
+        setOption(socket, boost::asio::ip::tcp::no_delay(true), ec);
+
+    if(send_buffer > 0)
+        setOption(socket, boost::asio::socket_base::send_buffer_size(send_buffer), ec);
+
+    if(receive_buffer > 0)
+        setOption(socket, boost::asio::socket_base::receive_buffer_size(receive_buffer), ec);
+
+#if defined(TCP_QUICKACK)
+    if(quick_ack)
+        setOption(socket, IntegerOption<IPPROTO_TCP, TCP_QUICKACK>(1), ec);
+#endif
+
+#if defined(TCP_NOTSENT_LOWAT)
+    if(not_sent_lowat > 0)
+        setOption(socket, IntegerOption<IPPROTO_TCP, TCP_NOTSENT_LOWAT>(not_sent_lowat), ec);
+#endif
+
+    if(keep_alive_idle.count() > 0)
+    {
+        setOption(socket, boost::asio::socket_base::keep_alive(true), ec);
+
+#if defined(TCP_KEEPIDLE)
+        setOption(socket, IntegerOption<IPPROTO_TCP, TCP_KEEPIDLE>(static_cast<int>(keep_alive_idle.count())), ec);
+#elif defined(TCP_KEEPALIVE)
+        setOption(socket, IntegerOption<IPPROTO_TCP, TCP_KEEPALIVE>(static_cast<int>(keep_alive_idle.count())), ec);
+#endif
+
+#if defined(TCP_KEEPINTVL)
+        if(keep_alive_interval.count() > 0)
+            setOption(socket, IntegerOption<IPPROTO_TCP, TCP_KEEPINTVL>(static_cast<int>(keep_alive_interval.count())), ec);
+#endif
+
+#if defined(TCP_KEEPCNT)
+        if(keep_alive_count > 0)
+            setOption(socket, IntegerOption<IPPROTO_TCP, TCP_KEEPCNT>(keep_alive_count), ec);
+#endif
+    }
+}
+
+void SocketTuning::rearm(boost::asio::ip::tcp::socket& socket) const noexcept
+{
+#if defined(TCP_QUICKACK)
+    // Only a hint for the next acknowledgements: a failure is not worth reporting.
+    if(quick_ack)
+    {
+        boost::system::error_code ec;
+        setOption(socket, IntegerOption<IPPROTO_TCP, TCP_QUICKACK>(1), ec);
+    }
+#else
+    (void)socket;
+#endif
+}
+
+void SocketTuning::applyToAcceptor(boost::asio::ip::tcp::acceptor& acceptor, boost::system::error_code& ec) const noexcept
+{
+    ec.clear();
+
+    if(send_buffer > 0)
+        setOption(acceptor, boost::asio::socket_base::send_buffer_size(send_buffer), ec);
+
+    if(receive_buffer > 0)
+        setOption(acceptor, boost::asio::socket_base::receive_buffer_size(receive_buffer), ec);
+}
@@ -0,0 +1,122 @@
+#ifndef DAEMON_CONFIG_H
+#define DAEMON_CONFIG_H
+
+#include "server.h"
+
+#include <cstddef>
+#include <string>
+
+
+/**
+ * @struct DaemonConfig
+ * @brief Settings of the headless server, read from the command line and
+ *        optionally from a configuration file.
+ *
+ * The configuration file has one "key = value" pair per line; the keys are the
+ * long command line options without the leading dashes and '#' starts a comment.
+ * Options given on the command line override the ones read from the file.
+ */
+struct DaemonConfig
+{
+    static inline const char* USAGE =
+        "Usage: lanchatd [options]\n"
+        "  --config FILE         Read options from FILE (key = value per line)\n"
+        "  --address ADDRESS     Address to listen on (default 0.0.0.0)\n"
+        "  --port PORT           Port to listen on (default 55555)\n"
+        "  --max-clients N       Maximum number of connected clients (default 20000)\n"
+        "  --mode shared|per-core\n"
+        "                        Worker threads layout (default shared)\n"
+        "  --group-chat on|off   Relay every message to the other clients (default on)\n"
+        "  --session-budget BYTES\n"
+        "                        Bytes queued for one client before the slow consumer\n"
+        "                        policy applies (default 4194304)\n"
+        "  --slow-consumer drop-oldest|drop-newest|disconnect\n"
+        "                        Slow consumer policy (default drop-oldest)\n"
+        "  --high-watermark BYTES\n"
+        "                        Bytes queued for all clients above which reads pause,\n"
+        "                        0 for no limit (default 268435456)\n"
+        "  --heartbeat-interval MS\n"
+        "                        Silence towards a client after which a heartbeat is\n"
+        "                        sent, 0 for none (default 10000)\n"
+        "  --idle-timeout MS     Silence from a client after which it is disconnected,\n"
+        "                        0 for never (default 30000)\n"
+        "  --compression off|deflate|lz4|zstd\n"
+        "                        Codec of the large relayed messages, for the clients\n"
+        "                        that can decode it (default off)\n"
+        "  --compression-threshold BYTES\n"
+        "                        Smallest message that is compressed (default 1024)\n"
+        "  --log-dir DIRECTORY   Keep the relayed messages in a persistent log in DIRECTORY\n"
+        "                        and let clients replay them (default: no log)\n"
+        "  --log-segment-size BYTES\n"
+        "                        Size of the log segment files (default 67108864)\n"
+        "  --log-retention BYTES Bytes of log kept on disk, 0 to keep everything\n"
+        "                        (default 1073741824)\n"
+        "  --log-fsync on|off    fsync the log after every group commit (default off)\n"
+        "  --replay-limit N      Most messages replayed for one client request (default 1000)\n"
+        "  --file-dir DIRECTORY  Keep the files sent by the clients in DIRECTORY and let\n"
+        "                        clients fetch them (default: files are only relayed)\n"
+        "  --file-max-size BYTES Largest file kept (default 1073741824)\n"
+        "  --tcp-profile low-latency|bulk|system\n"
+        "                        TCP options of the client connections (default\n"
+        "                        low-latency); the options below adjust the profile\n"
+        "  --tcp-nodelay on|off  Send small messages at once (TCP_NODELAY)\n"
+        "  --tcp-quickack on|off Acknowledge without delay (TCP_QUICKACK, Linux)\n"
+        "  --tcp-sndbuf BYTES    Socket send buffer, 0 for the system's autotuning\n"
+        "  --tcp-rcvbuf BYTES    Socket receive buffer, 0 for the system's autotuning\n"
+        "  --tcp-notsent-lowat BYTES\n"
+        "                        Unsent bytes kept by the kernel, 0 for no limit\n"
+        "                        (TCP_NOTSENT_LOWAT)\n"
+        "  --tcp-keepalive SECONDS\n"
+        "                        Silence before keepalive probes, 0 for none\n"
+        "  --tcp-keepalive-interval SECONDS\n"
+        "                        Between two keepalive probes\n"
+        "  --tcp-keepalive-count N\n"
+        "                        Unanswered probes before a connection drops\n"
+        "  --listen-backlog N    Pending connections of the listening socket\n"
+        "                        (default: the system's maximum)\n"
+        "  --metrics-port PORT   Serve Prometheus metrics at /metrics on PORT (default 0: off)\n"
+        "  --metrics-address ADDRESS\n"
+        "                        Address of the metrics endpoint (default 127.0.0.1)\n"
+        "  --verbose             Log every relayed message\n"
+        "  --help                Show this help\n";
+
+    std::string               address         = "0.0.0.0";                        ///< Listening address.
+    unsigned short            port            = Server::DEFAULT_PORT;             ///< Listening port.
+    std::size_t               max_client_num  = Server::DEFAULT_MAX_CLIENT_NUM;   ///< Client limit.
+    Server::ExecutionMode     mode            = Server::ExecutionMode::Shared;    ///< Worker threads layout.
+    bool                      group_chat      = true;                             ///< Relay messages between clients.
+    Server::FlowControl       flow_control;                                       ///< Write queue limits.
+    Server::Liveness          liveness;                                           ///< Heartbeats and idle timeouts.
+    Server::CompressionPolicy compression;                                        ///< Compression of the relayed messages.
+    ChatLog::Options          chat_log;                                           ///< Message log, off if no directory.
+    FileStore::Options        file_store;                                         ///< Stored files, off if no directory.
+    SocketTuning              socket_tuning   = SocketTuning::lowLatency();       ///< TCP options of the connections.
+    std::string               metrics_address = "127.0.0.1";                      ///< Address of the metrics endpoint.
+    unsigned short            metrics_port    = 0;                                ///< Metrics port, 0 if disabled.
+    bool                      verbose         = false;                            ///< Log every message.
+    bool                      show_help       = false;                            ///< --help was given.
+
+    /**
+     * @brief fromCommandLine Builds the configuration from the program arguments.
+     * @throws std::invalid_argument On unknown options or invalid values.
+     * @throws std::runtime_error If the configuration file cannot be read.
+     */
+    static DaemonConfig fromCommandLine(const int argc, char* argv[]);
+    /**
+     * @brief loadFile Applies the options of a configuration file, the TCP profile
+     *        first so that the tcp-* options of the file adjust it.
+     * @param path Path of the file.
+     * @throws std::invalid_argument On unknown keys or invalid values.
+     * @throws std::runtime_error If the file cannot be read.
+     */
+    void loadFile(const std::string& path);
+    /**
+     * @brief set Applies one option.
+     * @param key Option name, without the leading dashes.
+     * @param value Option value (empty for flags).
+     * @throws std::invalid_argument On unknown keys or invalid values.
+     */
+    void set(const std::string& key, const std::string& value);
+};
+
+#endif // DAEMON_CONFIG_H
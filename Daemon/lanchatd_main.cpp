@@ -0,0 +1,148 @@
+#include "daemon_config.h"
+#include "server.h"
+
+#include <boost/asio/signal_set.hpp>
+
+#include <chrono>
+#include <csignal>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+
+namespace
+{
+    std::mutex log_mutex;
+
+    void log(std::string_view message)
+    {
+        const std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        std::tm local_time{};
+        localtime_r(&now, &local_time);
+
+        // The callbacks come from several worker threads.
+        std::lock_guard<std::mutex> lckgrd(log_mutex);
+        std::clog << std::put_time(&local_time, "%F %T") << " lanchatd: " << message << '\n';
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    DaemonConfig config;
+
+    try
+    {
+        config = DaemonConfig::fromCommandLine(argc, argv);
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << "lanchatd: " << e.what() << '\n' << DaemonConfig::USAGE;
+        return 2;
+    }
+
+    if(config.show_help)
+    {
+        std::cout << DaemonConfig::USAGE;
+        return 0;
+    }
+
+    boost::asio::ip::tcp::endpoint endpoint;
+    boost::asio::ip::tcp::endpoint metrics_endpoint;
+
+    try
+    {
+        endpoint = boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address(config.address), config.port);
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << "lanchatd: invalid address " << config.address << ": " << e.what() << '\n';
+        return 2;
+    }
+
+    try
+    {
+        metrics_endpoint = boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address(config.metrics_address),
+                                                          config.metrics_port);
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << "lanchatd: invalid metrics address " << config.metrics_address << ": " << e.what() << '\n';
+        return 2;
+    }
+
+    Server server(config.max_client_num, config.mode);
+
+    Server::Callbacks callbacks;
+
+    callbacks.listening_on = [](const std::shared_ptr<boost::asio::ip::tcp::endpoint>& endpoint){
+        log("listening on " + endpoint->address().to_string() + ":" + std::to_string(endpoint->port()));
+    };
+    callbacks.connection_status = [](const char* status){
+        // The status messages are meant for a label and may start with spaces.
+        std::string_view message(status);
+        message.remove_prefix(std::min(message.find_first_not_of(' '), message.size()));
+        log(message);
+    };
+    if(config.verbose)
+    {
+        callbacks.message_received = [](std::size_t, std::string_view payload){
+            // Only valid records reach the callback.
+            MessageRecord record;
+            MessageRecord::decode(payload, record);
+
+            log("message from " + std::string(record.sender) + ": " + std::string(record.body));
+        };
+    }
+
+    server.setCallbacks(std::move(callbacks));
+    server.setGroupChat(config.group_chat);
+    server.setFlowControl(config.flow_control);
+    server.setLiveness(config.liveness);
+    server.setCompression(config.compression);
+    server.setSocketTuning(config.socket_tuning);
+    server.setEndpoint(endpoint);
+
+    if(config.metrics_port != 0)
+        server.setMetricsEndpoint(metrics_endpoint);
+
+    if(!config.chat_log.directory.empty())
+        server.setChatLog(config.chat_log);
+
+    if(!config.file_store.directory.empty())
+        server.setFileStore(config.file_store);
+
+    if(!server.startConnection())
+    {
+        server.finish();
+        return 1;
+    }
+
+    if(config.metrics_port != 0)
+    {
+        const auto metrics = server.getMetricsEndpoint();
+        log("serving metrics on http://" + metrics.address().to_string() + ":" + std::to_string(metrics.port()) + "/metrics");
+    }
+
+    if(const ChatLog* chat_log = server.getChatLog())
+    {
+        log("logging messages to " + chat_log->options().directory + " (last sequence " +
+            std::to_string(chat_log->lastSequence()) + ")");
+    }
+
+    if(const FileStore* file_store = server.getFileStore())
+        log("storing files in " + file_store->options().directory);
+
+    // The main thread only waits for a termination signal; the server runs on
+    // its own worker threads.
+    boost::asio::io_context signals_cntxt;
+    boost::asio::signal_set signals(signals_cntxt, SIGINT, SIGTERM);
+
+    signals.async_wait([](const boost::system::error_code&, const int signal_number){
+        log("received signal " + std::to_string(signal_number) + ", shutting down");
+    });
+    signals_cntxt.run();
+
+    server.finish();
+
+    return 0;
+}
@@ -0,0 +1,239 @@
+#include "daemon_config.h"
+
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+    std::string trim(const std::string& text)
+    {
+        const auto first = text.find_first_not_of(" \t\r");
+        const auto last  = text.find_last_not_of(" \t\r");
+
+        return first == std::string::npos ? std::string() : text.substr(first, last - first + 1);
+    }
+
+    bool parseBool(const std::string& key, const std::string& value)
+    {
+        if(value.empty() || value == "on" || value == "true" || value == "1")
+            return true;
+        if(value == "off" || value == "false" || value == "0")
+            return false;
+
+        throw std::invalid_argument("Invalid value for " + key + ": " + value);
+    }
+
+    unsigned long parseNumber(const std::string& key, const std::string& value, const unsigned long max)
+    {
+        // std::stoul takes a sign and wraps a negative number around: "-1" would be
+        // the largest value instead of an error.
+        if(value.empty() || value.front() < '0' || value.front() > '9')
+            throw std::invalid_argument("Invalid value for " + key + ": " + value);
+
+        try
+        {
+            std::size_t end = 0;
+            const unsigned long number = std::stoul(value, &end);
+
+            if(end == value.size() && number <= max)
+                return number;
+        }
+        catch(const std::exception&)
+        {
+        }
+
+        throw std::invalid_argument("Invalid value for " + key + ": " + value);
+    }
+
+    Compression::Codec parseCodec(const std::string& key, const std::string& value)
+    {
+        const auto codec = Compression::fromName(value);
+
+        if(!codec)
+            throw std::invalid_argument("Invalid value for " + key + ": " + value);
+
+        if(*codec != Compression::Codec::None && !Compression::contains(Compression::available(), *codec))
+            throw std::invalid_argument("Compression codec not available in this build: " + value);
+
+        return *codec;
+    }
+
+    SocketTuning parseTuning(const std::string& key, const std::string& value)
+    {
+        const auto tuning = SocketTuning::fromName(value);
+
+        if(!tuning)
+            throw std::invalid_argument("Invalid value for " + key + ": " + value);
+
+        return *tuning;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+DaemonConfig DaemonConfig::fromCommandLine(const int argc, char* argv[])
+{
+    DaemonConfig config;
+    std::vector<std::pair<std::string, std::string>> options;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+
+        if(arg.rfind("--", 0) != 0)
+            throw std::invalid_argument("Unexpected argument: " + arg);
+
+        const std::string key = arg.substr(2);
+
+        // Flags take no value; every other option takes the next argument.
+        if(key == "help" || key == "verbose")
+        {
+            options.emplace_back(key, "");
+        }
+        else if(i + 1 < argc)
+        {
+            options.emplace_back(key, argv[++i]);
+        }
+        else
+        {
+            throw std::invalid_argument("Missing value for " + arg);
+        }
+    }
+
+    // The file is read first, so the command line overrides it.
+    for(const auto& [key, value] : options)
+        if(key == "config")
+            config.loadFile(value);
+
+    // The profile comes before the TCP options that adjust it.
+    for(const auto& [key, value] : options)
+        if(key == "tcp-profile")
+            config.set(key, value);
+
+    for(const auto& [key, value] : options)
+        if(key != "config" && key != "tcp-profile")
+            config.set(key, value);
+
+    return config;
+}
+
+void DaemonConfig::loadFile(const std::string& path)
+{
+    std::ifstream file(path);
+
+    if(!file)
+        throw std::runtime_error("Cannot read the configuration file " + path);
+
+    std::vector<std::pair<std::string, std::string>> options;
+
+    std::string line;
+    while(std::getline(file, line))
+    {
+        line = trim(line.substr(0, line.find('#')));
+
+        if(line.empty())
+            continue;
+
+        const auto separator = line.find('=');
+
+        if(separator == std::string::npos)
+            options.emplace_back(line, "");
+        else
+            options.emplace_back(trim(line.substr(0, separator)), trim(line.substr(separator + 1)));
+    }
+
+    // As on the command line, the profile comes before the TCP options that adjust
+    // it, wherever it is in the file.
+    for(const auto& [key, value] : options)
+        if(key == "tcp-profile")
+            this->set(key, value);
+
+    for(const auto& [key, value] : options)
+        if(key != "tcp-profile")
+            this->set(key, value);
+}
+
+void DaemonConfig::set(const std::string& key, const std::string& value)
+{
+    if(key == "address")
+        address = value;
+    else if(key == "port")
+        port = static_cast<unsigned short>(parseNumber(key, value, 65535));
+    else if(key == "max-clients")
+        max_client_num = parseNumber(key, value, 1000000);
+    else if(key == "mode" && value == "shared")
+        mode = Server::ExecutionMode::Shared;
+    else if(key == "mode" && value == "per-core")
+        mode = Server::ExecutionMode::PerCore;
+    else if(key == "mode")
+        throw std::invalid_argument("Invalid value for mode: " + value);
+    else if(key == "group-chat")
+        group_chat = parseBool(key, value);
+    else if(key == "session-budget")
+        flow_control.session_budget = parseNumber(key, value, std::numeric_limits<unsigned long>::max());
+    else if(key == "slow-consumer" && value == "drop-oldest")
+        flow_control.policy = Server::SlowConsumerPolicy::DropOldest;
+    else if(key == "slow-consumer" && value == "drop-newest")
+        flow_control.policy = Server::SlowConsumerPolicy::DropNewest;
+    else if(key == "slow-consumer" && value == "disconnect")
+        flow_control.policy = Server::SlowConsumerPolicy::Disconnect;
+    else if(key == "slow-consumer")
+        throw std::invalid_argument("Invalid value for slow-consumer: " + value);
+    else if(key == "high-watermark")
+        flow_control.high_watermark = parseNumber(key, value, std::numeric_limits<unsigned long>::max());
+    else if(key == "heartbeat-interval")
+        liveness.heartbeat_interval = std::chrono::milliseconds(parseNumber(key, value, 86400000));
+    else if(key == "idle-timeout")
+        liveness.idle_timeout = std::chrono::milliseconds(parseNumber(key, value, 86400000));
+    else if(key == "compression")
+        compression.codec = parseCodec(key, value);
+    else if(key == "compression-threshold")
+        compression.threshold = parseNumber(key, value, Frame::MAX_PAYLOAD_SIZE);
+    else if(key == "log-dir")
+        chat_log.directory = value;
+    else if(key == "log-segment-size")
+        chat_log.segment_size = parseNumber(key, value, std::numeric_limits<unsigned long>::max());
+    else if(key == "log-retention")
+        chat_log.retention = parseNumber(key, value, std::numeric_limits<unsigned long>::max());
+    else if(key == "log-fsync")
+        chat_log.fsync = parseBool(key, value);
+    else if(key == "replay-limit")
+        chat_log.replay_limit = parseNumber(key, value, std::numeric_limits<unsigned long>::max());
+    else if(key == "file-dir")
+        file_store.directory = value;
+    else if(key == "file-max-size")
+        file_store.max_file_size = parseNumber(key, value, std::numeric_limits<unsigned long>::max());
+    else if(key == "tcp-profile")
+        socket_tuning = parseTuning(key, value);
+    else if(key == "tcp-nodelay")
+        socket_tuning.no_delay = parseBool(key, value);
+    else if(key == "tcp-quickack")
+        socket_tuning.quick_ack = parseBool(key, value);
+    else if(key == "tcp-sndbuf")
+        socket_tuning.send_buffer = static_cast<int>(parseNumber(key, value, std::numeric_limits<int>::max()));
+    else if(key == "tcp-rcvbuf")
+        socket_tuning.receive_buffer = static_cast<int>(parseNumber(key, value, std::numeric_limits<int>::max()));
+    else if(key == "tcp-notsent-lowat")
+        socket_tuning.not_sent_lowat = static_cast<int>(parseNumber(key, value, std::numeric_limits<int>::max()));
+    else if(key == "tcp-keepalive")
+        socket_tuning.keep_alive_idle = std::chrono::seconds(parseNumber(key, value, 86400));
+    else if(key == "tcp-keepalive-interval")
+        socket_tuning.keep_alive_interval = std::chrono::seconds(parseNumber(key, value, 86400));
+    else if(key == "tcp-keepalive-count")
+        socket_tuning.keep_alive_count = static_cast<int>(parseNumber(key, value, 1000));
+    else if(key == "listen-backlog")
+        socket_tuning.backlog = static_cast<int>(parseNumber(key, value, std::numeric_limits<int>::max()));
+    else if(key == "metrics-address")
+        metrics_address = value;
+    else if(key == "metrics-port")
+        metrics_port = static_cast<unsigned short>(parseNumber(key, value, 65535));
+    else if(key == "verbose")
+        verbose = parseBool(key, value);
+    else if(key == "help")
+        show_help = true;
+    else
+        throw std::invalid_argument("Unknown option: " + key);
+}
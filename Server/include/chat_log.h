@@ -0,0 +1,190 @@
+#ifndef CHAT_LOG_H
+#define CHAT_LOG_H
+
+#include <boost/thread.hpp>
+
+#include "frame.h"
+#include "message_record.h"
+#include "server_metrics.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+/**
+ * @class ChatLog
+ * @brief Persistent, append-only log of the relayed messages.
+ *
+ * The log is a directory of segment files, each named after the sequence number
+ * of its first message (00000000000000000001.log). A segment holds the frames
+ * exactly as they are written on the socket, every one a MessageRecord whose
+ * sequence field gives its position, so a replay needs no re-encoding. A new
+ * segment starts once the current one reaches segment_size bytes; the oldest
+ * segments are then deleted while the log is larger than retention bytes.
+ *
+ * append() runs on the relay path: it numbers the message, encodes its frame and
+ * queues a reference to it, nothing more. A writer thread takes everything queued
+ * since its last write and writes it with a single flush (group commit), followed
+ * by an fsync if requested, so the relay never waits for the disk.
+ *
+ * Every segment has a sparse index in memory, one (sequence, offset) entry every
+ * INDEX_INTERVAL bytes, rebuilt by scanning the segments when the log is opened.
+ * replay() seeks with the index, maps the segments and walks their frames in
+ * place; the messages not written yet are taken from the queue, so a replay
+ * always reaches the last appended message.
+ */
+class ChatLog
+{
+public:
+    /**
+     * @struct Options
+     * @brief Location and limits of the log.
+     */
+    struct Options
+    {
+        std::string   directory;                       ///< Directory of the segments, created if needed.
+        std::size_t   segment_size = 64 * 1024 * 1024; ///< Size at which a new segment is started.
+        std::uint64_t retention    = 1ull << 30;       ///< Bytes kept on disk, 0 to keep everything.
+        bool          fsync        = false;            ///< fsync after every group commit.
+        std::size_t   replay_limit = 1000;             ///< Most messages replayed for one request.
+    };
+
+private: // Fields
+    static constexpr std::size_t INDEX_INTERVAL = 4096;   ///< Bytes between two entries of a sparse index.
+
+    struct IndexEntry
+    {
+        std::uint64_t sequence;   ///< Sequence of a message.
+        std::uint64_t offset;     ///< Offset of its frame in the segment.
+    };
+
+    /**
+     * @struct Segment
+     * @brief One file of the log. Its size covers only flushed bytes, so the
+     *        whole of it can always be mapped.
+     */
+    struct Segment
+    {
+        std::string             path;    ///< Path of the file.
+        std::uint64_t           first;   ///< Sequence of its first message.
+        std::uint64_t           last;    ///< Sequence of its last written message (first - 1 if empty).
+        std::uint64_t           size;    ///< Bytes written and flushed.
+        std::vector<IndexEntry> index;   ///< Sparse index, ordered by sequence.
+    };
+
+    /**
+     * @struct Pending
+     * @brief A message appended and not written yet.
+     */
+    struct Pending
+    {
+        std::uint64_t                         sequence;   ///< Its sequence number.
+        SharedFrame                           frame;      ///< The frame that is also relayed.
+        std::chrono::steady_clock::time_point queued;     ///< When it was appended.
+    };
+
+    Options                   m_options;        ///< Location and limits.
+    std::deque<Segment>       m_segments;       ///< Oldest first; the last one is written to.
+    std::vector<Pending>      m_pending;        ///< Appended since the writer thread last took them.
+    std::vector<Pending>      m_writing;        ///< The group the writer thread is writing.
+    std::uint64_t             m_nextSequence;   ///< Sequence of the next appended message.
+    std::uint64_t             m_committed;      ///< Last sequence written to the segments.
+    bool                      m_stopping;       ///< Set by the destructor.
+    mutable boost::mutex      m_mutex;          ///< Guards the fields above.
+    boost::condition_variable m_wakeup;         ///< Wakes the writer thread up.
+
+    std::FILE*                m_file;           ///< The last segment, open for appending (writer thread only).
+    LogMetrics                m_metrics;        ///< Counters of the log.
+    boost::thread             m_writer;         ///< Writes the queued messages.
+
+private: // Methods
+    /**
+     * @brief recover Lists the segments of the directory and scans them.
+     * @throws std::runtime_error If the directory cannot be read.
+     */
+    void recover();
+    /**
+     * @brief scan Rebuilds the index, the last sequence and the size of a segment.
+     *        A frame cut by a crash at the end of the file is truncated away.
+     * @param segment The segment, whose path and first sequence are set.
+     */
+    void scan(Segment& segment);
+    /**
+     * @brief openSegment Starts a new segment and opens it for appending.
+     * @param first Sequence of its first message.
+     * @throws std::runtime_error If the file cannot be created.
+     */
+    void openSegment(const std::uint64_t first);
+    /**
+     * @brief closeSegment Flushes and closes the last segment.
+     * @return False if the flush failed.
+     */
+    bool closeSegment()                                                              noexcept;
+    /**
+     * @brief writeGroup Writes m_writing to the segments with a single flush per
+     *        segment, then publishes the new sizes and index entries.
+     */
+    void writeGroup()                                                                noexcept;
+    /**
+     * @brief enforceRetention Deletes the oldest segments while the log is larger
+     *        than the retention. The last segment is always kept.
+     */
+    void enforceRetention()                                                          noexcept;
+    /**
+     * @brief writerThread Loop of the writer thread.
+     */
+    void writerThread()                                                              noexcept;
+
+public:
+    /**
+     * @brief Opens the log, creating the directory if needed, and starts the writer thread.
+     * @param options Location and limits.
+     * @throws std::runtime_error If the directory or the segments cannot be used.
+     */
+    explicit ChatLog(Options options);
+    ChatLog(const ChatLog&)            = delete;
+    ChatLog& operator=(const ChatLog&) = delete;
+    /**
+     * @brief Writes the queued messages and stops the writer thread.
+     */
+    ~ChatLog();
+    /**
+     * @brief append Numbers a message and queues it for writing. Can be called from any thread.
+     * @param record The message; its sequence field is overwritten.
+     * @return The frame of the numbered message, to be relayed.
+     */
+    SharedFrame append(MessageRecord record);
+    /**
+     * @brief replay Hands over logged messages, oldest first. Can be called from any thread.
+     * @param after Only the messages with a larger sequence are replayed.
+     * @param count Only the last count of them are replayed.
+     * @param deliver Called for every message, with its frame.
+     * @return The last sequence of the log when the replay started; the messages
+     *         appended since then are not replayed.
+     */
+    std::uint64_t replay(const std::uint64_t after, const std::size_t count,
+                         const std::function<void(SharedFrame)>& deliver) const;
+    /**
+     * @brief lastSequence
+     * @return The sequence of the last appended message, 0 if the log is empty.
+     */
+    std::uint64_t lastSequence()                                               const noexcept;
+    /**
+     * @brief options
+     * @return The location and the limits of the log.
+     */
+    const Options& options()                                                   const noexcept;
+    /**
+     * @brief metrics
+     * @return The counters of the log.
+     */
+    const LogMetrics& metrics()                                                const noexcept;
+};
+
+#endif // CHAT_LOG_H
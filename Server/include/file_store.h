@@ -0,0 +1,141 @@
+#ifndef FILE_STORE_H
+#define FILE_STORE_H
+
+#include <boost/thread.hpp>
+
+#include "file_transfer.h"
+#include "frame.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+
+/**
+ * @class FileStore
+ * @brief Directory in which the server keeps the files the clients send, so that
+ *        any client can fetch them later.
+ *
+ * A file is written while it is relayed, chunk by chunk, to <id>.part (the id is
+ * the one of the transfer, in hexadecimal). Once its last chunk has arrived its
+ * offer is saved to <id>.offer and the file is renamed to <id>.data; only then
+ * can it be opened. The upload of a client that disconnects is deleted, and so
+ * are the .part files left behind by a crash, when the store is opened.
+ *
+ * Each upload is written by the strand of its client only; the lock guards the
+ * table of the uploads, never a write to the disk.
+ */
+class FileStore
+{
+public:
+    /**
+     * @struct Options
+     * @brief Location and limits of the store.
+     */
+    struct Options
+    {
+        std::string   directory;                   ///< Directory of the files, created if needed.
+        std::uint64_t max_file_size = 1ull << 30;  ///< Larger files are relayed but not stored.
+    };
+
+    /**
+     * @struct StoredFile
+     * @brief A complete file, open for reading; closed with its last reference.
+     */
+    struct StoredFile
+    {
+        std::FILE*    file = nullptr;   ///< The data, open for reading.
+        std::uint64_t id   = 0;         ///< Id of the transfer that stored it.
+        std::uint64_t size = 0;         ///< Size of the data.
+        SharedFrame   offer;            ///< Its FileOffer record, as the sender wrote it.
+        boost::mutex  read_mutex;       ///< Keeps a seek and its read together where the
+                                        ///< system has no positional read.
+
+        StoredFile() = default;
+        StoredFile(const StoredFile&)            = delete;
+        StoredFile& operator=(const StoredFile&) = delete;
+        ~StoredFile();
+    };
+
+private: // Fields
+    /**
+     * @struct Upload
+     * @brief A file being received.
+     */
+    struct Upload
+    {
+        std::unique_ptr<std::FILE, int(*)(std::FILE*)> file{nullptr, std::fclose};   ///< The .part file.
+        std::uint64_t                                  id       = 0;   ///< Id of the transfer.
+        std::uint64_t                                  size     = 0;   ///< Size announced by the offer.
+        std::uint64_t                                  received = 0;   ///< Bytes written so far.
+        std::uint64_t                                  owner    = 0;   ///< Connection id of the sender.
+        SharedFrame                                    offer;          ///< The offer, saved with the file.
+    };
+
+    Options                                                     m_options;   ///< Location and limits.
+    std::unordered_map<std::uint64_t, std::shared_ptr<Upload>> m_uploads;   ///< Files being received, by id.
+    mutable boost::mutex                                        m_mutex;     ///< Guards m_uploads.
+
+private: // Methods
+    /**
+     * @brief path
+     * @return The path of a file of the store: the id in hexadecimal, then the extension.
+     */
+    std::string path(const std::uint64_t id, const char* extension)                 const;
+    /**
+     * @brief finish Saves the offer of a complete upload and publishes its data.
+     * @return False if the files could not be written.
+     */
+    bool finish(Upload& upload)                                                        noexcept;
+
+public:
+    /**
+     * @brief Opens the store, creating the directory if needed and deleting the
+     *        uploads a crash left unfinished.
+     * @param options Location and limits.
+     * @throws std::runtime_error If the directory cannot be used.
+     */
+    explicit FileStore(Options options);
+    FileStore(const FileStore&)            = delete;
+    FileStore& operator=(const FileStore&) = delete;
+    /**
+     * @brief begin Starts storing a file announced by an offer.
+     * @param offer The offer.
+     * @param frame The frame of the offer, saved with the file.
+     * @param owner Connection id of the sender; only its chunks are written.
+     * @return False if the file is too large, its id is already used or it cannot be created.
+     */
+    bool begin(const FileTransfer::Offer& offer, const SharedFrame& frame, const std::uint64_t owner);
+    /**
+     * @brief write Appends a chunk to the file it belongs to. Must be called on the
+     *        strand of the owner.
+     * @param chunk The chunk.
+     * @param owner Connection id of the sender.
+     * @return False if the chunk belongs to no upload of the owner, does not follow
+     *         the previous one or cannot be written; the upload is dropped in the
+     *         last two cases.
+     */
+    bool write(const FileTransfer::Chunk& chunk, const std::uint64_t owner)             noexcept;
+    /**
+     * @brief abort Drops the unfinished uploads of a sender.
+     * @param owner Connection id of the sender.
+     */
+    void abort(const std::uint64_t owner)                                              noexcept;
+    /**
+     * @brief open Opens a complete file. Can be called from any thread.
+     * @param id Id of the transfer that stored it.
+     * @return The file, or nullptr if the store has no complete file with this id.
+     */
+    std::shared_ptr<const StoredFile> open(const std::uint64_t id)               const;
+    /**
+     * @brief options
+     * @return The location and the limits of the store.
+     */
+    const Options& options()                                                     const noexcept;
+};
+
+#endif // FILE_STORE_H
@@ -0,0 +1,78 @@
+#ifndef IO_CONTEXT_POOL_H
+#define IO_CONTEXT_POOL_H
+
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+
+/**
+ * @class IoContextPool
+ * @brief A set of io_contexts, each run by its own worker threads.
+ *
+ * With one context and several threads the pool behaves like a single shared
+ * io_context. With one context per core and one thread per context, every thread
+ * is pinned to its core and the handlers of a context always run on the same core.
+ */
+class IoContextPool
+{
+public:
+    using ErrorHandler = std::function<void(const char*)>;
+
+private: // Fields
+    using WorkGuard = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
+
+    std::vector<std::unique_ptr<boost::asio::io_context>> m_contexts;   ///< The io_contexts of the pool.
+    std::vector<WorkGuard>                                m_work;       ///< Keep the io_contexts running.
+    boost::thread_group                                   m_threads;    ///< Worker threads.
+    ErrorHandler                                          m_onError;    ///< Reports errors of the worker threads.
+
+private: // Methods
+    /**
+     * @brief workerThread Runs an io_context until it is stopped.
+     * @param io_cntxt The io_context run by the thread.
+     */
+    void workerThread(boost::asio::io_context& io_cntxt)                   noexcept;
+    /**
+     * @brief pinThread Binds a worker thread to a CPU core (Linux only).
+     * @param thread The worker thread.
+     * @param core The core index.
+     */
+    static void pinThread(boost::thread& thread, const std::size_t core)   noexcept;
+
+public:
+    /**
+     * @brief Creates the io_contexts and starts the worker threads.
+     * @param context_num Number of io_contexts.
+     * @param threads_per_context Number of threads running each io_context.
+     * @param pin_threads If true, thread i is pinned to core i.
+     * @param on_error Called from a worker thread when run() fails.
+     */
+    IoContextPool(const std::size_t context_num, const std::size_t threads_per_context,
+                  const bool pin_threads, ErrorHandler on_error);
+    /**
+     * @brief Stops the io_contexts and joins the worker threads.
+     */
+    ~IoContextPool();
+    /**
+     * @brief size
+     * @return The number of io_contexts.
+     */
+    std::size_t size()                                               const noexcept;
+    /**
+     * @brief context
+     * @param index Index of the io_context, smaller than size().
+     * @return The io_context.
+     */
+    boost::asio::io_context& context(const std::size_t index)              noexcept;
+    /**
+     * @brief stop Releases the work guards, stops the io_contexts and joins the threads.
+     */
+    void stop()                                                            noexcept;
+};
+
+#endif // IO_CONTEXT_POOL_H
@@ -0,0 +1,85 @@
+#ifndef METRICS_ENDPOINT_H
+#define METRICS_ENDPOINT_H
+
+#include <boost/asio.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+
+/**
+ * @class MetricsEndpoint
+ * @brief Minimal HTTP server answering "GET /metrics" with the Prometheus text.
+ *
+ * It runs on an io_context of the server, so it needs no thread of its own. Every
+ * request is served on its own connection: the request head is read, the metrics
+ * are rendered and written, and the connection is closed. A client that does not
+ * send a complete request in time is disconnected.
+ */
+class MetricsEndpoint
+{
+public:
+    using Renderer = std::function<std::string()>;   ///< Returns the metrics in the text format.
+
+private: // Fields
+    static constexpr std::size_t          MAX_REQUEST_SIZE = 8192;   ///< Maximum size of a request head.
+    static constexpr std::chrono::seconds REQUEST_TIMEOUT{5};        ///< Time allowed to send the request.
+    static constexpr std::chrono::milliseconds ACCEPT_RETRY_DELAY{100}; ///< Delay before accepting again
+                                                                        ///< after a failed accept.
+
+    struct Request;   ///< State of one HTTP connection.
+
+    boost::asio::io_context&       m_ioContext;  ///< Runs the acceptor and the connections.
+    boost::asio::ip::tcp::acceptor m_acceptor;   ///< Listens for scrapes.
+    Renderer                       m_render;     ///< Produces the response body.
+
+private: // Methods
+    /**
+     * @brief accept Waits for the next connection.
+     */
+    void accept()                                                                   noexcept;
+    /**
+     * @brief onRequest Answers a request whose head has been read.
+     * @param request The connection.
+     * @param ec The error code of the read.
+     */
+    void onRequest(const std::shared_ptr<Request>& request,
+                   const boost::system::error_code& ec)                             noexcept;
+    /**
+     * @brief response Builds a complete HTTP response.
+     * @param status Status line, without the protocol ("200 OK").
+     * @param content_type Value of the Content-Type header.
+     * @param body The response body.
+     */
+    static std::string response(std::string_view status, std::string_view content_type,
+                                std::string_view body);
+
+public:
+    /**
+     * @brief Creates a closed endpoint.
+     * @param io_cntxt The io_context that serves the requests.
+     * @param render Called for every scrape, from the threads of io_cntxt.
+     */
+    MetricsEndpoint(boost::asio::io_context& io_cntxt, Renderer render);
+    /**
+     * @brief open Starts listening.
+     * @param endpoint Address and port; port 0 picks a free port.
+     * @throws boost::system::system_error If the endpoint cannot be bound.
+     */
+    void open(const boost::asio::ip::tcp::endpoint& endpoint);
+    /**
+     * @brief close Stops listening. Requests already accepted are still answered.
+     */
+    void close()                                                                    noexcept;
+    /**
+     * @brief localEndpoint
+     * @return The endpoint the server listens on, or a default one if it is closed.
+     */
+    boost::asio::ip::tcp::endpoint localEndpoint()                            const noexcept;
+};
+
+#endif // METRICS_ENDPOINT_H
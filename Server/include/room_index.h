@@ -0,0 +1,141 @@
+#ifndef ROOM_INDEX_H
+#define ROOM_INDEX_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * @class RoomIndex
+ * @brief Subscriptions of the sessions of a shard: for every channel (see Channel),
+ *        the sessions that joined it.
+ *
+ * The members of a channel are a dense array of session ids, so a message to a
+ * channel walks its members only, one cache line for eight of them, however many
+ * other channels and sessions there are. Every session keeps, by slot index, the
+ * list of its channels and its position in each of them: a join appends to both, a
+ * leave swaps the last member of the channel into the freed position and fixes
+ * that member's entry, so both take constant time. A channel without members
+ * gives its storage back to a free list, which the next new channel reuses.
+ *
+ * The index is not thread safe: each shard has its own, used on its strand only.
+ */
+class RoomIndex
+{
+public:
+    using Member  = std::uint64_t;   ///< Id of a session in the table of its shard.
+    using Members = std::vector<Member>;
+
+    static constexpr std::size_t MAX_CHANNELS_PER_MEMBER = 64;   ///< Channels one session can join.
+
+private: // Fields
+    /**
+     * @struct Room
+     * @brief A channel and its members; free while its name is empty.
+     */
+    struct Room
+    {
+        std::string                name;      ///< The channel.
+        Members                    members;   ///< Its members, in no particular order.
+        std::vector<std::uint32_t> links;     ///< For each member, its entry in the member's subscriptions.
+    };
+
+    /**
+     * @struct Subscription
+     * @brief A channel joined by a session.
+     */
+    struct Subscription
+    {
+        std::uint32_t room;       ///< Index of the room in m_rooms.
+        std::uint32_t position;   ///< Index of the session in the room's members.
+    };
+
+    /**
+     * @struct NameHash
+     * @brief Hashes std::string and std::string_view alike, so that a name is looked up
+     *        without being copied.
+     */
+    struct NameHash
+    {
+        using is_transparent = void;
+
+        std::size_t operator()(std::string_view name) const noexcept { return std::hash<std::string_view>()(name); }
+    };
+
+    std::vector<Room>                                                          m_rooms;          ///< All the rooms created so far.
+    std::vector<std::uint32_t>                                                 m_freeRooms;      ///< Indexes of the free rooms.
+    std::unordered_map<std::string, std::uint32_t, NameHash, std::equal_to<>> m_names;          ///< Room of each channel.
+    std::vector<std::vector<Subscription>>                                     m_subscriptions;  ///< Channels of each session,
+                                                                                                ///< by slot index.
+    std::size_t                                                                m_size;           ///< Number of subscriptions.
+
+private: // Methods
+    /**
+     * @brief slotOf
+     * @return The slot index of a session id (its low 32 bits, see SlotTable).
+     */
+    static std::uint32_t slotOf(const Member member)                          noexcept;
+    /**
+     * @brief find
+     * @return The subscription of a session to a room, or nullptr.
+     */
+    const Subscription* find(const std::uint32_t room, const Member member)   const noexcept;
+    /**
+     * @brief remove Removes the subscription at an index of a session's list, and the
+     *        room if it has no member left.
+     */
+    void remove(const Member member, const std::uint32_t index)               noexcept;
+
+public:
+    /**
+     * @brief Constructs an empty index.
+     */
+    RoomIndex();
+    RoomIndex(const RoomIndex&)            = delete;
+    RoomIndex& operator=(const RoomIndex&) = delete;
+    /**
+     * @brief join Subscribes a session to a channel; does nothing if it already is.
+     * @param channel The channel.
+     * @param member The session.
+     * @return False if the session already joined MAX_CHANNELS_PER_MEMBER channels.
+     */
+    bool join(std::string_view channel, const Member member);
+    /**
+     * @brief leave Unsubscribes a session from a channel.
+     * @return False if the session had not joined it.
+     */
+    bool leave(std::string_view channel, const Member member)                 noexcept;
+    /**
+     * @brief leaveAll Unsubscribes a session from all its channels, when it closes.
+     */
+    void leaveAll(const Member member)                                        noexcept;
+    /**
+     * @brief members
+     * @return The members of a channel, or nullptr if it has none. The array is valid
+     *         until the next change of the index.
+     */
+    const Members* members(std::string_view channel)                          const noexcept;
+    /**
+     * @brief contains
+     * @return True if the session joined the channel.
+     */
+    bool contains(std::string_view channel, const Member member)              const noexcept;
+    /**
+     * @brief channels
+     * @return The channels a session joined. The names are valid until the next change
+     *         of the index.
+     */
+    std::vector<std::string_view> channels(const Member member)                const;
+    /**
+     * @brief size
+     * @return The number of subscriptions, all channels together.
+     */
+    std::size_t size()                                                         const noexcept;
+};
+
+#endif // ROOM_INDEX_H
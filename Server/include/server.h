@@ -3,65 +3,283 @@
 
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
-#include <boost/bind.hpp>
 
-#include <QDebug>
-#include <QObject>
-#include <QtNetwork/QNetworkInterface>
+#include "channel.h"
+#include "chat_log.h"
+#include "compression.h"
+#include "file_store.h"
+#include "file_transfer.h"
+#include "frame.h"
+#include "io_context_pool.h"
+#include "message_record.h"
+#include "metrics_endpoint.h"
+#include "room_index.h"
+#include "server_metrics.h"
+#include "session.h"
+#include "slot_table.h"
+#include "socket_tuning.h"
 
+#include <atomic>
 #include <cstring>
 #include <vector>
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <string>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
 
 
 /**
  * @class Server
- * @brief A TCP server implementation using Boost.Asio and Qt for asynchronous operations and GUI integration.
+ * @brief A TCP server implementation using Boost.Asio for asynchronous operations.
+ *
+ * The server does not depend on Qt: events are reported through the callbacks set
+ * with setCallbacks(), which are called from the worker threads. The GUI uses it
+ * through ServerAdapter, the headless daemon uses it directly.
  */
-class Server : public QObject
+class Server
 {
-    Q_OBJECT // For the use of signals.
+    friend class Session; // Sessions report received messages and their own closing.
+
+public:
+    static constexpr std::size_t  DEFAULT_MAX_CLIENT_NUM = 20000; ///< Default maximum number of clients that can connect.
+    static constexpr unsigned     DEFAULT_PORT           = 55555; ///< Default port number for the server.
+
+    /**
+     * @struct Callbacks
+     * @brief Events reported by the server. They are called from the worker threads
+     *        and must be set before startConnection().
+     */
+    struct Callbacks
+    {
+        /// Called when the server starts listening on an endpoint.
+        std::function<void(const std::shared_ptr<boost::asio::ip::tcp::endpoint>&)> listening_on;
+        /// Called for every message received from a client; the view is valid only during the call.
+        /// The first argument is the shard of the client: calls for the same shard never run
+        /// concurrently, so each shard can feed its own single-producer queue.
+        std::function<void(std::size_t, std::string_view)>                           message_received;
+        /// Called to report the server's connection status.
+        std::function<void(const char*)>                                             connection_status;
+    };
+
+    /**
+     * @brief What happens when a frame is delivered to a client whose write queue is
+     *        already over its byte budget.
+     */
+    enum class SlowConsumerPolicy
+    {
+        DropOldest,   ///< Queued frames that are not being written are discarded, oldest first.
+        DropNewest,   ///< The new frame is discarded.
+        Disconnect    ///< The client is disconnected.
+    };
+
+    /**
+     * @struct FlowControl
+     * @brief Limits on the memory held by the write queues. Must be set before
+     *        startConnection().
+     */
+    struct FlowControl
+    {
+        static constexpr std::size_t DEFAULT_SESSION_BUDGET = std::size_t(4) << 20;    ///< 4 MiB per client.
+        static constexpr std::size_t DEFAULT_HIGH_WATERMARK = std::size_t(256) << 20;  ///< 256 MiB in total.
+
+        std::size_t        session_budget = DEFAULT_SESSION_BUDGET;         ///< Bytes queued for one client before
+                                                                            ///< the policy applies.
+        SlowConsumerPolicy policy         = SlowConsumerPolicy::DropOldest; ///< What to do over the budget.
+        std::size_t        high_watermark = DEFAULT_HIGH_WATERMARK;         ///< Bytes queued for all the clients above
+                                                                            ///< which reads pause; 0 for no limit.
+    };
+
+    /**
+     * @struct Liveness
+     * @brief Heartbeats and idle timeouts of the client connections. Must be set
+     *        before startConnection().
+     *
+     * A client that vanishes without closing its connection (a laptop put to sleep,
+     * a cable pulled out) never sends a FIN, so its reads simply stop. The server
+     * sends a Heartbeat record to every client to which it wrote nothing for
+     * heartbeat_interval, and disconnects the clients from which it received
+     * nothing for idle_timeout. The client sends its own heartbeats, so an idle
+     * but alive client always stays below the timeout.
+     */
+    struct Liveness
+    {
+        static constexpr std::chrono::milliseconds DEFAULT_HEARTBEAT_INTERVAL{10000};
+        static constexpr std::chrono::milliseconds DEFAULT_IDLE_TIMEOUT{30000};
+
+        std::chrono::milliseconds heartbeat_interval = DEFAULT_HEARTBEAT_INTERVAL;  ///< Silence towards a client after
+                                                                                   ///< which a heartbeat is sent; 0 for none.
+        std::chrono::milliseconds idle_timeout       = DEFAULT_IDLE_TIMEOUT;        ///< Silence from a client after which
+                                                                                   ///< it is disconnected; 0 for never.
+    };
 
     /**
-     * @class Connection
-     * @brief Represents an active TCP connection between the server and a client.
+     * @struct CompressionPolicy
+     * @brief Compression of the relayed messages. Must be set before startConnection().
      *
-     * This class manages the socket used for communication and
-     * the connection state (active/inactive).
+     * A relayed message of at least threshold bytes is compressed once, when it is
+     * broadcast, and the clients that listed the codec in their Hello share the
+     * compressed frame; the others get the original. The compressed messages of the
+     * clients are accepted with any available codec whatever the policy, and are
+     * decompressed once, before they are logged and relayed.
+     */
+    struct CompressionPolicy
+    {
+        Compression::Codec codec     = Compression::Codec::None;         ///< Codec of the relayed messages, None for none.
+        std::size_t        threshold = Compression::DEFAULT_THRESHOLD;   ///< Smaller payloads are relayed as they are.
+    };
+
+    /**
+     * @brief How the worker threads are organized.
      */
-    struct Connection
+    enum class ExecutionMode
     {
-        std::shared_ptr<boost::asio::ip::tcp::socket> socket; ///< Client socket.
-        bool state;                                           ///< Socket status (connected or not)
+        Shared,   ///< One io_context shared by THREAD_NR threads.
+        PerCore   ///< One io_context per core, each run by one thread pinned to its core.
+    };
 
-        Connection(boost::asio::io_context& io_cntxt) :
-            socket(std::make_shared<boost::asio::ip::tcp::socket>(io_cntxt)),
-            state(false)
+private: // Fields
+    using SessionTable = SlotTable<std::shared_ptr<Session>>;
+    static_assert(std::is_same_v<SessionTable::Id, Session::Id>);
+
+    /**
+     * @struct ReplayedFrame
+     * @brief A logged message read for a replay, ready to be queued.
+     */
+    struct ReplayedFrame
+    {
+        SharedFrame frame;     ///< The frame, compressed if the client decodes the codec.
+        std::string channel;   ///< Its channel, empty for everyone.
+        std::size_t saved;     ///< Bytes the compression saved, 0 if not compressed.
+    };
+
+    /**
+     * @struct NameHash
+     * @brief Hashes std::string and std::string_view alike, so that a nickname is looked
+     *        up without being copied.
+     */
+    struct NameHash
+    {
+        using is_transparent = void;
+
+        std::size_t operator()(std::string_view name) const noexcept { return std::hash<std::string_view>()(name); }
+    };
+
+    /**
+     * @struct Broadcast
+     * @brief A frame waiting in the inbox of a shard for its fan-out.
+     */
+    struct Broadcast
+    {
+        SharedFrame                           frame;       ///< The frame, shared by all the sessions.
+        SharedFrame                           compressed;  ///< Its compressed copy, or an empty frame.
+        Compression::Codec                    codec;       ///< Codec of the compressed copy.
+        Session::Id                           except;      ///< Id of the session that must not receive it,
+                                                           ///< or Session::INVALID_ID.
+        bool                                  bulk;        ///< True for a file chunk.
+        std::chrono::steady_clock::time_point posted;      ///< When broadcast() was called.
+        std::string                           channel;     ///< Channel of the frame, empty for everyone.
+    };
+
+    /**
+     * @struct Shard
+     * @brief A group of sessions served by the same strand.
+     *
+     * Accepted sessions are spread round-robin over the shards. The sessions of a
+     * shard and its table are only touched on the shard's strand, so the broadcast
+     * walks them without any lock.
+     *
+     * The idle checks of all the sessions of a shard share one timing wheel, turned
+     * by one timer every IDLE_TICK, instead of a timer per connection.
+     *
+     * A session joins a channel in the room index of its own shard. A message to a
+     * channel is posted to every shard like a broadcast, but each shard then walks
+     * the members of the channel only.
+     *
+     * Broadcasts reach a shard through its inbox, the only part of the shard that
+     * other threads touch. The first broadcast into an empty inbox posts a fan-out
+     * to the strand; those that arrive before it runs join the same fan-out, so a
+     * burst of messages costs one post per shard, and every session gets all of
+     * them queued before its write loop wakes up: one gathered write per client.
+     */
+    struct Shard
+    {
+        Session::Strand                       strand;       ///< Executor of the shard and of all its sessions.
+        SessionTable                          sessions;     ///< Sessions of the shard (unbounded; the limit is global).
+        ShardMetrics                          metrics;      ///< Counters of the shard and of its sessions.
+        std::vector<std::shared_ptr<Session>> paused;       ///< Sessions waiting for the write queues to shrink.
+        boost::asio::steady_timer             resumeTimer;  ///< Checks the memory while sessions are paused.
+        Session::IdleWheel                    idleWheel;    ///< Next idle check of every session, by shard slot.
+        boost::asio::steady_timer             idleTimer;    ///< Turns the idle wheel.
+        std::chrono::steady_clock::time_point nextIdleTick; ///< When the idle wheel moves to its next tick.
+        RoomIndex                             rooms;        ///< Channels joined by the sessions, by shard slot.
+        std::vector<Broadcast>                delivering;   ///< Broadcasts of the fan-out in progress.
+
+        boost::mutex                          inboxMutex;   ///< Guards inbox and inboxPosted.
+        std::vector<Broadcast>                inbox;        ///< Broadcasts waiting for the next fan-out.
+        bool                                  inboxPosted;  ///< True while a fan-out is posted to the strand.
+
+        explicit Shard(boost::asio::io_context& io_cntxt) :
+            strand(boost::asio::make_strand(io_cntxt)),
+            sessions(std::numeric_limits<std::size_t>::max()),
+            resumeTimer(strand),
+            idleWheel(IDLE_WHEEL_SLOTS),
+            idleTimer(strand),
+            inboxPosted(false)
         {
         }
-        ~Connection() = default;
     };
 
-private: // Fields
     static constexpr std::uint8_t THREAD_NR      = 2;           ///< Number of worker threads for Boost.Asio.
-    static constexpr unsigned     SERVER_PORT    = 55555;       ///< Default port number for the server.
-    static constexpr std::uint8_t MAX_CLIENT_NUM = 5;           ///< Maximum number of clients that can connect.
+    static constexpr std::uint8_t REPLAY_THREAD_NR = 1;         ///< Threads reading the history for the replays.
+    static constexpr std::chrono::milliseconds ACCEPT_RETRY_DELAY{100}; ///< Delay before accepting again when
+                                                                        ///< the process is out of descriptors.
+    static constexpr std::chrono::milliseconds RESUME_CHECK_INTERVAL{5}; ///< How often paused reads check
+                                                                         ///< the memory again.
+    static constexpr std::chrono::milliseconds IDLE_TICK{250};          ///< Resolution of the idle checks.
+    static constexpr std::size_t               IDLE_WHEEL_SLOTS = 256;  ///< Slots of an idle wheel (one turn
+                                                                        ///< is 64 s; longer delays take turns).
 
-    std::unique_ptr<boost::asio::io_context>        m_io_cntxt;   ///< Boost.Asio IO context.
-    std::unique_ptr<boost::asio::io_context::work>  m_work;       ///< Keeps the io_context running.
+    std::unique_ptr<IoContextPool>                  m_pool;       ///< io_contexts and their worker threads.
+    std::vector<std::unique_ptr<Shard>>             m_shards;     ///< Session groups, one strand each.
+    std::atomic<std::size_t>                        m_nextShard;  ///< Round-robin counter for new sessions.
     std::unique_ptr<boost::asio::ip::tcp::acceptor> m_acceptor;   ///< TCP acceptor for incoming connections.
+    std::unique_ptr<boost::asio::steady_timer>      m_acceptRetryTimer; ///< Delays accept after descriptor exhaustion.
+    AcceptMetrics                                   m_acceptMetrics;    ///< Counters of the acceptor.
 
-    std::vector<Connection*>                        m_connections;///< TCP client connections.
+    std::unique_ptr<MetricsEndpoint>                m_metricsEndpoint;  ///< Serves the metrics over HTTP.
+    std::optional<boost::asio::ip::tcp::endpoint>   m_metricsAddress;   ///< Where the metrics are served, if anywhere.
 
-    // It is passed by signal, therefore it must have a copy constructor
-    std::shared_ptr<boost::asio::ip::tcp::endpoint> m_endpoint;   ///< Server endpoint for binding and listening.
+    std::unique_ptr<ChatLog>                        m_chatLog;          ///< History of the relayed messages, if kept.
+    std::optional<ChatLog::Options>                 m_chatLogOptions;   ///< Where the history is kept, if anywhere.
+
+    std::unique_ptr<FileStore>                      m_fileStore;        ///< Files sent by the clients, if kept.
+    std::optional<FileStore::Options>               m_fileStoreOptions; ///< Where the files are kept, if anywhere.
+
+    /// Reads the history for the replays, whose page faults must not stall a shard.
+    /// Declared after the log, so that it is stopped before the log closes.
+    std::unique_ptr<boost::asio::thread_pool>       m_replayPool;
 
-    boost::thread_group              m_threads;                   ///< Worker threads for handling asynchronous operations.
+    SessionTable                                    m_sessions;   ///< All connected sessions, indexed by id.
+    mutable boost::mutex                            m_sessionsMutex;///< Guards m_sessions.
 
-    std::vector<std::uint8_t>        m_received_buffer;           ///< Buffer for storing received data.
-    std::vector<std::uint8_t>        m_send_buffer;               ///< Buffer for storing data to send.
+    std::unordered_map<std::string, Session::Id, NameHash, std::equal_to<>>
+                                                    m_nicknames;      ///< Session owning each joined nickname.
+    boost::mutex                                    m_nicknamesMutex; ///< Guards m_nicknames, claimed from every shard.
+
+    // It is passed to the listening_on callback, therefore it is shared
+    std::shared_ptr<boost::asio::ip::tcp::endpoint> m_endpoint;   ///< Server endpoint for binding and listening.
+
+    Callbacks                        m_callbacks;                 ///< Event callbacks.
 
     std::optional<std::atomic<bool>> m_serverStatus;              ///< Indicates whether the server is active or not.
 
@@ -69,78 +287,186 @@ private: // Fields
                                                                   ///< connections (or has).
     bool                             m_isGroupChat;               ///< If true, the message received from a client is automatically
                                                                   ///< sent to the rest of the active clients.
+    FlowControl                      m_flowControl;               ///< Write queue limits.
+    Liveness                         m_liveness;                  ///< Heartbeats and idle timeouts.
+    SharedFrame                      m_heartbeat;                 ///< The heartbeat record, shared by all the sessions.
+    CompressionPolicy                m_compression;               ///< Compression of the relayed messages.
+    SharedFrame                      m_hello;                     ///< The answer to a Hello, listing the codecs of the server.
+    SocketTuning                     m_socketTuning;              ///< TCP options of the acceptor and the client sockets.
 
 private: // Methods
     /**
-     * @brief findLANIPAddress Obtaining the IP address of the device on the LAN.
+     * @brief raiseFileDescriptorLimit Raises the soft limit of open descriptors to the
+     *        hard limit, so that thousands of clients can be connected at once.
      */
-    void findLANIPAddress()                                noexcept;
+    void raiseFileDescriptorLimit()                        noexcept;
     /**
-     * @brief getSocketIndex
-     * @return
+     * @brief acceptLoop Accepts the incoming connections until the server stops.
+     *        Runs in the io_context of the acceptor.
      */
-    std::optional<std::uint8_t> getSocketIndex()           noexcept;
+    boost::asio::awaitable<void> acceptLoop();
     /**
-     * @brief Listens for incoming connections.
+     * @brief addSession Adds an accepted session to the server and its shard and
+     *        starts its loops, or closes it if the server is full.
+     * @param session The session whose socket was just accepted.
      */
-    void acceptConnection()                                noexcept;
+    void addSession(const std::shared_ptr<Session>& session)                noexcept;
     /**
-     * @brief Handles the completion of an asynchronous accept operation.
-     * @param ec Error code resulting from the accept operation.
-     * @param socket_index The index of the socket
+     * @brief onMessage Called by a session for every frame it receives.
+     * @param session The session that received the frame.
+     * @param payload The frame payload; it is valid only during the call.
      */
-    void onAccept(const boost::system::error_code& ec,
-                  const std::uint8_t socket_index)          noexcept;
+    void onMessage(Session& session, std::string_view payload)              noexcept;
     /**
-     * @brief Runs the Boost.Asio IO context in a separate worker thread.
+     * @brief replay Answers a History request with the logged messages it asks for,
+     *        followed by a History record that marks the end of the replay. Runs on
+     *        the strand of the session's shard.
+     * @param session The session that sent the request.
+     * @param request The request.
      */
-    void workerThread()                                     noexcept;
+    void replay(Session& session, const MessageRecord& request)             noexcept;
     /**
-     * @brief Server::recv
-     * @param socket_index
+     * @brief deliverReplay Queues the messages read for a replay on the session,
+     *        those of its channels only, then the History record that ends the
+     *        replay. Runs on the strand of the session's shard.
+     * @param session The session that asked for the replay.
+     * @param frames The messages read from the log, oldest first.
+     * @param last The last sequence of the log when it was read.
      */
-    void recv(const std::uint8_t socket_index)              noexcept;
+    void deliverReplay(Session& session, std::vector<ReplayedFrame>& frames,
+                       const std::uint64_t last)                            noexcept;
     /**
-     * @brief Handles completion of a receive operation.
-     * @param ec The error code from the operation.
-     * @param bytes The number of bytes received.
-     * @param socket_index The index of the socket for which the onRecv method calls
-     *        the recv method
+     * @brief subscribe Applies a Join or Leave record to the room index of the
+     *        session's shard. Runs on the strand of the session's shard. A nickname
+     *        belongs to the first session that joins it, until that session leaves
+     *        it or closes: a Join of it from another session is refused, and a
+     *        Leave of it from another session ignored.
+     * @param session The session that sent the record.
+     * @param request The record, whose channel is joined or left.
      */
-    void onRecv(const boost::system::error_code& ec, const size_t bytes,
-                const std::uint8_t socket_index)                            noexcept;
+    void subscribe(Session& session, const MessageRecord& request)          noexcept;
     /**
-     * @brief onSend
-     * @param ec
-     * @param bytes
+     * @brief claimNickname Makes a session the owner of a nickname, if no other owns it.
+     * @return False if another session owns it.
      */
-    void onSend(const boost::system::error_code& ec, const size_t bytes)    noexcept;
-
-
-signals:
+    bool claimNickname(std::string_view nickname, const Session::Id owner);
+    /**
+     * @brief releaseNickname Frees a nickname owned by a session.
+     * @return False if the session does not own it.
+     */
+    bool releaseNickname(std::string_view nickname, const Session::Id owner) noexcept;
+    /**
+     * @brief refuseJoin Answers a refused Join with a Leave of the same channel.
+     */
+    void refuseJoin(Session& session, std::string_view channel)             noexcept;
+    /**
+     * @brief routable Checks the channel of a record to relay: a valid nickname, a
+     *        room the sender joined, or none. Counts and reports the others.
+     * @return False if the record must be discarded.
+     */
+    bool routable(Session& session, const MessageRecord& record)            noexcept;
+    /**
+     * @brief relayFile Stores and relays a FileOffer or a FileChunk record, to the
+     *        members of its channel if it has one, otherwise to every client when
+     *        group chat is on. The chunks go behind the chat messages. Runs on the
+     *        strand of the session's shard.
+     * @param session The session that sent the record.
+     * @param record The decoded record.
+     * @param payload Its payload, relayed as it is.
+     */
+    void relayFile(Session& session, const MessageRecord& record, std::string_view payload) noexcept;
+    /**
+     * @brief serveFile Answers a FileFetch request with the offer and the chunks of
+     *        the stored file, or with an offer without a name if it is not stored.
+     *        Runs on the strand of the session's shard.
+     * @param session The session that sent the request.
+     * @param request The request.
+     */
+    void serveFile(Session& session, const MessageRecord& request)          noexcept;
+    /**
+     * @brief queuedBytes
+     * @return The bytes waiting in the write queues of all the shards. Every shard
+     *         keeps its own count, so this is a handful of relaxed loads.
+     */
+    std::int64_t queuedBytes()                                        const noexcept;
+    /**
+     * @brief overHighWatermark Called by a session after every read.
+     * @return True if the session must stop reading until the write queues shrink.
+     */
+    bool overHighWatermark()                                          const noexcept;
+    /**
+     * @brief pauseReading Parks a session whose read loop stopped because the server
+     *        was over its high-watermark. Runs on the strand of the session's shard.
+     * @param session The session.
+     */
+    void pauseReading(const std::shared_ptr<Session>& session)              noexcept;
+    /**
+     * @brief resumeReading Restarts the parked sessions of a shard once the write
+     *        queues are below 3/4 of the high-watermark, otherwise checks again later.
+     * @param shard The shard, on whose strand the call runs.
+     */
+    void resumeReading(Shard& shard)                                        noexcept;
+    /**
+     * @brief tickIdleWheel Moves the idle wheel of a shard up to the current time and
+     *        arms its timer for the next tick.
+     * @param shard The shard, on whose strand the call runs.
+     */
+    void tickIdleWheel(Shard& shard)                                        noexcept;
     /**
-     * @brief Signal emitted when the server starts listening on an endpoint.
-     * @param endpoint The endpoint on which the server is listening.
+     * @brief checkIdle Called when the idle check of a session is due: disconnects the
+     *        session if it was silent for the idle timeout, sends it a heartbeat if
+     *        nothing was written to it for the heartbeat interval, and schedules its
+     *        next check. A session that is gone is simply forgotten.
+     * @param shard The shard, on whose strand the call runs.
+     * @param slot The slot of the session in the shard.
      */
-    void listening_on(const std::shared_ptr<boost::asio::ip::tcp::endpoint>& endpoint);
+    void checkIdle(Shard& shard, const Session::Id slot)                    noexcept;
     /**
-     * @brief message_received It is emitted when the server receives a message from the client.
-     * @param message Message received
+     * @brief removeSession Called by a session when it closes.
+     * @param session The closed session.
      */
-    void message_received(const std::string& message);
+    void removeSession(const std::shared_ptr<Session>& session)             noexcept;
     /**
-     * @brief Signal emitted to indicate the server's connection status.
+     * @brief reportStatus Reports a connection status while the server is active.
      * @param status Connection status message.
      */
-    void connectionStatus(const char* status);
-
+    void reportStatus(const char* status)                                   noexcept;
+    /**
+     * @brief notifyStatus Calls the connection_status callback, if any.
+     * @param status Connection status message.
+     */
+    void notifyStatus(const char* status)                                   noexcept;
+    /**
+     * @brief broadcast Queues an already encoded frame on every active session.
+     *        The sessions share the frame, nothing is copied per client. The frame
+     *        goes into the inbox of every shard, and the fan-out runs on the shards'
+     *        own threads. A large frame is also compressed once, for the clients
+     *        that can decode it.
+     * @param frame The frame, shared by all the sessions.
+     * @param except A session that must not receive the frame (the sender of an echo).
+     *        Only its id is kept, whose generation tells it from a later session
+     *        reusing its slot or its address.
+     * @param bulk True for a file chunk, which is never compressed and goes behind the
+     *        other frames of every session.
+     * @param channel If not empty, only the members of this channel receive the frame.
+     */
+    void broadcast(const SharedFrame& frame, const Session* except = nullptr,
+                   const bool bulk = false, std::string_view channel = {})   noexcept;
+    /**
+     * @brief fanOut Delivers the broadcasts waiting in the inbox of a shard to its
+     *        sessions. Runs on the strand of the shard.
+     * @param shard The shard.
+     */
+    void fanOut(Shard& shard)                                               noexcept;
 
 public:
     /**
      * @brief Constructs a new Server object.
-     * @param parent The parent QObject.
+     * @param max_client_num Maximum number of clients connected at the same time.
+     * @param mode How the worker threads are organized.
      */
-    Server(QObject* parent = nullptr);
+    Server(const std::size_t max_client_num = DEFAULT_MAX_CLIENT_NUM,
+           const ExecutionMode mode = ExecutionMode::Shared);
     /**
      * @brief Destructor for the Server class.
      */
@@ -150,6 +476,82 @@ public:
      * @param value New value.
      */
     void setGroupChat(const bool value)                              noexcept;
+    /**
+     * @brief setCallbacks Sets the event callbacks. Must be called before startConnection().
+     * @param callbacks The callbacks; empty ones are ignored.
+     */
+    void setCallbacks(Callbacks callbacks)                           noexcept;
+    /**
+     * @brief setEndpoint Sets the endpoint on which startConnection() listens.
+     * @param endpoint Address and port.
+     */
+    void setEndpoint(const boost::asio::ip::tcp::endpoint& endpoint) noexcept;
+    /**
+     * @brief setFlowControl Sets the limits on the memory held by the write queues.
+     *        Must be called before startConnection().
+     * @param flow_control The limits.
+     */
+    void setFlowControl(const FlowControl& flow_control)             noexcept;
+    /**
+     * @brief setLiveness Sets the heartbeat interval and the idle timeout of the clients.
+     *        Must be called before startConnection().
+     * @param liveness The intervals.
+     */
+    void setLiveness(const Liveness& liveness)                       noexcept;
+    /**
+     * @brief setCompression Sets how the relayed messages are compressed.
+     *        Must be called before startConnection().
+     * @param compression The codec and the threshold; the codec must be available.
+     */
+    void setCompression(const CompressionPolicy& compression)        noexcept;
+    /**
+     * @brief setSocketTuning Sets the TCP options of the listening socket and of
+     *        every accepted one ("low-latency" by default). Must be called before
+     *        startConnection().
+     * @param tuning The options.
+     */
+    void setSocketTuning(const SocketTuning& tuning)                 noexcept;
+    /**
+     * @brief setChatLog Keeps every relayed message in a persistent log, opened by the
+     *        first startConnection(), and answers the History requests of the clients.
+     * @param options Location and limits of the log.
+     */
+    void setChatLog(const ChatLog::Options& options)                 noexcept;
+    /**
+     * @brief getChatLog
+     * @return The log, or nullptr if it is not kept or not open yet.
+     */
+    const ChatLog* getChatLog()                                const noexcept;
+    /**
+     * @brief setFileStore Keeps the files the clients send in a directory, opened by
+     *        the first startConnection(), and answers the FileFetch requests of the
+     *        clients with them.
+     * @param options Location and limits of the store.
+     */
+    void setFileStore(const FileStore::Options& options)             noexcept;
+    /**
+     * @brief getFileStore
+     * @return The store, or nullptr if files are not kept or it is not open yet.
+     */
+    const FileStore* getFileStore()                            const noexcept;
+    /**
+     * @brief setMetricsEndpoint Serves the metrics in the Prometheus text format at
+     *        http://endpoint/metrics, from startConnection() until closeConnection().
+     *        The requests are answered by the server's own threads.
+     * @param endpoint Address and port; a loopback address keeps the metrics local.
+     */
+    void setMetricsEndpoint(const boost::asio::ip::tcp::endpoint& endpoint) noexcept;
+    /**
+     * @brief getMetricsEndpoint
+     * @return The endpoint the metrics are served on (with the real port if port 0
+     *         was requested), or a default endpoint if they are not served.
+     */
+    boost::asio::ip::tcp::endpoint getMetricsEndpoint()        const noexcept;
+    /**
+     * @brief renderMetrics Sums the counters of all the shards.
+     * @return The metrics in the Prometheus text format.
+     */
+    std::string renderMetrics()                                const;
     /**
      * @brief getHasEverConnected
      * @return Returns a bool value indicating whether the server has had at
@@ -165,25 +567,33 @@ public:
     const std::optional<std::atomic<bool>>& is_working()       const noexcept;
     /**
      * @brief getClientNum
-     * @return
+     * @return The number of connected clients.
      */
-    uint8_t getClientNum()                                       const noexcept;
+    std::size_t getClientNum()                                   const noexcept;
     /**
-     * @brief startConnection Starts the server and listens for incoming connections.
+     * @brief getShardNum
+     * @return The number of shards, fixed at construction. Shard indexes passed to the
+     *         message_received callback are smaller than this value.
      */
-    void startConnection()                                           noexcept;
+    std::size_t getShardNum()                                    const noexcept;
     /**
-     * @brief Sends data to the connected client.
-     * @param send_buffer Buffer containing data to be sent.
-     * @param socket_index If the socket index is not specified, the
-     *        message is sent to all active clients.
+     * @brief setMaxClientNum Changes the maximum number of clients connected at the same
+     *        time. Clients that are already connected are not dropped.
+     * @param max_client_num New limit.
+     */
+    void setMaxClientNum(const std::size_t max_client_num)           noexcept;
+    /**
+     * @brief startConnection Starts the server and listens for incoming connections.
+     * @return True if the server is listening; otherwise the reason was reported
+     *         through the connection_status callback.
      */
-    void send(const std::vector<std::uint8_t>& send_buffer,
-              std::optional<std::uint8_t> socket_index = std::nullopt)noexcept;
+    bool startConnection()                                           noexcept;
     /**
-     * @brief Starts receiving data from the client.
+     * @brief Sends a chat message to all active clients, or to the members of its
+     *        channel if it has one. The record is serialized directly into the frame.
+     * @param record The message.
      */
-    void startRecv()                                                 noexcept;
+    void send(const MessageRecord& record)                           noexcept;
     /**
      * @brief Closes the current client connection.
      */
@@ -0,0 +1,113 @@
+#ifndef SERVER_ADAPTER_H
+#define SERVER_ADAPTER_H
+
+#include <QObject>
+#include <QList>
+#include <QtNetwork/QNetworkInterface>
+
+#include "chat_log_model.h"
+#include "message_inbox.h"
+#include "server.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+
+
+/**
+ * @class ServerAdapter
+ * @brief Thin Qt layer over the Qt-free Server.
+ *
+ * It turns the server callbacks into Qt signals and finds the LAN address to
+ * listen on, which needs QNetworkInterface.
+ *
+ * Received messages do not cross threads one signal at a time: the shards push
+ * them into a MessageInbox (one lock-free ring per shard) and the GUI thread is
+ * woken up once per burst to drain them, MAX_DRAIN_BATCH at a time.
+ */
+class ServerAdapter : public QObject
+{
+    Q_OBJECT // For the use of signals.
+
+private: // Fields
+    static constexpr std::size_t MAX_DRAIN_BATCH = 1024;        ///< Messages handed to the GUI per event-loop iteration.
+
+    std::unique_ptr<Server>                       m_server;     ///< The networking core.
+    std::unique_ptr<MessageInbox>                 m_inbox;      ///< Received messages, waiting for the GUI thread.
+    std::optional<boost::asio::ip::tcp::endpoint> m_endpoint;   ///< LAN endpoint, found on the first start.
+
+private: // Methods
+    /**
+     * @brief findLANIPAddress Obtaining the IP address of the device on the LAN.
+     * @return The endpoint to listen on, or nullopt if no LAN interface was found.
+     */
+    std::optional<boost::asio::ip::tcp::endpoint> findLANIPAddress() noexcept;
+    /**
+     * @brief drainMessages Runs on the GUI thread; decodes the queued records and emits
+     *        them as one batch. Payloads that are not valid records are skipped.
+     */
+    void drainMessages()                                             noexcept;
+
+signals:
+    /**
+     * @brief Signal emitted when the server starts listening on an endpoint.
+     * @param endpoint The endpoint on which the server is listening.
+     */
+    void listening_on(const std::shared_ptr<boost::asio::ip::tcp::endpoint>& endpoint);
+    /**
+     * @brief messages_received It is emitted on the GUI thread with the messages received
+     *        from the clients since the previous emission.
+     * @param messages Messages received, oldest first for every shard.
+     */
+    void messages_received(const QList<ChatMessage>& messages);
+    /**
+     * @brief Signal emitted to indicate the server's connection status.
+     * @param status Connection status message.
+     */
+    void connectionStatus(const QString& status);
+
+public:
+    /**
+     * @brief Constructs the adapter and the server it wraps.
+     * @param parent The parent QObject.
+     */
+    ServerAdapter(QObject* parent = nullptr);
+    /**
+     * @brief Destructor. Shuts the server down.
+     */
+    ~ServerAdapter();
+    /**
+     * @brief setGroupChat See Server::setGroupChat.
+     */
+    void setGroupChat(const bool value)                              noexcept;
+    /**
+     * @brief getHasEverConnected See Server::getHasEverConnected.
+     */
+    bool& getHasEverConnected()                                      noexcept;
+    /**
+     * @brief is_working See Server::is_working.
+     */
+    const std::optional<std::atomic<bool>>& is_working()       const noexcept;
+    /**
+     * @brief getClientNum See Server::getClientNum.
+     */
+    std::size_t getClientNum()                                 const noexcept;
+    /**
+     * @brief startConnection Finds the LAN address (the first time) and starts the server.
+     */
+    void startConnection()                                           noexcept;
+    /**
+     * @brief send See Server::send.
+     */
+    void send(const MessageRecord& record)                           noexcept;
+    /**
+     * @brief closeConnection See Server::closeConnection.
+     */
+    void closeConnection()                                           noexcept;
+    /**
+     * @brief finish See Server::finish.
+     */
+    void finish()                                                    noexcept;
+};
+
+#endif // SERVER_ADAPTER_H
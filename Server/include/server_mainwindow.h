@@ -1,8 +1,6 @@
 #ifndef CLIENT_SMAINWINDOW_H
 #define CLIENT_SMAINWINDOW_H
 
-#include <QScrollArea>
-#include <QScrollBar>
 #include <QMainWindow>
 #include <QPalette>
 #include <QApplication>
@@ -14,21 +12,24 @@
 #include <QLabel>
 #include <QString>
 
-#include "server.h"
+#include "chat_log_model.h"
+#include "chat_log_view.h"
+#include "server_adapter.h"
 
 /**
  * @class SMainWindow
  * @brief Main window for the server-side application of the LANChat.
  *
  * This class manages the server GUI, including menus, user input, and
- * connection status display. It communicates with the Server class to handle
- * network operations.
+ * connection status display. It communicates with the Server class, through
+ * ServerAdapter, to handle network operations.
  */
 class SMainWindow : public QMainWindow
 {
     Q_OBJECT
 public:
-    static inline const char* WINDOWNAME = "Server LANChat";
+    static inline const char* WINDOWNAME  = "Server LANChat";
+    static inline const char* SENDER_NAME = "SERVER";   ///< Sender of the messages typed in this window.
 
 private: // Fields
     QPalette*       m_widgetsPalette        {nullptr};
@@ -45,10 +46,10 @@ private: // Fields
 
     QLabel*         m_welcomeLabel          {nullptr};
     QLabel*         m_connectionStatusLabel {nullptr};
-    QLabel*         m_messagesLabel         {nullptr};
+    ChatLogView*    m_messagesView          {nullptr};
+    ChatLogModel*   m_messagesModel         {nullptr};
 
-    QScrollArea*    m_messagesLabelScroll   {nullptr};
-    QHBoxLayout*    m_messagesLabelLayout   {nullptr};
+    QHBoxLayout*    m_messagesLayout        {nullptr};
 
     QLineEdit*      m_userInputLine         {nullptr};
 
@@ -59,12 +60,9 @@ private: // Fields
     QPushButton*    m_sendButton            {nullptr};
 
     QString                        m_serverIP;
-    Server*                        m_server;
+    ServerAdapter*                 m_server;
     std::unique_ptr<boost::thread> m_serverThread;
 
-    std::vector<boost::uint8_t>    m_send_buffer;
-
-    boost::mutex                   m_messageLabelMutex;
 
     bool                           m_hasEverConnected;
 
@@ -109,10 +107,10 @@ private: // Methods
      */
     void addUserInput();
     /**
-     * @brief Adds a label for messages.
+     * @brief Adds the view of the message history.
      *        It is called in the connectionStatus method.
      */
-    void addMessagesLabel();
+    void addMessagesView();
     /**
      * @brief Calls the Sever::listen method for the server object in a temporary thread.
      *        If the central widget is initialized before the given
@@ -126,10 +124,15 @@ private: // Methods
      */
     void sendingMessages();
     /**
-     * @brief displayMessage Display messages in messageLabel.
+     * @brief displayMessage Appends a message to the message history.
      * @param message The message to display.
      */
-    void displayMessage(const std::string& message);
+    void displayMessage(const ChatMessage& message);
+    /**
+     * @brief displayMessages Appends a batch of messages to the message history.
+     * @param messages The messages to display.
+     */
+    void displayMessages(const QList<ChatMessage>& messages);
     /**
      * @brief cleanup Freeing memory allocated that was not freed through the parent-child relationship.
      */
@@ -147,9 +150,9 @@ private slots:
      *        It is connected to the Client::connectionStatus signal.
      * @param status Connection status given by the server object.
      */
-    void connectionStatus(const char* status);
+    void connectionStatus(const QString& status);
     /**
-     * @brief Deleting messages from messageLabel
+     * @brief Deleting messages from the message history
      */
     void clearMessages();
 
@@ -0,0 +1,200 @@
+#ifndef SERVER_METRICS_H
+#define SERVER_METRICS_H
+
+#include "latency_histogram.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+
+/**
+ * @class MetricCounter
+ * @brief Monotonic counter with a single writer.
+ *
+ * Every counter is written by one thread (or one strand) only, so an increment is
+ * a relaxed load and store and never a locked read-modify-write; any thread can
+ * read it at any time.
+ */
+class MetricCounter
+{
+private: // Fields
+    std::atomic<std::uint64_t> m_value{0};   ///< Current value.
+
+public:
+    void add(const std::uint64_t n = 1) noexcept
+    {
+        m_value.store(m_value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::uint64_t value()                                    const noexcept { return m_value.load(std::memory_order_relaxed); }
+};
+
+/**
+ * @class MetricGauge
+ * @brief Value that goes up and down, with a single writer.
+ */
+class MetricGauge
+{
+private: // Fields
+    std::atomic<std::int64_t> m_value{0};   ///< Current value.
+
+public:
+    void add(const std::int64_t n) noexcept
+    {
+        m_value.store(m_value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::int64_t value()                                     const noexcept { return m_value.load(std::memory_order_relaxed); }
+};
+
+/**
+ * @class MetricHistogram
+ * @brief Latency histogram with a single writer, readable while it is written.
+ *
+ * It has the log-linear buckets of LatencyHistogram, kept in atomics. Recording
+ * only touches one bucket and the sum; the percentiles are computed when the
+ * histogram is read, by copying it into a LatencyHistogram.
+ */
+class MetricHistogram
+{
+private: // Fields
+    std::array<std::atomic<std::uint64_t>, LatencyHistogram::BUCKET_NUM> m_buckets{};   ///< Values per bucket.
+    std::atomic<std::uint64_t>                                            m_sum{0};      ///< Sum of the values (ns).
+
+public:
+    /**
+     * @brief record Adds a duration.
+     * @param duration The measured duration.
+     */
+    void record(const std::chrono::nanoseconds duration) noexcept
+    {
+        const std::uint64_t nanoseconds = duration.count() > 0 ? static_cast<std::uint64_t>(duration.count()) : 0;
+        auto& bucket = m_buckets[LatencyHistogram::bucketOf(nanoseconds)];
+
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        m_sum.store(m_sum.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+    }
+    /**
+     * @brief collect Adds the current values to a histogram.
+     * @param histogram Receives the buckets.
+     * @return The sum of the values, in nanoseconds.
+     */
+    std::uint64_t collect(LatencyHistogram& histogram) const noexcept
+    {
+        for(std::size_t i = 0; i < m_buckets.size(); ++i)
+            histogram.add(i, m_buckets[i].load(std::memory_order_relaxed));
+
+        return m_sum.load(std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @struct ShardMetrics
+ * @brief Counters of a server shard.
+ *
+ * They are only written on the strand of the shard, by its sessions and its part
+ * of the broadcast, so they need no lock and no atomic read-modify-write. Each
+ * shard has its own block, aligned so that two shards never share a cache line;
+ * the blocks are summed only when the metrics are read.
+ */
+struct alignas(64) ShardMetrics
+{
+    MetricCounter   bytes_received;        ///< Bytes read from the clients.
+    MetricCounter   bytes_sent;            ///< Bytes written to the clients.
+    MetricCounter   messages_received;     ///< Frames received from the clients.
+    MetricCounter   invalid_messages;      ///< Received frames that were not valid records.
+    MetricCounter   frames_queued;         ///< Frames queued for delivery to a client.
+    MetricCounter   frames_dropped;        ///< Queued frames discarded because their write failed.
+    MetricCounter   frames_shed;           ///< Frames discarded because a client was over its budget.
+    MetricCounter   slow_disconnects;      ///< Clients disconnected because they were over their budget.
+    MetricCounter   reads_paused;          ///< Reads paused because the server was over its high-watermark.
+    MetricCounter   send_errors;           ///< Failed writes.
+    MetricCounter   messages_replayed;     ///< Logged messages sent again to a client that asked for them.
+    MetricCounter   heartbeats_sent;       ///< Heartbeats queued for clients to which nothing was written.
+    MetricCounter   idle_disconnects;      ///< Clients disconnected because they were silent for too long.
+    MetricCounter   frames_decompressed;   ///< Compressed messages received and decompressed.
+    MetricCounter   frames_compressed;     ///< Frames delivered compressed.
+    MetricCounter   compression_saved;     ///< Bytes the compressed frames saved over the originals.
+    MetricCounter   file_chunks_relayed;   ///< File chunks queued behind the other frames.
+    MetricCounter   file_bytes_served;     ///< Bytes of stored files sent to the clients that fetched them.
+    MetricCounter   messages_routed;       ///< Messages sent to a room or a nickname.
+    MetricCounter   messages_unrouted;     ///< Messages to a room the sender had not joined, or to an invalid channel.
+    MetricCounter   nickname_conflicts;    ///< Joins and leaves of a nickname owned by another session, refused.
+    MetricCounter   fan_outs;              ///< Fan-outs run, each delivering all the broadcasts waiting in the inbox.
+    MetricGauge     write_queue_depth;     ///< Frames waiting in the write queues of the shard.
+    MetricGauge     write_queue_bytes;     ///< Bytes waiting in the write queues of the shard.
+    MetricGauge     receive_buffer_bytes;  ///< Receive buffers held by the sessions of the shard.
+    MetricGauge     subscriptions;         ///< Channels joined by the sessions of the shard, all together.
+    MetricHistogram relay_latency;         ///< From the broadcast of a frame to its fan-out on the shard.
+    MetricHistogram write_latency;         ///< From the start to the completion of a write.
+};
+
+/**
+ * @struct AcceptMetrics
+ * @brief Counters of the acceptor; only written by its completion handlers, which
+ *        never run concurrently.
+ */
+struct alignas(64) AcceptMetrics
+{
+    MetricCounter accepted;        ///< Connections accepted and added to the server.
+    MetricCounter rejected;        ///< Connections closed because the server was full.
+    MetricCounter accept_errors;   ///< Failed accept operations.
+};
+
+/**
+ * @struct LogMetrics
+ * @brief Counters of the chat log. The appends are serialized by the log's lock,
+ *        everything else is written by its writer thread.
+ */
+struct alignas(64) LogMetrics
+{
+    MetricCounter   messages_appended;   ///< Messages numbered and queued for writing.
+    MetricCounter   commits;             ///< Groups of messages written with a single flush.
+    MetricCounter   write_errors;        ///< Groups that could not be written.
+    MetricGauge     bytes;               ///< Size of the segments on disk.
+    MetricGauge     segments;            ///< Number of segments on disk.
+    MetricHistogram commit_latency;      ///< From the append of the oldest message of a group to its flush.
+};
+
+/**
+ * @class PrometheusText
+ * @brief Writes metrics in the Prometheus text exposition format (version 0.0.4).
+ */
+class PrometheusText
+{
+private: // Fields
+    std::string m_text;   ///< The exposition written so far.
+
+private: // Methods
+    /**
+     * @brief header Writes the HELP and TYPE lines of a metric.
+     */
+    void header(std::string_view name, std::string_view help, std::string_view type);
+
+public:
+    /**
+     * @brief counter Writes a counter.
+     */
+    void counter(std::string_view name, std::string_view help, const std::uint64_t value);
+    /**
+     * @brief gauge Writes a gauge.
+     */
+    void gauge(std::string_view name, std::string_view help, const std::int64_t value);
+    /**
+     * @brief summary Writes a latency histogram as a summary in seconds, with its
+     *        p50, p90, p99 and p99.9 quantiles.
+     * @param histogram The durations, in nanoseconds.
+     * @param sum The sum of the durations, in nanoseconds.
+     */
+    void summary(std::string_view name, std::string_view help,
+                 const LatencyHistogram& histogram, const std::uint64_t sum);
+
+    const std::string& text()                                const noexcept { return m_text; }
+};
+
+#endif // SERVER_METRICS_H
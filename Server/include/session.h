@@ -0,0 +1,281 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <boost/asio.hpp>
+
+#include "compression.h"
+#include "file_store.h"
+#include "file_transfer.h"
+#include "frame.h"
+#include "server_metrics.h"
+#include "timing_wheel.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+class Server;
+
+
+/**
+ * @class Session
+ * @brief Represents an active TCP connection between the server and a client.
+ *
+ * A session owns everything that belongs to one client: the socket, the receive
+ * buffer, the queue of frames waiting to be written and the connection state.
+ * The reads and the writes are two coroutines, a read loop and a write loop, each
+ * keeping its state in its own frame. Both hold a shared_ptr to the session, so
+ * the session lives as long as the server keeps it or one of its loops runs.
+ *
+ * Both loops run on the session's strand, so reads, writes and the write queue
+ * never need a lock, and at most one write is in flight at a time.
+ * The strand is the one of the server shard that owns the session, so a session
+ * never leaves the io_context (and, in per-core mode, the core) of its shard.
+ *
+ * File chunks wait in a queue of their own and are written only while no other
+ * frame waits, one at a time, so a chat message never waits for more than one
+ * chunk. A stored file that the client fetched is streamed last, a chunk at a
+ * time, straight from the file to the socket (sendfile on Linux).
+ *
+ * A session has no timer of its own: it notes the tick of its shard's idle wheel
+ * at which it last received and wrote bytes, and the server checks these when
+ * the session's entry in the wheel expires.
+ */
+class Session : public std::enable_shared_from_this<Session>
+{
+public:
+    using Id         = std::uint64_t;   ///< Connection id, assigned by the server's session table.
+    using Strand     = boost::asio::strand<boost::asio::io_context::executor_type>;
+    using WriteQueue = std::deque<SharedFrame, PoolAllocator<SharedFrame>>;   ///< Its blocks come from the pool.
+    using IdleWheel  = TimingWheel<Id>;   ///< Idle checks of a shard, by shard slot.
+    using SharedFile = std::shared_ptr<const FileStore::StoredFile>;
+
+    static constexpr Id INVALID_ID = ~Id(0);   ///< Id of a session not stored in any table.
+
+private: // Fields
+    static constexpr std::size_t MAX_WRITE_BATCH      = 64;          ///< Maximum number of frames gathered in one write.
+    static constexpr std::size_t MAX_READS_PER_WAKEUP = 4;           ///< Reads per readiness event, for fairness.
+    static constexpr std::size_t SCRATCH_SIZE         = 64 * 1024;   ///< Per-thread overflow of a scatter read.
+    static constexpr std::size_t MAX_STREAMED_FILES   = 8;           ///< Stored files queued for one client.
+    static constexpr int         BULK_UNSENT_LIMIT    = 64 * 1024;   ///< Unsent bytes left in the kernel once a
+                                                                     ///< session carries files (Linux).
+
+    using ChunkPrefix = std::array<std::uint8_t, Frame::HEADER_SIZE + FileTransfer::CHUNK_HEADER_SIZE>;
+
+    Server&                                m_server;       ///< The server that accepted the session.
+    ShardMetrics&                          m_metrics;      ///< Counters of the shard, written on m_strand.
+    const IdleWheel&                       m_idleWheel;    ///< Idle wheel of the shard, read on m_strand.
+    Strand                                 m_strand;       ///< Strand of the shard; serializes the session.
+    boost::asio::ip::tcp::socket           m_socket;       ///< Client socket (its executor is m_strand).
+    boost::asio::steady_timer              m_writeSignal;  ///< Never expires; cancelled to wake the write loop.
+    FrameDecoder                           m_decoder;      ///< Receive buffer, split into frames.
+    std::size_t                            m_bufferBytes;  ///< Receive buffer size counted in the metrics.
+
+    WriteQueue                             m_writeQueue;   ///< Frames waiting to be written, oldest first.
+    std::vector<boost::asio::const_buffer> m_writeBuffers; ///< Buffer sequence of the write in flight.
+    std::size_t                            m_writeBatch;   ///< Number of queued frames in the write in flight.
+    std::size_t                            m_queuedBytes;  ///< Size of the frames in m_writeQueue.
+    WriteQueue                             m_bulkQueue;    ///< File chunks waiting behind m_writeQueue, oldest first.
+    std::size_t                            m_bulkBytes;    ///< Size of the frames in m_bulkQueue.
+    bool                                   m_bulkWriting;  ///< True while the front of m_bulkQueue is being written.
+    bool                                   m_bulkLimited;  ///< True once the unsent bytes of the socket are limited.
+    std::deque<SharedFile>                 m_files;        ///< Stored files to stream once both queues are empty.
+    std::uint64_t                          m_fileOffset;   ///< Bytes of the front of m_files already written.
+    ChunkPrefix                            m_chunkPrefix;  ///< Frame and record header of the stored file chunk in flight.
+    std::chrono::steady_clock::time_point  m_writeStart;   ///< When the write in flight was started.
+    IdleWheel::Tick                        m_lastReceive;  ///< Tick of the idle wheel of the last read.
+    IdleWheel::Tick                        m_lastSend;     ///< Tick of the idle wheel of the last write.
+    Compression::CodecSet                  m_codecs;       ///< Codecs the client can decode, from its Hello.
+
+    Id                                     m_id;           ///< Connection id (slot index and generation).
+    std::size_t                            m_shard;        ///< Index of the server shard owning the session.
+    Id                                     m_shardSlot;    ///< Slot of the session in its shard's table.
+    std::atomic<bool>                      m_state;        ///< Socket status (connected or not).
+    std::atomic<bool>                      m_reading;      ///< True once the read loop has been started.
+
+private: // Methods
+    /**
+     * @brief readLoop Waits until the socket is readable, reads what it holds and
+     *        hands the frames to the server, until the session closes or the server
+     *        pauses it. Runs on the strand.
+     * @param self Keeps the session alive while the loop runs.
+     */
+    boost::asio::awaitable<void> readLoop(std::shared_ptr<Session> self);
+    /**
+     * @brief readAvailable Reads the socket after a readiness event, at most
+     *        MAX_READS_PER_WAKEUP times.
+     * @param ec The error code of the wait.
+     * @return False if the session failed or was closed, and must stop reading.
+     */
+    bool readAvailable(const boost::system::error_code& ec)                   noexcept;
+    /**
+     * @brief readSome Non-blocking scatter read into the receive buffer and, for
+     *        the bytes that do not fit, the scratch buffer of the thread.
+     * @param ec Set to would_block when the socket has no more data.
+     * @return True if the read filled both buffers, so more data may be waiting.
+     */
+    bool readSome(boost::system::error_code& ec);
+    /**
+     * @brief releaseBuffer Gives the receive buffer back to the pool if no partial
+     *        frame is pending, and updates the metrics.
+     */
+    void releaseBuffer()                                                      noexcept;
+    /**
+     * @brief writeLoop Writes the queued frames (at most MAX_WRITE_BATCH at a time)
+     *        with gathered writes, and sleeps while the queue is empty. Runs on the
+     *        strand for the whole life of the session.
+     * @param self Keeps the session alive while the loop runs.
+     */
+    boost::asio::awaitable<void> writeLoop(std::shared_ptr<Session> self);
+    /**
+     * @brief writeFrames Writes the frames at the front of the write queue with a
+     *        single gathered write, and removes them once written.
+     * @param ec Receives the error of the write.
+     * @return The number of bytes written.
+     */
+    boost::asio::awaitable<std::size_t> writeFrames(boost::system::error_code& ec);
+    /**
+     * @brief writeBulk Writes the file chunk at the front of the bulk queue and
+     *        removes it once written.
+     * @param ec Receives the error of the write.
+     * @return The number of bytes written.
+     */
+    boost::asio::awaitable<std::size_t> writeBulk(boost::system::error_code& ec);
+    /**
+     * @brief writeFileChunk Writes the next chunk of the stored file at the front of
+     *        m_files: its header from the session, its data straight from the file.
+     * @param ec Receives the error of the write.
+     * @return The number of bytes written.
+     */
+    boost::asio::awaitable<std::size_t> writeFileChunk(boost::system::error_code& ec);
+    /**
+     * @brief limitUnsent Limits the unsent data the kernel keeps for the socket to
+     *        BULK_UNSENT_LIMIT before the first file chunk, so that the chat
+     *        messages queued later do not wait behind megabytes of chunks already
+     *        handed to the kernel. Does nothing where TCP_NOTSENT_LOWAT is missing.
+     */
+    void limitUnsent()                                                        noexcept;
+    /**
+     * @brief dropQueue Discards the queued frames and files after a failed write or a close.
+     */
+    void dropQueue()                                                          noexcept;
+    /**
+     * @brief makeRoom Applies the slow consumer policy of the server when a frame
+     *        would take the write queue over its byte budget.
+     * @param frame_size Size of the new frame.
+     * @return True if the new frame must still be queued.
+     */
+    bool makeRoom(const std::size_t frame_size)                               noexcept;
+
+public:
+    /**
+     * @brief Constructs a session whose socket is not connected yet.
+     * @param strand The strand of the shard; the socket operates in its io_context.
+     * @param server The server to which received messages are delivered.
+     * @param shard Index of the shard owning the session.
+     * @param metrics Counters of the shard.
+     * @param idle_wheel Idle wheel of the shard, whose ticks date the activity.
+     */
+    Session(Strand strand, Server& server, const std::size_t shard, ShardMetrics& metrics,
+            const IdleWheel& idle_wheel);
+    /**
+     * @brief socket Used by the acceptor to connect the session.
+     * @return The client socket.
+     */
+    boost::asio::ip::tcp::socket& socket()                                    noexcept;
+    /**
+     * @brief id
+     * @return The connection id assigned when the session was accepted.
+     */
+    Id id()                                                             const noexcept;
+    /**
+     * @brief setId Sets the connection id. Called once, before start().
+     * @param id The id of the session's slot in the server's table.
+     */
+    void setId(const Id id)                                                   noexcept;
+    /**
+     * @brief shard
+     * @return The index of the shard owning the session.
+     */
+    std::size_t shard()                                                 const noexcept;
+    /**
+     * @brief shardSlot / setShardSlot Slot of the session in its shard's table.
+     *        Only accessed on the strand.
+     */
+    Id shardSlot()                                                      const noexcept;
+    void setShardSlot(const Id slot)                                          noexcept;
+    /**
+     * @brief markActive Dates both the last read and the last write to the current
+     *        tick, when the session joins its shard. Must be called on the strand.
+     */
+    void markActive()                                                         noexcept;
+    /**
+     * @brief lastReceive / lastSend Ticks of the shard's idle wheel at which the
+     *        session last read and wrote bytes. Only accessed on the strand.
+     */
+    IdleWheel::Tick lastReceive()                                       const noexcept;
+    IdleWheel::Tick lastSend()                                          const noexcept;
+    /**
+     * @brief hasQueuedFrames
+     * @return True if frames or files are waiting or being written. Only accessed on the strand.
+     */
+    bool hasQueuedFrames()                                              const noexcept;
+    /**
+     * @brief codecs / setCodecs Compression codecs the client said it can decode,
+     *        none until its Hello arrives. Only accessed on the strand.
+     */
+    Compression::CodecSet codecs()                                      const noexcept;
+    void setCodecs(const Compression::CodecSet codecs)                        noexcept;
+    /**
+     * @brief is_open
+     * @return True if the session is connected.
+     */
+    bool is_open()                                                      const noexcept;
+    /**
+     * @brief start Marks the session as connected.
+     */
+    void start()                                                              noexcept;
+    /**
+     * @brief startRecv Starts the read loop. Calling it more than once has no effect.
+     */
+    void startRecv()                                                          noexcept;
+    /**
+     * @brief resumeRecv Restarts a read loop paused by the server's high-watermark.
+     *        Must be called on the strand.
+     */
+    void resumeRecv()                                                         noexcept;
+    /**
+     * @brief send Queues a frame for writing. Frames are written in the order in
+     *        which they were queued; frames queued while a write is in flight are
+     *        coalesced into the next write. Can be called from any thread.
+     * @param frame The encoded frame. The queue keeps a reference to it until it is written.
+     */
+    void send(SharedFrame frame)                                              noexcept;
+    /**
+     * @brief deliver Same as send(), for callers already running on the session's
+     *        strand (the shard broadcast); the frame is queued without a post.
+     * @param frame The encoded frame.
+     * @param bulk True for a file chunk: it waits until no other frame is queued, and
+     *        is discarded if the chunks already queued fill the byte budget (the
+     *        client then sees a gap in the file and drops it).
+     */
+    void deliver(SharedFrame frame, const bool bulk = false)                  noexcept;
+    /**
+     * @brief streamFile Queues the offer of a stored file, then its chunks, which are
+     *        read from the file only when the connection has nothing else to write.
+     *        Must be called on the strand.
+     * @param file The file; the session keeps it open until it has been sent.
+     */
+    void streamFile(SharedFile file)                                          noexcept;
+    /**
+     * @brief close Detaches the session from the server, then shuts down and closes
+     *        the socket on the strand. Can be called from any thread.
+     */
+    void close()                                                              noexcept;
+};
+
+#endif // SESSION_H
@@ -0,0 +1,164 @@
+#ifndef SLOT_TABLE_H
+#define SLOT_TABLE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @class SlotTable
+ * @brief Fixed-capacity table with O(1) insertion, lookup and removal.
+ *
+ * Freed slots are kept in a free list and reused by the next insertion. Every slot
+ * has a generation counter that is incremented when the slot is freed, and the id
+ * returned by insert() contains both the slot index and its generation. An id that
+ * refers to a slot which has since been reused therefore no longer matches, so a
+ * stale connection id can never reach the client that took its place.
+ *
+ * Slots are created lazily, the memory grows with the peak number of elements and
+ * not with the capacity. An id whose slot index is 0xFFFFFFFF is never issued and
+ * can be used as an invalid id. The table is not thread safe.
+ */
+template<typename T>
+class SlotTable
+{
+public:
+    using Id = std::uint64_t;   ///< Generation in the high 32 bits, slot index in the low 32 bits.
+
+private: // Fields
+    struct Slot
+    {
+        std::optional<T> value;        ///< Empty if the slot is free.
+        std::uint32_t    generation;   ///< Incremented every time the slot is freed.
+    };
+
+    std::vector<Slot>          m_slots;      ///< All the slots created so far.
+    std::vector<std::uint32_t> m_freeList;   ///< Indexes of the free slots.
+    std::size_t                m_capacity;   ///< Maximum number of elements.
+    std::size_t                m_size;       ///< Current number of elements.
+
+private: // Methods
+    static std::uint32_t indexOf(const Id id)                      noexcept { return std::uint32_t(id); }
+    static std::uint32_t generationOf(const Id id)                 noexcept { return std::uint32_t(id >> 32); }
+    static Id makeId(const std::uint32_t index, const std::uint32_t generation) noexcept
+    {
+        return (Id(generation) << 32) | index;
+    }
+
+public:
+    /**
+     * @brief Constructs an empty table.
+     * @param capacity Maximum number of elements.
+     */
+    explicit SlotTable(const std::size_t capacity)
+        : m_capacity(capacity),
+          m_size(0)
+    {
+    }
+    /**
+     * @brief insert Stores a value in a free slot.
+     * @param value The value to store.
+     * @return The id of the slot, or nullopt if the table is full.
+     */
+    std::optional<Id> insert(T value)
+    {
+        if(m_size >= m_capacity)
+            return std::nullopt;
+
+        std::uint32_t index;
+
+        if(!m_freeList.empty())
+        {
+            index = m_freeList.back();
+            m_freeList.pop_back();
+        }
+        else
+        {
+            index = static_cast<std::uint32_t>(m_slots.size());
+            m_slots.push_back(Slot{std::nullopt, 0});
+        }
+
+        m_slots[index].value = std::move(value);
+        ++m_size;
+
+        return makeId(index, m_slots[index].generation);
+    }
+    /**
+     * @brief erase Frees the slot of an id. Stale ids are ignored.
+     * @param id The id returned by insert().
+     * @return True if a value was removed.
+     */
+    bool erase(const Id id)
+    {
+        T* value = this->find(id);
+
+        if(!value)
+            return false;
+
+        const std::uint32_t index = indexOf(id);
+
+        m_slots[index].value.reset();
+        ++m_slots[index].generation;
+        m_freeList.push_back(index);
+        --m_size;
+
+        return true;
+    }
+    /**
+     * @brief find
+     * @param id The id returned by insert().
+     * @return The stored value, or nullptr if the id is stale or unknown.
+     */
+    T* find(const Id id) noexcept
+    {
+        const std::uint32_t index = indexOf(id);
+
+        if(index >= m_slots.size() || m_slots[index].generation != generationOf(id) ||
+           !m_slots[index].value.has_value())
+            return nullptr;
+
+        return &m_slots[index].value.value();
+    }
+    /**
+     * @brief forEach Calls f for every stored value.
+     * @param f Callable taking T&.
+     */
+    template<typename F>
+    void forEach(F&& f)
+    {
+        for(auto& slot : m_slots)
+            if(slot.value.has_value())
+                f(slot.value.value());
+    }
+    /**
+     * @brief clear Removes all the values. Outstanding ids become stale.
+     */
+    void clear()
+    {
+        for(std::uint32_t i = 0; i < m_slots.size(); ++i)
+        {
+            if(m_slots[i].value.has_value())
+            {
+                m_slots[i].value.reset();
+                ++m_slots[i].generation;
+                m_freeList.push_back(i);
+            }
+        }
+
+        m_size = 0;
+    }
+
+    std::size_t size()                                       const noexcept { return m_size; }
+    std::size_t capacity()                                   const noexcept { return m_capacity; }
+    bool full()                                              const noexcept { return m_size >= m_capacity; }
+    /**
+     * @brief setCapacity Changes the maximum number of elements. Values already
+     *        stored are kept even if there are more of them than the new capacity.
+     */
+    void setCapacity(const std::size_t capacity)                   noexcept { m_capacity = capacity; }
+};
+
+#endif // SLOT_TABLE_H
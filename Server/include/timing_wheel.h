@@ -0,0 +1,112 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @class TimingWheel
+ * @brief Hashed timing wheel: many timeouts driven by a single periodic tick.
+ *
+ * Time advances in ticks. The wheel is a ring of slots, a power of two of them,
+ * and an entry due at tick t waits in slot t % slot_num together with its
+ * deadline; a deadline more than one turn away simply stays in its slot for the
+ * following turns. schedule() is an O(1) append and advance() only looks at the
+ * slot of the new tick, so the cost per tick does not depend on how many entries
+ * the other slots hold.
+ *
+ * Entries are never cancelled: the owner of an entry checks, when it expires,
+ * whether it still matters (for instance whether the connection is still there
+ * or was active in the meantime) and schedules it again if needed. The wheel is
+ * not thread safe.
+ */
+template<typename T>
+class TimingWheel
+{
+public:
+    using Tick = std::uint64_t;   ///< Number of ticks since the wheel was created.
+
+private: // Fields
+    struct Entry
+    {
+        Tick deadline;   ///< Tick at which the entry expires.
+        T    value;      ///< What expires.
+    };
+
+    std::vector<std::vector<Entry>> m_slots;   ///< The ring; slot i holds the deadlines equal to i modulo its size.
+    std::vector<Entry>              m_due;     ///< Entries expiring in the current advance(), kept for its capacity.
+    std::size_t                     m_mask;    ///< Number of slots minus one.
+    Tick                            m_now;     ///< Current tick.
+    std::size_t                     m_size;    ///< Number of scheduled entries.
+
+public:
+    /**
+     * @brief Constructs an empty wheel at tick 0.
+     * @param slot_num Number of slots, rounded up to a power of two.
+     */
+    explicit TimingWheel(const std::size_t slot_num)
+        : m_mask(0),
+          m_now(0),
+          m_size(0)
+    {
+        std::size_t size = 1;
+        while(size < slot_num)
+            size <<= 1;
+
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+    /**
+     * @brief schedule Adds an entry.
+     * @param value What expires.
+     * @param delay Ticks from now; an entry is never due before the next tick.
+     */
+    void schedule(T value, const Tick delay)
+    {
+        const Tick deadline = m_now + (delay > 0 ? delay : 1);
+
+        m_slots[deadline & m_mask].push_back(Entry{deadline, std::move(value)});
+        ++m_size;
+    }
+    /**
+     * @brief advance Moves to the next tick and removes the entries due at it.
+     * @param expire Callable taking T&, called for every entry due; it may schedule
+     *        new entries.
+     */
+    template<typename F>
+    void advance(F&& expire)
+    {
+        ++m_now;
+
+        std::vector<Entry>& slot = m_slots[m_now & m_mask];
+
+        // The entries of later turns stay in the slot, in their order.
+        std::size_t kept = 0;
+
+        for(std::size_t i = 0; i < slot.size(); ++i)
+        {
+            if(slot[i].deadline <= m_now)
+                m_due.push_back(std::move(slot[i]));
+            else if(kept++ != i)
+                slot[kept - 1] = std::move(slot[i]);
+        }
+
+        slot.erase(slot.begin() + static_cast<std::ptrdiff_t>(kept), slot.end());
+        m_size -= m_due.size();
+
+        // The callbacks run once the slot is consistent, so they can schedule again.
+        for(Entry& entry : m_due)
+            expire(entry.value);
+
+        m_due.clear();
+    }
+
+    Tick        now()                                        const noexcept { return m_now; }
+    std::size_t size()                                       const noexcept { return m_size; }
+    std::size_t slotNum()                                    const noexcept { return m_mask + 1; }
+};
+
+#endif // TIMING_WHEEL_H
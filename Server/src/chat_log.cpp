@@ -0,0 +1,546 @@
+#include "chat_log.h"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr const char* SEGMENT_EXTENSION = ".log";
+
+    std::string segmentPath(const std::string& directory, const std::uint64_t first)
+    {
+        // Zero-padded, so that the names sort like the sequence numbers.
+        char name[32];
+        std::snprintf(name, sizeof(name), "%020llu%s", static_cast<unsigned long long>(first), SEGMENT_EXTENSION);
+
+        return (std::filesystem::path(directory) / name).string();
+    }
+
+    bool syncFile(std::FILE* file) noexcept
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        return ::fsync(::fileno(file)) == 0;
+#else
+        return true;
+#endif
+    }
+
+    /**
+     * @brief Calls visit(offset, frame_size, record) for every valid frame of a mapped
+     *        segment, in order, until visit returns false or the frames stop being valid.
+     * @return The offset following the last valid frame.
+     */
+    template<typename F>
+    std::size_t forEachFrame(const std::uint8_t* data, const std::size_t size, F&& visit)
+    {
+        std::size_t offset = 0;
+
+        while(offset + Frame::HEADER_SIZE <= size)
+        {
+            const std::uint32_t payload_size = Frame::decodeHeader(data + offset);
+            const std::size_t   frame_size   = Frame::HEADER_SIZE + payload_size;
+
+            if(payload_size > Frame::MAX_PAYLOAD_SIZE || frame_size > size - offset)
+                break;
+
+            const std::string_view payload(reinterpret_cast<const char*>(data + offset + Frame::HEADER_SIZE),
+                                           payload_size);
+            MessageRecord record;
+
+            if(!MessageRecord::decode(payload, record) || !visit(offset, frame_size, record))
+                break;
+
+            offset += frame_size;
+        }
+
+        return offset;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PRIVATE METHODS
+///
+void ChatLog::recover()
+{
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    fs::create_directories(m_options.directory, ec);
+
+    if(ec)
+        throw std::runtime_error("Cannot create the chat log directory " + m_options.directory + ": " + ec.message());
+
+    fs::directory_iterator entries(m_options.directory, ec);
+
+    if(ec)
+        throw std::runtime_error("Cannot read the chat log directory " + m_options.directory + ": " + ec.message());
+
+    for(const fs::directory_entry& entry : entries)
+    {
+        const fs::path&   path = entry.path();
+        const std::string stem = path.stem().string();
+        std::uint64_t     first = 0;
+
+        if(path.extension() != SEGMENT_EXTENSION || !entry.is_regular_file(ec))
+            continue;
+
+        const auto [end, error] = std::from_chars(stem.data(), stem.data() + stem.size(), first);
+
+        if(error != std::errc() || end != stem.data() + stem.size() || first == 0)
+            continue;
+
+        m_segments.push_back(Segment{path.string(), first, first - 1, 0, {}});
+    }
+
+    std::sort(m_segments.begin(), m_segments.end(),
+              [](const Segment& a, const Segment& b){ return a.first < b.first; });
+
+    for(Segment& segment : m_segments)
+        this->scan(segment);
+
+    // Empty segments are only useful at the end, where the next messages go.
+    for(auto it = m_segments.begin(); it != m_segments.end() && std::next(it) != m_segments.end();)
+    {
+        if(it->size == 0)
+        {
+            fs::remove(it->path, ec);
+            it = m_segments.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if(!m_segments.empty())
+        m_nextSequence = m_segments.back().last + 1;
+
+    m_committed = m_nextSequence - 1;
+
+    for(const Segment& segment : m_segments)
+    {
+        m_metrics.bytes.add(static_cast<std::int64_t>(segment.size));
+        m_metrics.segments.add(1);
+    }
+}
+
+void ChatLog::scan(Segment& segment)
+{
+    std::error_code ec;
+    const std::uintmax_t file_size = std::filesystem::file_size(segment.path, ec);
+
+    if(ec)
+        throw std::runtime_error("Cannot read the chat log segment " + segment.path + ": " + ec.message());
+
+    if(file_size == 0)
+        return;
+
+    std::size_t valid = 0;
+
+    try
+    {
+        const boost::interprocess::file_mapping  file(segment.path.c_str(), boost::interprocess::read_only);
+        const boost::interprocess::mapped_region region(file, boost::interprocess::read_only);
+
+        valid = forEachFrame(static_cast<const std::uint8_t*>(region.get_address()), region.get_size(),
+                             [&segment](const std::size_t offset, std::size_t, const MessageRecord& record){
+                                 // The sequence numbers only grow; anything else is damage.
+                                 if(record.sequence <= segment.last)
+                                     return false;
+
+                                 if(segment.index.empty() || offset - segment.index.back().offset >= INDEX_INTERVAL)
+                                     segment.index.push_back(IndexEntry{record.sequence, offset});
+
+                                 segment.last = record.sequence;
+                                 return true;
+                             });
+    }
+    catch (const boost::interprocess::interprocess_exception& e)
+    {
+        throw std::runtime_error("Cannot map the chat log segment " + segment.path + ": " + e.what());
+    }
+
+    // A frame cut by a crash (or anything after damage) is dropped, so that the
+    // next messages follow the last valid one.
+    if(valid < file_size)
+    {
+        std::filesystem::resize_file(segment.path, valid, ec);
+
+        if(ec)
+            throw std::runtime_error("Cannot repair the chat log segment " + segment.path + ": " + ec.message());
+    }
+
+    segment.size = valid;
+}
+
+void ChatLog::openSegment(const std::uint64_t first)
+{
+    const std::string path = segmentPath(m_options.directory, first);
+
+    m_file = std::fopen(path.c_str(), "ab");
+
+    if(!m_file)
+        throw std::runtime_error("Cannot create the chat log segment " + path);
+
+    {
+        boost::lock_guard<boost::mutex> lckgrd(m_mutex);
+        m_segments.push_back(Segment{path, first, first - 1, 0, {}});
+    }
+
+    m_metrics.segments.add(1);
+}
+
+bool ChatLog::closeSegment() noexcept
+{
+    if(!m_file)
+        return true;
+
+    bool ok = std::fflush(m_file) == 0;
+
+    if(ok && m_options.fsync)
+        ok = syncFile(m_file);
+
+    ok = std::fclose(m_file) == 0 && ok;
+    m_file = nullptr;
+
+    return ok;
+}
+
+void ChatLog::writeGroup() noexcept
+{
+    // Only this thread adds segments and writes to them, so it reads the last one
+    // without the lock; what it writes is published under the lock once flushed.
+    Segment*                segment = &m_segments.back();
+    std::uint64_t           size    = segment->size;
+    std::uint64_t           last    = segment->last;
+    std::vector<IndexEntry> entries;
+    bool                    failed  = !m_file;
+
+    const auto publish = [&](){
+        m_metrics.bytes.add(static_cast<std::int64_t>(size - segment->size));
+
+        boost::lock_guard<boost::mutex> lckgrd(m_mutex);
+
+        segment->size = size;
+        segment->last = last;
+        segment->index.insert(segment->index.end(), entries.begin(), entries.end());
+        entries.clear();
+    };
+
+    try
+    {
+        for(const Pending& pending : m_writing)
+        {
+            if(failed)
+                break;
+
+            const std::size_t frame_size = pending.frame.size();
+
+            if(size > 0 && size + frame_size > m_options.segment_size)
+            {
+                if(!this->closeSegment())
+                {
+                    failed = true;
+                    break;
+                }
+
+                publish();
+
+                this->openSegment(pending.sequence);
+                segment = &m_segments.back();
+                size    = 0;
+                last    = pending.sequence - 1;
+
+                this->enforceRetention();
+            }
+
+            const std::uint64_t indexed = !entries.empty()        ? entries.back().offset
+                                        : !segment->index.empty() ? segment->index.back().offset
+                                                                  : 0;
+
+            if((entries.empty() && segment->index.empty()) || size - indexed >= INDEX_INTERVAL)
+                entries.push_back(IndexEntry{pending.sequence, size});
+
+            if(std::fwrite(pending.frame.buffer().data(), 1, frame_size, m_file) != frame_size)
+            {
+                failed = true;
+                break;
+            }
+
+            size += frame_size;
+            last  = pending.sequence;
+        }
+
+        // One flush (and one fsync) for the whole group.
+        if(!failed)
+            failed = std::fflush(m_file) != 0 || (m_options.fsync && !syncFile(m_file));
+    }
+    catch (const std::exception&)
+    {
+        failed = true;
+    }
+
+    if(failed)
+    {
+        // The segment is cut back to its last flushed frame, so that it stays a
+        // sequence of frames; the messages of the group are lost.
+        m_metrics.write_errors.add();
+
+        this->closeSegment();
+
+        std::error_code ec;
+        std::filesystem::resize_file(segment->path, segment->size, ec);
+
+        m_file = std::fopen(segment->path.c_str(), "ab");
+    }
+    else
+    {
+        publish();
+
+        m_metrics.commits.add();
+        m_metrics.commit_latency.record(std::chrono::steady_clock::now() - m_writing.front().queued);
+    }
+
+    boost::lock_guard<boost::mutex> lckgrd(m_mutex);
+
+    m_committed = m_writing.back().sequence;
+    m_writing.clear();
+}
+
+void ChatLog::enforceRetention() noexcept
+{
+    if(m_options.retention == 0)
+        return;
+
+    std::vector<std::string> removed;
+    {
+        boost::lock_guard<boost::mutex> lckgrd(m_mutex);
+
+        while(m_segments.size() > 1 && static_cast<std::uint64_t>(m_metrics.bytes.value()) > m_options.retention)
+        {
+            m_metrics.bytes.add(-static_cast<std::int64_t>(m_segments.front().size));
+            m_metrics.segments.add(-1);
+
+            removed.push_back(std::move(m_segments.front().path));
+            m_segments.pop_front();
+        }
+    }
+
+    // A replay that mapped one of them keeps reading it; the files go away afterwards.
+    for(const std::string& path : removed)
+    {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+    }
+}
+
+void ChatLog::writerThread() noexcept
+{
+    while(true)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(m_mutex);
+
+            while(m_pending.empty() && !m_stopping)
+                m_wakeup.wait(lock);
+
+            if(m_pending.empty())
+                break;
+
+            // Everything appended while the previous group was written makes the next group.
+            m_writing.swap(m_pending);
+        }
+
+        this->writeGroup();
+    }
+
+    this->closeSegment();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+ChatLog::ChatLog(Options options)
+    : m_options(std::move(options)),
+      m_nextSequence(1),
+      m_committed(0),
+      m_stopping(false),
+      m_file(nullptr)
+{
+    this->recover();
+
+    if(m_segments.empty() || m_segments.back().size >= m_options.segment_size)
+    {
+        this->openSegment(m_nextSequence);
+    }
+    else
+    {
+        m_file = std::fopen(m_segments.back().path.c_str(), "ab");
+
+        if(!m_file)
+            throw std::runtime_error("Cannot open the chat log segment " + m_segments.back().path);
+    }
+
+    try
+    {
+        m_writer = boost::thread([this](){ this->writerThread(); });
+    }
+    catch (...)
+    {
+        this->closeSegment();
+        throw;
+    }
+}
+
+ChatLog::~ChatLog()
+{
+    {
+        boost::lock_guard<boost::mutex> lckgrd(m_mutex);
+        m_stopping = true;
+    }
+
+    m_wakeup.notify_one();
+    m_writer.join();
+}
+
+SharedFrame ChatLog::append(MessageRecord record)
+{
+    SharedFrame frame;
+    bool        first_pending = false;
+    {
+        boost::lock_guard<boost::mutex> lckgrd(m_mutex);
+
+        // Numbering and queueing under the same lock keep the log in sequence order.
+        record.sequence = m_nextSequence;
+        frame = record.toFrame();
+
+        m_pending.push_back(Pending{record.sequence, frame, std::chrono::steady_clock::now()});
+        ++m_nextSequence;
+
+        m_metrics.messages_appended.add();
+        first_pending = m_pending.size() == 1;
+    }
+
+    // The writer thread only sleeps while nothing is pending.
+    if(first_pending)
+        m_wakeup.notify_one();
+
+    return frame;
+}
+
+std::uint64_t ChatLog::replay(const std::uint64_t after, const std::size_t count,
+                              const std::function<void(SharedFrame)>& deliver) const
+{
+    struct Range
+    {
+        std::string   path;     ///< Segment file.
+        std::uint64_t offset;   ///< Where to start reading.
+        std::uint64_t size;     ///< Flushed size of the segment.
+    };
+
+    std::vector<Range>       ranges;
+    std::vector<SharedFrame> unwritten;
+    std::uint64_t            first     = 0;
+    std::uint64_t            committed = 0;
+    std::uint64_t            last      = 0;
+    {
+        boost::lock_guard<boost::mutex> lckgrd(m_mutex);
+
+        last = m_nextSequence - 1;
+
+        if(count == 0 || last <= after)
+            return last;
+
+        first     = std::max(after + 1, last - std::min<std::uint64_t>(count, last) + 1);
+        committed = m_committed;
+
+        for(const Segment& segment : m_segments)
+        {
+            if(segment.size == 0 || segment.last < first || segment.first > committed)
+                continue;
+
+            // The last index entry at or before the first wanted message.
+            const auto entry = std::upper_bound(segment.index.begin(), segment.index.end(), first,
+                                                [](const std::uint64_t sequence, const IndexEntry& e){
+                                                    return sequence < e.sequence;
+                                                });
+            const std::uint64_t offset = entry == segment.index.begin() ? 0 : std::prev(entry)->offset;
+
+            ranges.push_back(Range{segment.path, offset, segment.size});
+        }
+
+        for(const std::vector<Pending>* queue : {&m_writing, &m_pending})
+        {
+            for(const Pending& pending : *queue)
+                if(pending.sequence >= first && pending.sequence > committed)
+                    unwritten.push_back(pending.frame);
+        }
+    }
+
+    for(const Range& range : ranges)
+    {
+        try
+        {
+            const boost::interprocess::file_mapping  file(range.path.c_str(), boost::interprocess::read_only);
+            const boost::interprocess::mapped_region region(file, boost::interprocess::read_only,
+                                                            static_cast<boost::interprocess::offset_t>(range.offset),
+                                                            range.size - range.offset);
+
+            forEachFrame(static_cast<const std::uint8_t*>(region.get_address()), region.get_size(),
+                         [&](const std::size_t offset, const std::size_t frame_size, const MessageRecord& record){
+                             if(record.sequence > committed)
+                                 return false;
+
+                             if(record.sequence >= first)
+                             {
+                                 const auto* data = static_cast<const std::uint8_t*>(region.get_address()) + offset;
+
+                                 deliver(SharedFrame::create(frame_size - Frame::HEADER_SIZE,
+                                                             [data, frame_size](std::uint8_t* out){
+                                                                 std::memcpy(out, data + Frame::HEADER_SIZE,
+                                                                             frame_size - Frame::HEADER_SIZE);
+                                                             }));
+                             }
+
+                             return true;
+                         });
+        }
+        catch (const boost::interprocess::interprocess_exception&)
+        {
+            // The retention deleted the segment in the meantime: its messages are gone.
+        }
+    }
+
+    for(SharedFrame& frame : unwritten)
+        deliver(std::move(frame));
+
+    return last;
+}
+
+std::uint64_t ChatLog::lastSequence() const noexcept
+{
+    boost::lock_guard<boost::mutex> lckgrd(m_mutex);
+
+    return m_nextSequence - 1;
+}
+
+const ChatLog::Options& ChatLog::options() const noexcept
+{
+    return m_options;
+}
+
+const LogMetrics& ChatLog::metrics() const noexcept
+{
+    return m_metrics;
+}
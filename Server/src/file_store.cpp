@@ -0,0 +1,230 @@
+#include "file_store.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+    constexpr const char* PART_EXTENSION  = ".part";
+    constexpr const char* DATA_EXTENSION  = ".data";
+    constexpr const char* OFFER_EXTENSION = ".offer";
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PRIVATE METHODS
+///
+std::string FileStore::path(const std::uint64_t id, const char* extension) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx%s", static_cast<unsigned long long>(id), extension);
+
+    return (std::filesystem::path(m_options.directory) / name).string();
+}
+
+bool FileStore::finish(Upload& upload) noexcept
+{
+    try
+    {
+        // Flushed and closed before it is published.
+        if(std::fclose(upload.file.release()) != 0)
+            return false;
+
+        const std::string offer_path = this->path(upload.id, OFFER_EXTENSION);
+        const std::string_view offer = upload.offer.payload();
+
+        std::unique_ptr<std::FILE, int(*)(std::FILE*)> file(std::fopen(offer_path.c_str(), "wb"), std::fclose);
+
+        if(!file || std::fwrite(offer.data(), 1, offer.size(), file.get()) != offer.size() ||
+           std::fclose(file.release()) != 0)
+            return false;
+
+        // The rename makes the file visible to open() at once and whole.
+        std::error_code ec;
+        std::filesystem::rename(this->path(upload.id, PART_EXTENSION), this->path(upload.id, DATA_EXTENSION), ec);
+
+        if(ec)
+            std::filesystem::remove(offer_path, ec);
+
+        return !ec;
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+FileStore::StoredFile::~StoredFile()
+{
+    if(file)
+        std::fclose(file);
+}
+
+FileStore::FileStore(Options options)
+    : m_options(std::move(options))
+{
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    fs::create_directories(m_options.directory, ec);
+
+    if(ec)
+        throw std::runtime_error("Cannot create the file store directory " + m_options.directory + ": " + ec.message());
+
+    fs::directory_iterator entries(m_options.directory, ec);
+
+    if(ec)
+        throw std::runtime_error("Cannot read the file store directory " + m_options.directory + ": " + ec.message());
+
+    // The uploads interrupted by a crash can never be completed.
+    std::vector<fs::path> unfinished;
+
+    for(const fs::directory_entry& entry : entries)
+    {
+        if(entry.path().extension() == PART_EXTENSION)
+            unfinished.push_back(entry.path());
+    }
+
+    for(const fs::path& path : unfinished)
+        fs::remove(path, ec);
+}
+
+bool FileStore::begin(const FileTransfer::Offer& offer, const SharedFrame& frame, const std::uint64_t owner)
+{
+    if(offer.size > m_options.max_file_size)
+        return false;
+
+    auto upload = std::make_shared<Upload>();
+    upload->id    = offer.id;
+    upload->size  = offer.size;
+    upload->owner = owner;
+    upload->offer = frame;
+
+    {
+        boost::lock_guard<boost::mutex> lckgrd(m_mutex);
+
+        // A stored file is never replaced: its id may already have been handed out.
+        if(m_uploads.count(offer.id) != 0 || std::filesystem::exists(this->path(offer.id, DATA_EXTENSION)))
+            return false;
+
+        m_uploads.emplace(offer.id, upload);
+    }
+
+    const std::string part_path = this->path(offer.id, PART_EXTENSION);
+    upload->file.reset(std::fopen(part_path.c_str(), "wb"));
+
+    // An empty file is complete as soon as it is offered.
+    if(!upload->file || upload->size == 0)
+    {
+        {
+            boost::lock_guard<boost::mutex> lckgrd(m_mutex);
+            m_uploads.erase(offer.id);
+        }
+
+        return upload->file && this->finish(*upload);
+    }
+
+    return true;
+}
+
+bool FileStore::write(const FileTransfer::Chunk& chunk, const std::uint64_t owner) noexcept
+{
+    std::shared_ptr<Upload> upload;
+    {
+        boost::lock_guard<boost::mutex> lckgrd(m_mutex);
+
+        const auto it = m_uploads.find(chunk.id);
+
+        if(it == m_uploads.end() || it->second->owner != owner)
+            return false;
+
+        upload = it->second;
+    }
+
+    // The chunks come in order; anything else means that the file is corrupt.
+    const bool written = chunk.offset == upload->received && chunk.data.size() <= upload->size - upload->received &&
+                         std::fwrite(chunk.data.data(), 1, chunk.data.size(), upload->file.get()) == chunk.data.size();
+
+    if(written)
+        upload->received += chunk.data.size();
+
+    if(!written || upload->received == upload->size)
+    {
+        {
+            boost::lock_guard<boost::mutex> lckgrd(m_mutex);
+            m_uploads.erase(chunk.id);
+        }
+
+        if(written && this->finish(*upload))
+            return true;
+
+        std::error_code ec;
+        upload->file.reset();
+        std::filesystem::remove(this->path(chunk.id, PART_EXTENSION), ec);
+        return false;
+    }
+
+    return true;
+}
+
+void FileStore::abort(const std::uint64_t owner) noexcept
+{
+    std::vector<std::uint64_t> aborted;
+    {
+        boost::lock_guard<boost::mutex> lckgrd(m_mutex);
+
+        for(auto it = m_uploads.begin(); it != m_uploads.end();)
+        {
+            if(it->second->owner == owner)
+            {
+                aborted.push_back(it->first);
+                it = m_uploads.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    // A chunk being written keeps its upload open; the file is deleted anyway.
+    for(const std::uint64_t id : aborted)
+    {
+        std::error_code ec;
+        std::filesystem::remove(this->path(id, PART_EXTENSION), ec);
+    }
+}
+
+std::shared_ptr<const FileStore::StoredFile> FileStore::open(const std::uint64_t id) const
+{
+    auto stored = std::make_shared<StoredFile>();
+    stored->id = id;
+
+    const std::string data_path = this->path(id, DATA_EXTENSION);
+    stored->file = std::fopen(data_path.c_str(), "rb");
+
+    if(!stored->file)
+        return nullptr;
+
+    std::error_code ec;
+    stored->size = std::filesystem::file_size(data_path, ec);
+
+    std::ifstream offer(this->path(id, OFFER_EXTENSION), std::ios::binary);
+    const std::string payload((std::istreambuf_iterator<char>(offer)), std::istreambuf_iterator<char>());
+
+    if(ec || payload.empty())
+        return nullptr;
+
+    stored->offer = SharedFrame::encode(payload);
+    return stored;
+}
+
+const FileStore::Options& FileStore::options() const noexcept
+{
+    return m_options;
+}
@@ -0,0 +1,104 @@
+#include "io_context_pool.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PRIVATE METHODS
+///
+void IoContextPool::workerThread(boost::asio::io_context& io_cntxt) noexcept
+{
+    while(true)
+    {
+        try
+        {
+            boost::system::error_code ec;
+            io_cntxt.run(ec);
+
+            if(ec && m_onError)
+                m_onError("Error m_workerThread");
+
+            break;
+        }
+        catch(const std::exception& e)
+        {
+            if(m_onError)
+                m_onError("Exception m_workerThread");
+        }
+    }
+}
+
+void IoContextPool::pinThread(boost::thread& thread, const std::size_t core) noexcept
+{
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(core % CPU_SETSIZE, &cpu_set);
+
+    // Failing to pin is not an error: the thread simply keeps the default affinity.
+    pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set);
+#else
+    (void)thread;
+    (void)core;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+IoContextPool::IoContextPool(const std::size_t context_num, const std::size_t threads_per_context,
+                             const bool pin_threads, ErrorHandler on_error)
+    : m_onError(std::move(on_error))
+{
+    const std::size_t contexts = context_num ? context_num : 1;
+
+    for(std::size_t i = 0; i < contexts; ++i)
+    {
+        // A context run by a single thread needs no internal locking.
+        const int concurrency_hint = threads_per_context == 1 ? 1 : BOOST_ASIO_CONCURRENCY_HINT_DEFAULT;
+
+        m_contexts.push_back(std::make_unique<boost::asio::io_context>(concurrency_hint));
+        m_work.push_back(boost::asio::make_work_guard(*m_contexts.back()));
+    }
+
+    std::size_t core = 0;
+    for(auto& io_cntxt : m_contexts)
+    {
+        for(std::size_t i = 0; i < (threads_per_context ? threads_per_context : 1); ++i, ++core)
+        {
+            boost::thread* thread = m_threads.create_thread(
+                [this, context = io_cntxt.get()](){ this->workerThread(*context); });
+
+            if(pin_threads)
+                pinThread(*thread, core);
+        }
+    }
+}
+
+IoContextPool::~IoContextPool()
+{
+    this->stop();
+}
+
+std::size_t IoContextPool::size() const noexcept
+{
+    return m_contexts.size();
+}
+
+boost::asio::io_context& IoContextPool::context(const std::size_t index) noexcept
+{
+    return *m_contexts[index];
+}
+
+void IoContextPool::stop() noexcept
+{
+    for(auto& work : m_work)
+        work.reset();
+
+    for(auto& io_cntxt : m_contexts)
+        io_cntxt->stop();
+
+    m_threads.join_all();
+}
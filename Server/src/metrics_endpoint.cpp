@@ -0,0 +1,186 @@
+#include "metrics_endpoint.h"
+
+/**
+ * @struct MetricsEndpoint::Request
+ * @brief One HTTP connection. The socket and the timer share a strand, so the
+ *        timeout never runs concurrently with the read or the write.
+ */
+struct MetricsEndpoint::Request
+{
+    using Strand = boost::asio::strand<boost::asio::io_context::executor_type>;
+
+    boost::asio::ip::tcp::socket socket;     ///< Connection of the scraper.
+    boost::asio::steady_timer    timer;      ///< Closes the connection if the request is late.
+    boost::asio::streambuf       head;       ///< Request head, up to the empty line.
+    std::string                  response;   ///< Response being written.
+
+    explicit Request(const Strand& strand) :
+        socket(strand),
+        timer(strand),
+        head(MAX_REQUEST_SIZE)
+    {
+    }
+
+    void close() noexcept
+    {
+        boost::system::error_code ec;
+
+        timer.cancel(ec);
+        socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+        socket.close(ec);
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PRIVATE METHODS
+///
+void MetricsEndpoint::accept() noexcept
+{
+    try
+    {
+        auto request = std::make_shared<Request>(boost::asio::make_strand(m_ioContext));
+
+        m_acceptor.async_accept(request->socket, [this, request](const boost::system::error_code& ec){
+            if(ec == boost::asio::error::operation_aborted || !m_acceptor.is_open())
+                return;
+
+            if(ec)
+            {
+                // Out of descriptors: accepting again at once would spin, the next try is delayed.
+                request->timer.expires_after(ACCEPT_RETRY_DELAY);
+                request->timer.async_wait([this](const boost::system::error_code& timer_ec){
+                    if(!timer_ec && m_acceptor.is_open())
+                        this->accept();
+                });
+
+                return;
+            }
+
+            request->timer.expires_after(REQUEST_TIMEOUT);
+            request->timer.async_wait([request](const boost::system::error_code& timer_ec){
+                if(!timer_ec)
+                    request->close();
+            });
+
+            boost::asio::async_read_until(request->socket, request->head, "\r\n\r\n",
+                                          [this, request](const boost::system::error_code& read_ec,
+                                                          const std::size_t){
+                                              this->onRequest(request, read_ec);
+                                          });
+
+            this->accept();
+        });
+    }
+    catch (const std::exception&)
+    {
+        // Out of memory: the endpoint stops answering, the chat server is not affected.
+    }
+}
+
+void MetricsEndpoint::onRequest(const std::shared_ptr<Request>& request,
+                                const boost::system::error_code& ec) noexcept
+{
+    if(ec)
+    {
+        request->close();
+        return;
+    }
+
+    try
+    {
+        request->timer.cancel();
+
+        // Only the request line matters: "METHOD TARGET VERSION".
+        std::string line;
+        std::istream head(&request->head);
+        std::getline(head, line);
+
+        const std::size_t method_end = line.find(' ');
+        const std::size_t target_end = line.find(' ', method_end == std::string::npos ? 0 : method_end + 1);
+
+        const std::string_view method = std::string_view(line).substr(0, method_end);
+        std::string_view       target;
+
+        if(method_end != std::string::npos && target_end != std::string::npos)
+            target = std::string_view(line).substr(method_end + 1, target_end - method_end - 1);
+
+        target = target.substr(0, target.find('?'));
+
+        if(method != "GET")
+            request->response = response("405 Method Not Allowed", "text/plain", "Only GET is supported.\n");
+        else if(target == "/metrics")
+            request->response = response("200 OK", "text/plain; version=0.0.4; charset=utf-8", m_render());
+        else
+            request->response = response("404 Not Found", "text/plain", "The metrics are at /metrics.\n");
+
+        boost::asio::async_write(request->socket, boost::asio::buffer(request->response),
+                                 [request](const boost::system::error_code&, const std::size_t){
+                                     request->close();
+                                 });
+    }
+    catch (const std::exception&)
+    {
+        request->close();
+    }
+}
+
+std::string MetricsEndpoint::response(std::string_view status, std::string_view content_type,
+                                      std::string_view body)
+{
+    std::string text;
+    text.reserve(body.size() + 128);
+
+    text.append("HTTP/1.1 ").append(status).append("\r\n");
+    text.append("Content-Type: ").append(content_type).append("\r\n");
+    text.append("Content-Length: ").append(std::to_string(body.size())).append("\r\n");
+    text.append("Connection: close\r\n\r\n");
+    text.append(body);
+
+    return text;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+MetricsEndpoint::MetricsEndpoint(boost::asio::io_context& io_cntxt, Renderer render)
+    : m_ioContext(io_cntxt),
+      m_acceptor(io_cntxt),
+      m_render(std::move(render))
+{
+}
+
+void MetricsEndpoint::open(const boost::asio::ip::tcp::endpoint& endpoint)
+{
+    m_acceptor.open(endpoint.protocol());
+    m_acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+
+    try
+    {
+        m_acceptor.bind(endpoint);
+        m_acceptor.listen();
+    }
+    catch (const boost::system::system_error&)
+    {
+        boost::system::error_code ec;
+        m_acceptor.close(ec);
+        throw;
+    }
+
+    this->accept();
+}
+
+void MetricsEndpoint::close() noexcept
+{
+    boost::system::error_code ec;
+
+    if(m_acceptor.is_open())
+        m_acceptor.close(ec);
+}
+
+boost::asio::ip::tcp::endpoint MetricsEndpoint::localEndpoint() const noexcept
+{
+    boost::system::error_code ec;
+    const auto endpoint = m_acceptor.local_endpoint(ec);
+
+    return ec ? boost::asio::ip::tcp::endpoint() : endpoint;
+}
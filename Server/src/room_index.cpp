@@ -0,0 +1,186 @@
+#include "room_index.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PRIVATE METHODS
+///
+std::uint32_t RoomIndex::slotOf(const Member member) noexcept
+{
+    return static_cast<std::uint32_t>(member);
+}
+
+const RoomIndex::Subscription* RoomIndex::find(const std::uint32_t room, const Member member) const noexcept
+{
+    const std::uint32_t slot = slotOf(member);
+
+    if(slot >= m_subscriptions.size())
+        return nullptr;
+
+    // At most MAX_CHANNELS_PER_MEMBER entries, usually a handful.
+    for(const Subscription& subscription : m_subscriptions[slot])
+    {
+        if(subscription.room == room && m_rooms[room].members[subscription.position] == member)
+            return &subscription;
+    }
+
+    return nullptr;
+}
+
+void RoomIndex::remove(const Member member, const std::uint32_t index) noexcept
+{
+    std::vector<Subscription>& subscriptions = m_subscriptions[slotOf(member)];
+    const Subscription         removed       = subscriptions[index];
+    Room&                      room          = m_rooms[removed.room];
+
+    // The last member of the room takes the freed position.
+    const Member        moved      = room.members.back();
+    const std::uint32_t moved_link = room.links.back();
+
+    room.members[removed.position] = moved;
+    room.links[removed.position]   = moved_link;
+    m_subscriptions[slotOf(moved)][moved_link].position = removed.position;
+
+    room.members.pop_back();
+    room.links.pop_back();
+
+    // And the last subscription of the session takes the freed entry.
+    if(index + 1 < subscriptions.size())
+    {
+        const Subscription last = subscriptions.back();
+
+        subscriptions[index] = last;
+        m_rooms[last.room].links[last.position] = index;
+    }
+
+    subscriptions.pop_back();
+
+    --m_size;
+
+    if(room.members.empty())
+    {
+        m_names.erase(room.name);
+        room.name.clear();
+        m_freeRooms.push_back(removed.room);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+RoomIndex::RoomIndex()
+    : m_size(0)
+{
+}
+
+bool RoomIndex::join(std::string_view channel, const Member member)
+{
+    const std::uint32_t slot = slotOf(member);
+
+    if(slot >= m_subscriptions.size())
+        m_subscriptions.resize(static_cast<std::size_t>(slot) + 1);
+
+    std::vector<Subscription>& subscriptions = m_subscriptions[slot];
+    const auto                 it            = m_names.find(channel);
+
+    if(it != m_names.end() && this->find(it->second, member))
+        return true;
+
+    if(subscriptions.size() >= MAX_CHANNELS_PER_MEMBER)
+        return false;
+
+    std::uint32_t index;
+
+    if(it != m_names.end())
+    {
+        index = it->second;
+    }
+    else
+    {
+        if(!m_freeRooms.empty())
+        {
+            index = m_freeRooms.back();
+            m_freeRooms.pop_back();
+        }
+        else
+        {
+            index = static_cast<std::uint32_t>(m_rooms.size());
+            m_rooms.emplace_back();
+        }
+
+        m_rooms[index].name = channel;
+        m_names.emplace(m_rooms[index].name, index);
+    }
+
+    Room& room = m_rooms[index];
+
+    room.members.push_back(member);
+    room.links.push_back(static_cast<std::uint32_t>(subscriptions.size()));
+    subscriptions.push_back(Subscription{index, static_cast<std::uint32_t>(room.members.size() - 1)});
+
+    ++m_size;
+    return true;
+}
+
+bool RoomIndex::leave(std::string_view channel, const Member member) noexcept
+{
+    const auto it = m_names.find(channel);
+
+    if(it == m_names.end())
+        return false;
+
+    const Subscription* subscription = this->find(it->second, member);
+
+    if(!subscription)
+        return false;
+
+    this->remove(member, static_cast<std::uint32_t>(subscription - m_subscriptions[slotOf(member)].data()));
+    return true;
+}
+
+void RoomIndex::leaveAll(const Member member) noexcept
+{
+    const std::uint32_t slot = slotOf(member);
+
+    if(slot >= m_subscriptions.size())
+        return;
+
+    // From the back, so that no subscription moves before it is removed.
+    while(!m_subscriptions[slot].empty())
+        this->remove(member, static_cast<std::uint32_t>(m_subscriptions[slot].size() - 1));
+}
+
+const RoomIndex::Members* RoomIndex::members(std::string_view channel) const noexcept
+{
+    const auto it = m_names.find(channel);
+
+    return it != m_names.end() ? &m_rooms[it->second].members : nullptr;
+}
+
+bool RoomIndex::contains(std::string_view channel, const Member member) const noexcept
+{
+    const auto it = m_names.find(channel);
+
+    return it != m_names.end() && this->find(it->second, member) != nullptr;
+}
+
+std::vector<std::string_view> RoomIndex::channels(const Member member) const
+{
+    std::vector<std::string_view> names;
+
+    const std::uint32_t slot = slotOf(member);
+
+    if(slot >= m_subscriptions.size())
+        return names;
+
+    for(const Subscription& subscription : m_subscriptions[slot])
+    {
+        if(m_rooms[subscription.room].members[subscription.position] == member)
+            names.emplace_back(m_rooms[subscription.room].name);
+    }
+
+    return names;
+}
+
+std::size_t RoomIndex::size() const noexcept
+{
+    return m_size;
+}
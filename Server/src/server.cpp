@@ -1,239 +1,945 @@
 #include "server.h"
 
+#include <charconv>
+
+namespace
+{
+    // Idle wheel ticks covering a duration, rounded up; 0 stays 0 (disabled).
+    Session::IdleWheel::Tick idleTicks(const std::chrono::milliseconds duration,
+                                       const std::chrono::milliseconds tick) noexcept
+    {
+        if(duration.count() <= 0)
+            return 0;
+
+        return static_cast<Session::IdleWheel::Tick>((duration + tick - std::chrono::milliseconds(1)) / tick);
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////
 /// PRIVATE METHODS
 ///
-void Server::findLANIPAddress() noexcept
+void Server::raiseFileDescriptorLimit() noexcept
 {
-    try
+#if defined(__unix__) || defined(__APPLE__)
+    // Every client needs a descriptor; the default soft limit (often 1024) would
+    // make accept fail long before the configured number of clients is reached.
+    rlimit limit{};
+
+    if(::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
     {
-        // Finding the LAN IP address on Linux/Windows (wi-fi or ethernet)
-        const QList<QNetworkInterface> interfaces = QNetworkInterface::allInterfaces();
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+#endif
+}
 
-        for (const QNetworkInterface &iface : interfaces)
+boost::asio::awaitable<void> Server::acceptLoop()
+{
+    boost::system::error_code ec;
+
+    // The acceptor is always armed; clients beyond the limit are accepted and
+    // then closed in addSession, so the server never stops listening.
+    while(m_serverStatus.has_value() && m_serverStatus.value())
+    {
+        bool retry_later = false;
+
+        try
         {
-            const QString ifaceName = iface.name();
-            boost::asio::ip::address private_IP_address;
-            bool wifi_or_ethernet = false;
-
-        // Checking interfaces depending on the operating system.
-#ifdef __linux__
-            wifi_or_ethernet = ifaceName.startsWith("wl") ||
-                               ifaceName.startsWith("en") ||
-                               ifaceName.startsWith("eth");
-#elif _WIN32
-            wifi_or_ethernet = ifaceName.contains("Wi-Fi", Qt::CaseInsensitive)) ||
-                               ifaceName.startsWith("Ethernet", Qt::CaseInsensitive);
-#else
-            emit this->connectionStatus("Unknown OS!");
-            return;
-#endif
-            if (wifi_or_ethernet)
+            // The socket of the new session lives in the io_context of the next shard.
+            const std::size_t shard_index = m_nextShard++ % m_shards.size();
+
+            Shard& shard = *m_shards[shard_index];
+
+            auto session = std::make_shared<Session>(shard.strand, *this, shard_index, shard.metrics, shard.idleWheel);
+
+            co_await m_acceptor->async_accept(session->socket(),
+                                              boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
+            if(!(m_serverStatus.has_value() && m_serverStatus.value()) || ec == boost::asio::error::operation_aborted)
+                co_return;
+
+            if(!ec)
             {
-                const QList<QNetworkAddressEntry> entries = iface.addressEntries();
-                for (const QNetworkAddressEntry &entry : entries)
-                {
-                    // If the address is not local to the device only, but is part of the LAN,
-                    // it can be used by the server for listening.
-                    if (entry.ip().protocol() == QAbstractSocket::IPv4Protocol && !entry.ip().isLoopback())
-                    {
-                        private_IP_address = boost::asio::ip::make_address(entry.ip().toString().toStdString());
-                        m_endpoint = std::make_shared<boost::asio::ip::tcp::endpoint>(private_IP_address,
-                                                                                      SERVER_PORT);
-                        break;
-                    }
-                }
+                // A socket whose options cannot all be set still works, with the system's.
+                m_socketTuning.apply(session->socket(), ec);
+
+                if(ec)
+                    this->reportStatus("Cannot set the TCP options of a client connection.");
 
-                if(m_endpoint)
-                    break;
+                this->addSession(session);
+                continue;
             }
+
+            m_acceptMetrics.accept_errors.add();
+
+            this->notifyStatus("  Connection failed!");
+
+            // When the process runs out of file descriptors the pending connection stays in the
+            // backlog, so accepting again immediately would spin. The next attempt is delayed.
+            retry_later = ec == boost::asio::error::no_descriptors || ec == boost::asio::error::no_buffer_space;
+        }
+        catch (const std::exception& e)
+        {
+            // Whatever failed, the server must keep accepting; it tries again a bit later
+            // rather than spinning on an error that may repeat.
+            this->notifyStatus(e.what());
+            retry_later = true;
+        }
+
+        if(!retry_later)
+            continue;
+
+        m_acceptRetryTimer->expires_after(ACCEPT_RETRY_DELAY);
+        co_await m_acceptRetryTimer->async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
+        // Only the shutdown cancels the timer.
+        if(ec == boost::asio::error::operation_aborted)
+            co_return;
+    }
+}
+
+void Server::addSession(const std::shared_ptr<Session>& session) noexcept
+{
+    std::optional<SessionTable::Id> id;
+    {
+        boost::lock_guard<boost::mutex> lckgrd(m_sessionsMutex);
+
+        // O(1): the slot comes from the free list of the table.
+        id = m_sessions.insert(session);
+
+        if(id.has_value())
+        {
+            session->setId(id.value());
+            session->start();
         }
     }
-    catch(const std::exception& e)
+
+    if(id.has_value())
     {
-        emit this->connectionStatus(e.what());
+        m_acceptMetrics.accepted.add();
+
+        // From now on the shard broadcasts to the session.
+        Shard& shard = *m_shards[session->shard()];
+
+        boost::asio::post(shard.strand, [this, &shard, session](){
+            // A session closed in the meantime has already been removed from the shard.
+            if(!session->is_open())
+                return;
+
+            if(const auto slot = shard.sessions.insert(session))
+            {
+                session->setShardSlot(slot.value());
+                session->markActive();
+
+                // The first check comes after the shorter of the two intervals.
+                const auto heartbeat = idleTicks(m_liveness.heartbeat_interval, IDLE_TICK);
+                const auto timeout   = idleTicks(m_liveness.idle_timeout, IDLE_TICK);
+
+                if(heartbeat != 0 || timeout != 0)
+                    shard.idleWheel.schedule(slot.value(), heartbeat == 0 ? timeout
+                                                         : timeout   == 0 ? heartbeat
+                                                                          : std::min(heartbeat, timeout));
+            }
+        });
+
+        // The connection is reported before the first message of the client.
+        this->notifyStatus("  Connected!");
+
+        session->startRecv();
+    }
+    else
+    {
+        boost::system::error_code close_ec;
+        session->socket().close(close_ec);
+
+        m_acceptMetrics.rejected.add();
+        this->notifyStatus("No more clients can connect to the server.");
     }
 }
 
-std::optional<uint8_t> Server::getSocketIndex() noexcept
+void Server::onMessage(Session& session, std::string_view payload) noexcept
 {
-    if(!m_connections.empty())
+    // Without a log the server relays the payload as it is; it is decoded only to keep
+    // malformed records away from the other clients.
+    ShardMetrics& metrics = m_shards[session.shard()]->metrics;
+    MessageRecord record;
+
+    if(!MessageRecord::decode(payload, record))
+    {
+        metrics.invalid_messages.add();
+        this->reportStatus("Invalid message received, discarded.");
+        return;
+    }
+
+    if(record.type == MessageRecord::Type::Compressed)
+    {
+        // Decompressed once, here: the log, the callback and the relay all get the
+        // original, which stays in the thread's buffer until the next message.
+        thread_local std::string original;
+
+        try
+        {
+            if(!Compression::decompress(record, original) || !MessageRecord::decode(original, record))
+            {
+                metrics.invalid_messages.add();
+                this->reportStatus("Invalid compressed message received, discarded.");
+                return;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            this->reportStatus(e.what());
+            return;
+        }
+
+        metrics.frames_decompressed.add();
+        payload = original;
+    }
+
+    if(record.type == MessageRecord::Type::History)
+    {
+        this->replay(session, record);
+        return;
+    }
+
+    // The read itself has already marked the client as alive.
+    if(record.type == MessageRecord::Type::Heartbeat)
+        return;
+
+    if(record.type == MessageRecord::Type::Hello)
+    {
+        session.setCodecs(Compression::parseNames(record.body));
+        session.deliver(m_hello);
+        return;
+    }
+
+    // Files are neither logged nor reported, and their chunks travel behind the chat.
+    if(record.type == MessageRecord::Type::FileOffer || record.type == MessageRecord::Type::FileChunk)
+    {
+        this->relayFile(session, record, payload);
+        return;
+    }
+
+    if(record.type == MessageRecord::Type::FileFetch)
     {
-        for(uint8_t i = 0; i < m_connections.size(); ++i)
-            if(!m_connections.at(i)->state)
-                return i;
+        this->serveFile(session, record);
+        return;
     }
 
-    if(m_connections.size() < MAX_CLIENT_NUM)
+    if(record.type == MessageRecord::Type::Join || record.type == MessageRecord::Type::Leave)
     {
-        m_connections.push_back(new Connection(*m_io_cntxt));
-        return uint8_t(m_connections.size() - 1);
+        this->subscribe(session, record);
+        return;
     }
 
-    return std::nullopt;
+    if(!this->routable(session, record))
+        return;
+
+    const bool to_channel = !record.channel.empty();
+
+    if(m_callbacks.message_received)
+        m_callbacks.message_received(session.shard(), payload);
+
+    // If m_isGroupChat is true, the message received from a client is automatically sent to
+    // the rest of the active clients. A message to a channel always reaches its members.
+    if(m_isGroupChat || to_channel)
+    {
+        try
+        {
+            if(to_channel)
+                metrics.messages_routed.add();
+
+            // A logged message is relayed with its sequence number, so that a client
+            // can later ask for what followed it.
+            this->broadcast(m_chatLog ? m_chatLog->append(record) : SharedFrame::encode(payload), &session,
+                            false, record.channel);
+        }
+        catch (const std::exception& e)
+        {
+            this->reportStatus(e.what());
+        }
+    }
 }
 
+void Server::replay(Session& session, const MessageRecord& request) noexcept
+{
+    try
+    {
+        if(!m_chatLog)
+        {
+            std::vector<ReplayedFrame> none;
+            this->deliverReplay(session, none, 0);
+            return;
+        }
+
+        // The body may lower the server's limit, never raise it.
+        std::size_t count     = m_chatLog->options().replay_limit;
+        std::size_t requested = 0;
+
+        const char* const body_end = request.body.data() + request.body.size();
+        const auto [end, error]    = std::from_chars(request.body.data(), body_end, requested);
+
+        if(error == std::errc() && end == body_end)
+            count = std::min(count, requested);
+
+        // A replay is compressed for the client alone, message by message, when it can decode the codec.
+        const Compression::Codec codec = Compression::contains(session.codecs(), m_compression.codec)
+                                             ? m_compression.codec : Compression::Codec::None;
 
-void Server::acceptConnection() noexcept
+        // Reading the mapped segments faults their pages in, and compressing the
+        // messages takes time: both happen on the replay pool, and only the frames
+        // come back to the strand, so the other sessions of the shard never wait.
+        boost::asio::post(*m_replayPool, [this, session = session.shared_from_this(), after = request.sequence,
+                                          count, codec](){
+            std::vector<ReplayedFrame> frames;
+            std::uint64_t              last = 0;
+
+            try
+            {
+                last = m_chatLog->replay(after, count, [this, &frames, codec](SharedFrame frame){
+                    ReplayedFrame replayed{std::move(frame), std::string(), 0};
+                    MessageRecord logged;
+
+                    if(MessageRecord::decode(replayed.frame.payload(), logged))
+                        replayed.channel = logged.channel;
+
+                    if(codec != Compression::Codec::None && replayed.frame.payload().size() >= m_compression.threshold)
+                    {
+                        if(SharedFrame compressed = Compression::compress(replayed.frame.payload(), codec))
+                        {
+                            replayed.saved = replayed.frame.size() - compressed.size();
+                            replayed.frame = std::move(compressed);
+                        }
+                    }
+
+                    frames.push_back(std::move(replayed));
+                });
+            }
+            catch (const std::exception& e)
+            {
+                // The client still gets the end of the replay, and asks again later.
+                this->reportStatus(e.what());
+                frames.clear();
+                last = m_chatLog->lastSequence();
+            }
+
+            try
+            {
+                boost::asio::post(m_shards[session->shard()]->strand,
+                                  [this, session, frames = std::move(frames), last]() mutable {
+                    this->deliverReplay(*session, frames, last);
+                });
+            }
+            catch (const std::exception& e)
+            {
+                this->reportStatus(e.what());
+            }
+        });
+    }
+    catch (const std::exception& e)
+    {
+        this->reportStatus(e.what());
+    }
+}
+
+void Server::deliverReplay(Session& session, std::vector<ReplayedFrame>& frames, const std::uint64_t last) noexcept
+{
+    // A session closed during the read has already left its shard.
+    if(!session.is_open())
+        return;
+
+    Shard&        shard   = *m_shards[session.shard()];
+    ShardMetrics& metrics = shard.metrics;
+
+    try
+    {
+        // The messages go through the write queue like any other, under the same budget.
+        // Those of a channel go to its current members only (they still count in the limit).
+        for(ReplayedFrame& replayed : frames)
+        {
+            if(!replayed.channel.empty() && !shard.rooms.contains(replayed.channel, session.shardSlot()))
+                continue;
+
+            metrics.messages_replayed.add();
+
+            if(replayed.saved > 0)
+            {
+                metrics.frames_compressed.add();
+                metrics.compression_saved.add(replayed.saved);
+            }
+
+            session.deliver(std::move(replayed.frame));
+        }
+
+        // The reply ends with a History record carrying the last sequence of the log
+        // when the replay was read (0 without a log): the messages up to it that
+        // arrive afterwards are late live copies of replayed ones, and a value below
+        // the one asked for tells the client that the log is not the one it knew.
+        MessageRecord marker;
+        marker.type      = MessageRecord::Type::History;
+        marker.timestamp = MessageRecord::now();
+        marker.sender    = "SERVER";
+        marker.sequence  = last;
+
+        session.deliver(marker.toFrame());
+    }
+    catch (const std::exception& e)
+    {
+        this->reportStatus(e.what());
+    }
+}
+
+void Server::subscribe(Session& session, const MessageRecord& request) noexcept
 {
+    Shard& shard = *m_shards[session.shard()];
+
+    // A closed session has already released its nicknames: it must not claim more.
+    if(!session.is_open())
+        return;
+
+    if(!Channel::isValid(request.channel))
+    {
+        shard.metrics.invalid_messages.add();
+        this->reportStatus("Invalid channel name received, discarded.");
+        return;
+    }
+
     try
     {
-        const std::optional<std::uint8_t> socket_index = getSocketIndex();
-        if(socket_index.has_value())
+        const std::size_t before   = shard.rooms.size();
+        const bool        nickname = Channel::isNickname(request.channel);
+
+        if(request.type == MessageRecord::Type::Join)
         {
-            m_acceptor->async_accept(*m_connections.at(socket_index.value())->socket,
-                                     boost::bind(&Server::onAccept,
-                                                 this,
-                                                 boost::asio::placeholders::error,
-                                                 socket_index.value()
-                                                 )
-                                     );
-
-            emit this->listening_on(m_endpoint);
+            if(nickname && !this->claimNickname(request.channel, session.id()))
+            {
+                shard.metrics.nickname_conflicts.add();
+                this->reportStatus("A client joined a nickname owned by another client; the join was refused.");
+                this->refuseJoin(session, request.channel);
+            }
+            else if(!shard.rooms.join(request.channel, session.shardSlot()))
+            {
+                if(nickname)
+                    this->releaseNickname(request.channel, session.id());
+
+                this->reportStatus("A client joined too many channels; a join was refused.");
+                this->refuseJoin(session, request.channel);
+            }
+        }
+        else if(nickname && !this->releaseNickname(request.channel, session.id()))
+        {
+            shard.metrics.nickname_conflicts.add();
+            this->reportStatus("A client left a nickname it does not own; discarded.");
         }
         else
         {
-            emit this->connectionStatus("No more clients can connect to the server.");
+            shard.rooms.leave(request.channel, session.shardSlot());
         }
+
+        shard.metrics.subscriptions.add(static_cast<std::int64_t>(shard.rooms.size()) -
+                                        static_cast<std::int64_t>(before));
     }
     catch (const std::exception& e)
     {
-        emit connectionStatus(e.what());
+        this->reportStatus(e.what());
     }
 }
 
+bool Server::claimNickname(std::string_view nickname, const Session::Id owner)
+{
+    boost::lock_guard<boost::mutex> lckgrd(m_nicknamesMutex);
+
+    // A second Join of its own nickname is not a conflict.
+    const auto it = m_nicknames.find(nickname);
+
+    if(it != m_nicknames.end())
+        return it->second == owner;
+
+    m_nicknames.emplace(nickname, owner);
+    return true;
+}
+
+bool Server::releaseNickname(std::string_view nickname, const Session::Id owner) noexcept
+{
+    boost::lock_guard<boost::mutex> lckgrd(m_nicknamesMutex);
+
+    const auto it = m_nicknames.find(nickname);
+
+    if(it == m_nicknames.end() || it->second != owner)
+        return false;
 
-void Server::onAccept(const boost::system::error_code &ec, const std::uint8_t socket_index) noexcept
+    m_nicknames.erase(it);
+    return true;
+}
+
+void Server::refuseJoin(Session& session, std::string_view channel) noexcept
 {
-    if(ec)
+    try
     {
-        if(m_serverStatus.has_value() && m_serverStatus.value())
-            emit this->connectionStatus("  Connection failed!");
+        MessageRecord refusal;
+        refusal.type      = MessageRecord::Type::Leave;
+        refusal.timestamp = MessageRecord::now();
+        refusal.sender    = "SERVER";
+        refusal.channel   = channel;
+
+        session.deliver(refusal.toFrame());
     }
-    else
+    catch (const std::exception& e)
     {
-        // The socket is connected and the async_read method can be called for it.
-        m_connections.at(socket_index)->state = true;
+        this->reportStatus(e.what());
+    }
+}
 
-        emit this->connectionStatus("  Connected!");
+bool Server::routable(Session& session, const MessageRecord& record) noexcept
+{
+    // Only the members of a room write to it; anyone writes to a nickname.
+    if(record.channel.empty())
+        return true;
 
-        // If the number of clients connected to the server exceeds the maximum
-        // number, the acceptor closes
-        if(!(m_connections.size() < MAX_CLIENT_NUM))
-            m_acceptor->close();
-        else
-            this->acceptConnection();
-    }
+    Shard& shard = *m_shards[session.shard()];
+
+    if(Channel::isValid(record.channel) &&
+       (!Channel::isRoom(record.channel) || shard.rooms.contains(record.channel, session.shardSlot())))
+        return true;
+
+    shard.metrics.messages_unrouted.add();
+    this->reportStatus("Message to a channel the sender has not joined, discarded.");
+    return false;
 }
 
-void Server::workerThread() noexcept
+void Server::relayFile(Session& session, const MessageRecord& record, std::string_view payload) noexcept
 {
-    while(true)
+    ShardMetrics&        metrics = m_shards[session.shard()]->metrics;
+    FileTransfer::Offer  offer;
+    FileTransfer::Chunk  chunk;
+
+    const bool is_offer = record.type == MessageRecord::Type::FileOffer;
+
+    // An offer always has a name: an offer without one means "not available".
+    if(is_offer ? !FileTransfer::decodeOffer(record, offer) || offer.name.empty()
+                : !FileTransfer::decodeChunk(record, chunk))
     {
-        try
-        {
-            boost::system::error_code ec;
-            m_io_cntxt->run(ec);
+        metrics.invalid_messages.add();
+        this->reportStatus("Invalid file transfer message received, discarded.");
+        return;
+    }
 
-            if(ec)
+    if(!this->routable(session, record))
+        return;
+
+    try
+    {
+        // The same frame is stored and relayed.
+        const SharedFrame frame = SharedFrame::encode(payload);
+
+        if(m_fileStore)
+        {
+            if(is_offer && !m_fileStore->begin(offer, frame, session.id()))
             {
-                emit this->connectionStatus("Error m_workerThread");
+                this->reportStatus(offer.size > m_fileStore->options().max_file_size
+                                       ? "A file is too large to be stored; it is only relayed."
+                                       : "A file could not be stored; it is only relayed.");
+            }
+            else if(!is_offer)
+            {
+                m_fileStore->write(chunk, session.id());
             }
-            break;
-        }
-        catch(const std::exception& e)
-        {
-            emit this->connectionStatus("Exception m_workerThread");
         }
+
+        // Routed like the chat messages: a file to a channel always reaches its members.
+        if(m_isGroupChat || !record.channel.empty())
+            this->broadcast(frame, &session, !is_offer, record.channel);
+    }
+    catch (const std::exception& e)
+    {
+        this->reportStatus(e.what());
     }
 }
 
-void Server::recv(const std::uint8_t socket_index) noexcept
+void Server::serveFile(Session& session, const MessageRecord& request) noexcept
 {
+    std::uint64_t id = 0;
+
+    if(!FileTransfer::decodeFetch(request, id))
+    {
+        m_shards[session.shard()]->metrics.invalid_messages.add();
+        this->reportStatus("Invalid file request received, discarded.");
+        return;
+    }
+
     try
     {
-        if(m_serverStatus.has_value() && m_serverStatus.value())
+        Session::SharedFile file = m_fileStore ? m_fileStore->open(id) : nullptr;
+
+        if(file)
+            session.streamFile(std::move(file));
+        else
+            session.deliver(FileTransfer::offerFrame("SERVER", FileTransfer::Offer{id, 0, {}}));
+    }
+    catch (const std::exception& e)
+    {
+        this->reportStatus(e.what());
+    }
+}
+
+std::int64_t Server::queuedBytes() const noexcept
+{
+    std::int64_t bytes = 0;
+
+    for(const auto& shard : m_shards)
+        bytes += shard->metrics.write_queue_bytes.value();
+
+    return bytes;
+}
+
+bool Server::overHighWatermark() const noexcept
+{
+    return m_flowControl.high_watermark != 0 &&
+           this->queuedBytes() > static_cast<std::int64_t>(m_flowControl.high_watermark);
+}
+
+void Server::pauseReading(const std::shared_ptr<Session>& session) noexcept
+{
+    Shard& shard = *m_shards[session->shard()];
+
+    try
+    {
+        shard.paused.push_back(session);
+        shard.metrics.reads_paused.add();
+
+        // One timer per shard, however many of its sessions are paused.
+        if(shard.paused.size() == 1)
         {
-            m_connections.at(socket_index)->socket->async_read_some(
-                boost::asio::buffer(m_received_buffer, m_received_buffer.size()),
-                boost::bind(&Server::onRecv,
-                            this,
-                            boost::asio::placeholders::error,
-                            boost::asio::placeholders::bytes_transferred,
-                            socket_index
-                            )
-            );
+            shard.resumeTimer.expires_after(RESUME_CHECK_INTERVAL);
+            shard.resumeTimer.async_wait([this, &shard](const boost::system::error_code& ec){
+                if(!ec)
+                    this->resumeReading(shard);
+            });
         }
     }
     catch (const std::exception& e)
     {
-        if(m_serverStatus.has_value() && m_serverStatus.value())
-            emit this->connectionStatus(e.what());
+        // The session could not be parked: it keeps reading rather than hanging.
+        session->resumeRecv();
+        this->reportStatus(e.what());
     }
 }
 
-void Server::onRecv(const boost::system::error_code& ec, const size_t bytes,
-                    const std::uint8_t socket_index)                                  noexcept
+void Server::resumeReading(Shard& shard) noexcept
 {
-    if(ec)
+    // Reads resume below 3/4 of the watermark, so that they do not pause again at once.
+    const std::int64_t low_watermark = static_cast<std::int64_t>(m_flowControl.high_watermark / 4 * 3);
+
+    if(this->queuedBytes() > low_watermark && m_serverStatus.has_value() && m_serverStatus.value())
     {
-        if(m_serverStatus.has_value() && m_serverStatus.value())
-            emit this->connectionStatus("Async_read_some error!");
+        shard.resumeTimer.expires_after(RESUME_CHECK_INTERVAL);
+        shard.resumeTimer.async_wait([this, &shard](const boost::system::error_code& ec){
+            if(!ec)
+                this->resumeReading(shard);
+        });
 
         return;
     }
 
-    std::string received_message(m_received_buffer.begin(), m_received_buffer.begin() + bytes);
+    std::vector<std::shared_ptr<Session>> paused;
+    paused.swap(shard.paused);
 
-    emit message_received(received_message);
+    for(auto& session : paused)
+        session->resumeRecv();
+}
 
-    // If m_isGroupChat is true, the message received from a client is automatically sent to
-    // the rest of the active clients.
-    if(m_isGroupChat)
+void Server::tickIdleWheel(Shard& shard) noexcept
+{
+    try
     {
-        std::vector<boost::uint8_t> echo_buffer(m_received_buffer.begin(),
-                                                m_received_buffer.begin() + bytes);
-        for(std::uint8_t i = 0; i < m_connections.size(); ++i)
+        // Late timers catch up tick by tick, so no deadline is skipped.
+        const auto now = std::chrono::steady_clock::now();
+
+        while(shard.nextIdleTick <= now)
         {
-            if(i == socket_index)
-                continue;
-            else
-                this->send(echo_buffer, i);
+            shard.idleWheel.advance([this, &shard](const Session::Id slot){
+                this->checkIdle(shard, slot);
+            });
+            shard.nextIdleTick += IDLE_TICK;
         }
+
+        shard.idleTimer.expires_at(shard.nextIdleTick);
+        shard.idleTimer.async_wait([this, &shard](const boost::system::error_code& ec){
+            if(!ec)
+                this->tickIdleWheel(shard);
+        });
+    }
+    catch (const std::exception& e)
+    {
+        this->reportStatus(e.what());
+    }
+}
+
+void Server::checkIdle(Shard& shard, const Session::Id slot) noexcept
+{
+    // The generation in the slot id makes a reused slot look like a closed session.
+    std::shared_ptr<Session>* entry = shard.sessions.find(slot);
+
+    if(!entry || !(*entry)->is_open())
+        return;
+
+    Session& session = **entry;
+
+    const Session::IdleWheel::Tick now       = shard.idleWheel.now();
+    const Session::IdleWheel::Tick heartbeat = idleTicks(m_liveness.heartbeat_interval, IDLE_TICK);
+    const Session::IdleWheel::Tick timeout   = idleTicks(m_liveness.idle_timeout, IDLE_TICK);
+
+    if(timeout != 0 && now - session.lastReceive() >= timeout)
+    {
+        // Its slot is freed at once, for the next accepted client.
+        shard.metrics.idle_disconnects.add();
+        this->reportStatus("A client stopped responding and was disconnected.");
+        session.close();
+        return;
+    }
+
+    // A client that is being written to needs no heartbeat: the queued frames show
+    // that the server is alive.
+    if(heartbeat != 0 && now - session.lastSend() >= heartbeat && !session.hasQueuedFrames())
+    {
+        shard.metrics.heartbeats_sent.add();
+        session.deliver(m_heartbeat);
+    }
+
+    // The next check is due at the earlier of the two deadlines.
+    Session::IdleWheel::Tick next = std::numeric_limits<Session::IdleWheel::Tick>::max();
+
+    if(timeout != 0)
+        next = session.lastReceive() + timeout;
+
+    if(heartbeat != 0)
+        next = std::min(next, session.lastSend() + heartbeat > now ? session.lastSend() + heartbeat : now + heartbeat);
+
+    try
+    {
+        shard.idleWheel.schedule(slot, next - now);
+    }
+    catch (const std::exception& e)
+    {
+        this->reportStatus(e.what());
+    }
+}
+
+void Server::removeSession(const std::shared_ptr<Session>& session) noexcept
+{
+    {
+        boost::lock_guard<boost::mutex> lckgrd(m_sessionsMutex);
+
+        // The generation in the id makes this a no-op if the slot was already reused.
+        m_sessions.erase(session->id());
+    }
+
+    // A file the client was sending can never be completed.
+    if(m_fileStore)
+        m_fileStore->abort(session->id());
+
+    try
+    {
+        Shard& shard = *m_shards[session->shard()];
+
+        // Posted, never run inline: the shard may be walking its sessions or the members
+        // of a channel when a delivery closes one of them.
+        boost::asio::post(shard.strand, [this, &shard, session](){
+            const std::size_t before = shard.rooms.size();
+
+            // Its nicknames are free again. Only a session that owned one could join it.
+            try
+            {
+                for(const std::string_view channel : shard.rooms.channels(session->shardSlot()))
+                {
+                    if(Channel::isNickname(channel))
+                        this->releaseNickname(channel, session->id());
+                }
+            }
+            catch (const std::exception& e)
+            {
+                this->reportStatus(e.what());
+            }
+
+            shard.rooms.leaveAll(session->shardSlot());
+            shard.metrics.subscriptions.add(static_cast<std::int64_t>(shard.rooms.size()) -
+                                            static_cast<std::int64_t>(before));
+
+            shard.sessions.erase(session->shardSlot());
+        });
     }
+    catch (const std::exception& e)
+    {
+        this->reportStatus(e.what());
+    }
+}
+
+void Server::reportStatus(const char* status) noexcept
+{
+    if(m_serverStatus.has_value() && m_serverStatus.value())
+        this->notifyStatus(status);
+}
 
-    this->recv(socket_index);
+void Server::notifyStatus(const char* status) noexcept
+{
+    if(m_callbacks.connection_status)
+        m_callbacks.connection_status(status);
 }
 
-void Server::onSend(const boost::system::error_code& ec, const size_t bytes) noexcept
+void Server::broadcast(const SharedFrame& frame, const Session* except, const bool bulk,
+                       std::string_view channel) noexcept
 {
-    if(ec && m_serverStatus.has_value() && m_serverStatus.value())
+    try
     {
-        emit this->connectionStatus("An error occurred while transmitting data.");
+        // A large frame is compressed once, here, and the clients that can decode the
+        // codec share the compressed copy; the empty frame means none. File chunks are
+        // not worth the CPU: most files are already compressed.
+        const Compression::Codec codec = m_compression.codec;
+        SharedFrame              compressed;
+
+        if(codec != Compression::Codec::None && !bulk && frame.payload().size() >= m_compression.threshold)
+            compressed = Compression::compress(frame.payload(), codec);
+
+        // Each shard then queues a reference to the same frame on its own sessions,
+        // on its own thread; only its inbox is locked, and only to append.
+        // The sender is told apart by its id, not its address: it may close while the
+        // frame waits in the inboxes, and a new session be allocated in its place.
+        const auto        posted    = std::chrono::steady_clock::now();
+        const Session::Id except_id = except ? except->id() : Session::INVALID_ID;
+
+        for(auto& shard : m_shards)
+        {
+            bool post;
+            {
+                boost::lock_guard<boost::mutex> lckgrd(shard->inboxMutex);
+
+                shard->inbox.push_back(Broadcast{frame, compressed, codec, except_id, bulk, posted, std::string(channel)});
+                post = !shard->inboxPosted;
+                shard->inboxPosted = true;
+            }
+
+            if(post)
+                boost::asio::post(shard->strand, [this, shard = shard.get()](){ this->fanOut(*shard); });
+        }
+    }
+    catch (const std::exception& e)
+    {
+        this->reportStatus(e.what());
     }
 }
 
+void Server::fanOut(Shard& shard) noexcept
+{
+    // The inbox is swapped with the vector of the previous fan-out, so that both
+    // keep their capacity and a fan-out allocates nothing.
+    {
+        boost::lock_guard<boost::mutex> lckgrd(shard.inboxMutex);
+
+        shard.delivering.swap(shard.inbox);
+        shard.inboxPosted = false;
+    }
+
+    ShardMetrics& metrics = shard.metrics;
+    metrics.fan_outs.add();
+
+    // Every frame is queued before any write loop runs: a session woken by the
+    // first one writes them all at once.
+    for(const Broadcast& broadcast : shard.delivering)
+    {
+        metrics.relay_latency.record(std::chrono::steady_clock::now() - broadcast.posted);
+
+        const auto deliver = [&broadcast, &metrics](std::shared_ptr<Session>& session){
+            if(session->id() == broadcast.except)
+                return;
+
+            if(broadcast.compressed && Compression::contains(session->codecs(), broadcast.codec))
+            {
+                metrics.frames_compressed.add();
+                metrics.compression_saved.add(broadcast.frame.size() - broadcast.compressed.size());
+                session->deliver(broadcast.compressed);
+            }
+            else
+            {
+                session->deliver(broadcast.frame, broadcast.bulk);
+            }
+        };
+
+        if(broadcast.channel.empty())
+        {
+            shard.sessions.forEach(deliver);
+            continue;
+        }
+
+        // Only the members of the channel are visited; a shard where nobody
+        // joined it stops at the lookup.
+        if(const RoomIndex::Members* members = shard.rooms.members(broadcast.channel))
+        {
+            for(const RoomIndex::Member member : *members)
+            {
+                if(std::shared_ptr<Session>* session = shard.sessions.find(member))
+                    deliver(*session);
+            }
+        }
+    }
+
+    shard.delivering.clear();
+}
 
 //////////////////////////////////////////////////////////////////////////////////////////////////
 /// PUBLIC METHODS
 ///
-Server::Server(QObject* parent)
-    : QObject(parent),
+Server::Server(const std::size_t max_client_num, const ExecutionMode mode)
+    : m_nextShard(0),
+      m_sessions(max_client_num),
       m_endpoint(nullptr),
       m_serverStatus(std::nullopt),
       m_hasEverConnected(false),
-      m_isGroupChat(false)
+      m_isGroupChat(false),
+      m_socketTuning(SocketTuning::lowLatency())
 {
-    // Initialization
-    m_io_cntxt   = std::make_unique<boost::asio::io_context>();
-    m_work       = std::make_unique<boost::asio::io_service::work>(*m_io_cntxt);
-    m_acceptor   = std::make_unique<boost::asio::ip::tcp::acceptor>(*m_io_cntxt);
+    const auto on_error = [this](const char* status){ this->notifyStatus(status); };
 
     // Creating threads for receiving and sending data
-    for(std::uint8_t i = 0; i < THREAD_NR; ++i)
-        m_threads.create_thread(boost::bind(&Server::workerThread, this));
+    if(mode == ExecutionMode::PerCore)
+    {
+        const std::size_t core_num = std::max(1u, boost::thread::hardware_concurrency());
+        m_pool = std::make_unique<IoContextPool>(core_num, 1, true, on_error);
+    }
+    else
+    {
+        m_pool = std::make_unique<IoContextPool>(1, THREAD_NR, false, on_error);
+    }
+
+    // Per-core mode: one shard per io_context. Shared mode: one shard per thread,
+    // all of them on the single io_context.
+    const std::size_t shard_num = (mode == ExecutionMode::PerCore) ? m_pool->size() : THREAD_NR;
+
+    for(std::size_t i = 0; i < shard_num; ++i)
+        m_shards.push_back(std::make_unique<Shard>(m_pool->context(i % m_pool->size())));
+
+    // Initialization
+    m_acceptor         = std::make_unique<boost::asio::ip::tcp::acceptor>(m_pool->context(0));
+    m_acceptRetryTimer = std::make_unique<boost::asio::steady_timer>(m_pool->context(0));
+    m_replayPool       = std::make_unique<boost::asio::thread_pool>(REPLAY_THREAD_NR);
+    m_metricsEndpoint  = std::make_unique<MetricsEndpoint>(m_pool->context(0),
+                                                           [this](){ return this->renderMetrics(); });
+
+    // Every heartbeat is the same frame, shared by all the sessions.
+    MessageRecord heartbeat;
+    heartbeat.type   = MessageRecord::Type::Heartbeat;
+    heartbeat.sender = "SERVER";
+
+    m_heartbeat = heartbeat.toFrame();
+
+    // So is the answer to a Hello: the server decodes every codec it was built with.
+    const std::string codecs = Compression::names(Compression::available());
 
-    m_received_buffer.resize(4096);
+    MessageRecord hello;
+    hello.type   = MessageRecord::Type::Hello;
+    hello.sender = "SERVER";
+    hello.body   = codecs;
+
+    m_hello = hello.toFrame();
 }
 
 
@@ -242,10 +948,9 @@ Server::~Server()
     if(m_serverStatus.has_value() && m_serverStatus.value())
         this->finish();
 
-    m_threads.join_all();
-
-    for(auto& connection : m_connections)
-        delete connection;
+    // The replays being read post to the shards: they end before the io_contexts stop.
+    m_replayPool->join();
+    m_pool->stop();
 }
 
 void Server::setGroupChat(const bool value) noexcept
@@ -253,6 +958,193 @@ void Server::setGroupChat(const bool value) noexcept
     m_isGroupChat = value;
 }
 
+void Server::setCallbacks(Callbacks callbacks) noexcept
+{
+    m_callbacks = std::move(callbacks);
+}
+
+void Server::setEndpoint(const boost::asio::ip::tcp::endpoint& endpoint) noexcept
+{
+    m_endpoint = std::make_shared<boost::asio::ip::tcp::endpoint>(endpoint);
+}
+
+void Server::setFlowControl(const FlowControl& flow_control) noexcept
+{
+    m_flowControl = flow_control;
+}
+
+void Server::setLiveness(const Liveness& liveness) noexcept
+{
+    m_liveness = liveness;
+}
+
+void Server::setCompression(const CompressionPolicy& compression) noexcept
+{
+    m_compression = compression;
+}
+
+void Server::setSocketTuning(const SocketTuning& tuning) noexcept
+{
+    m_socketTuning = tuning;
+}
+
+void Server::setChatLog(const ChatLog::Options& options) noexcept
+{
+    m_chatLogOptions = options;
+}
+
+const ChatLog* Server::getChatLog() const noexcept
+{
+    return m_chatLog.get();
+}
+
+void Server::setFileStore(const FileStore::Options& options) noexcept
+{
+    m_fileStoreOptions = options;
+}
+
+const FileStore* Server::getFileStore() const noexcept
+{
+    return m_fileStore.get();
+}
+
+void Server::setMetricsEndpoint(const boost::asio::ip::tcp::endpoint& endpoint) noexcept
+{
+    m_metricsAddress = endpoint;
+}
+
+boost::asio::ip::tcp::endpoint Server::getMetricsEndpoint() const noexcept
+{
+    return m_metricsEndpoint->localEndpoint();
+}
+
+std::string Server::renderMetrics() const
+{
+    // The shards keep counting while they are read: every value is consistent on
+    // its own, the set of them is only approximately a snapshot.
+    std::uint64_t bytes_received = 0, bytes_sent = 0, messages_received = 0, invalid_messages = 0;
+    std::uint64_t frames_queued = 0, frames_dropped = 0, frames_shed = 0, slow_disconnects = 0;
+    std::uint64_t reads_paused = 0, send_errors = 0, messages_replayed = 0, heartbeats_sent = 0, idle_disconnects = 0;
+    std::uint64_t frames_decompressed = 0, frames_compressed = 0, compression_saved = 0;
+    std::uint64_t file_chunks_relayed = 0, file_bytes_served = 0, messages_routed = 0, messages_unrouted = 0;
+    std::uint64_t fan_outs = 0, nickname_conflicts = 0;
+    std::int64_t  write_queue_depth = 0, write_queue_bytes = 0, receive_buffer_bytes = 0, subscriptions = 0;
+
+    LatencyHistogram relay_latency, write_latency;
+    std::uint64_t    relay_latency_sum = 0, write_latency_sum = 0;
+
+    for(const auto& shard : m_shards)
+    {
+        const ShardMetrics& metrics = shard->metrics;
+
+        bytes_received       += metrics.bytes_received.value();
+        bytes_sent           += metrics.bytes_sent.value();
+        messages_received    += metrics.messages_received.value();
+        invalid_messages     += metrics.invalid_messages.value();
+        frames_queued        += metrics.frames_queued.value();
+        frames_dropped       += metrics.frames_dropped.value();
+        frames_shed          += metrics.frames_shed.value();
+        slow_disconnects     += metrics.slow_disconnects.value();
+        reads_paused         += metrics.reads_paused.value();
+        send_errors          += metrics.send_errors.value();
+        messages_replayed    += metrics.messages_replayed.value();
+        heartbeats_sent      += metrics.heartbeats_sent.value();
+        idle_disconnects     += metrics.idle_disconnects.value();
+        frames_decompressed  += metrics.frames_decompressed.value();
+        frames_compressed    += metrics.frames_compressed.value();
+        compression_saved    += metrics.compression_saved.value();
+        file_chunks_relayed  += metrics.file_chunks_relayed.value();
+        file_bytes_served    += metrics.file_bytes_served.value();
+        messages_routed      += metrics.messages_routed.value();
+        messages_unrouted    += metrics.messages_unrouted.value();
+        nickname_conflicts   += metrics.nickname_conflicts.value();
+        fan_outs             += metrics.fan_outs.value();
+        write_queue_depth    += metrics.write_queue_depth.value();
+        write_queue_bytes    += metrics.write_queue_bytes.value();
+        receive_buffer_bytes += metrics.receive_buffer_bytes.value();
+        subscriptions        += metrics.subscriptions.value();
+
+        relay_latency_sum += metrics.relay_latency.collect(relay_latency);
+        write_latency_sum += metrics.write_latency.collect(write_latency);
+    }
+
+    PrometheusText text;
+
+    text.counter("lanchat_connections_accepted_total", "Client connections accepted.",
+                 m_acceptMetrics.accepted.value());
+    text.counter("lanchat_connections_rejected_total", "Client connections closed because the server was full.",
+                 m_acceptMetrics.rejected.value());
+    text.counter("lanchat_accept_errors_total", "Failed accept operations.",
+                 m_acceptMetrics.accept_errors.value());
+    text.gauge("lanchat_connections", "Connected clients.",
+               static_cast<std::int64_t>(this->getClientNum()));
+    text.counter("lanchat_received_bytes_total", "Bytes read from the clients.", bytes_received);
+    text.counter("lanchat_sent_bytes_total", "Bytes written to the clients.", bytes_sent);
+    text.counter("lanchat_messages_received_total", "Messages received from the clients.", messages_received);
+    text.counter("lanchat_messages_invalid_total", "Received messages discarded as invalid.", invalid_messages);
+    text.counter("lanchat_messages_relayed_total", "Messages queued for delivery to a client.", frames_queued);
+    text.counter("lanchat_messages_dropped_total", "Queued messages discarded after a failed write.", frames_dropped);
+    text.counter("lanchat_messages_shed_total", "Messages discarded because a client was over its budget.",
+                 frames_shed);
+    text.counter("lanchat_slow_consumer_disconnects_total", "Clients disconnected because they were over their budget.",
+                 slow_disconnects);
+    text.counter("lanchat_reads_paused_total", "Reads paused because the server was over its high-watermark.",
+                 reads_paused);
+    text.counter("lanchat_send_errors_total", "Failed writes to the clients.", send_errors);
+    text.gauge("lanchat_write_queue_depth", "Messages waiting in the write queues.", write_queue_depth);
+    text.gauge("lanchat_write_queue_bytes", "Bytes waiting in the write queues.", write_queue_bytes);
+    text.gauge("lanchat_receive_buffer_bytes", "Receive buffers held by the clients.", receive_buffer_bytes);
+    text.summary("lanchat_relay_latency_seconds", "Time from the broadcast of a message to its fan-out on a shard.",
+                 relay_latency, relay_latency_sum);
+    text.counter("lanchat_fan_outs_total", "Fan-outs run by the shards, each delivering all the messages waiting.",
+                 fan_outs);
+    text.summary("lanchat_write_latency_seconds", "Time from the start to the completion of a write.",
+                 write_latency, write_latency_sum);
+    text.counter("lanchat_messages_replayed_total", "Logged messages sent again to clients that asked for them.",
+                 messages_replayed);
+    text.counter("lanchat_heartbeats_sent_total", "Heartbeats sent to clients to which nothing was written.",
+                 heartbeats_sent);
+    text.counter("lanchat_idle_disconnects_total", "Clients disconnected because they were silent for too long.",
+                 idle_disconnects);
+    text.counter("lanchat_messages_decompressed_total", "Compressed messages received from the clients.",
+                 frames_decompressed);
+    text.counter("lanchat_messages_compressed_total", "Messages sent to the clients compressed.", frames_compressed);
+    text.counter("lanchat_compression_saved_bytes_total", "Bytes saved by sending messages compressed.",
+                 compression_saved);
+    text.counter("lanchat_file_chunks_relayed_total", "File chunks queued for delivery to a client.",
+                 file_chunks_relayed);
+    text.counter("lanchat_file_served_bytes_total", "Bytes of stored files sent to the clients that fetched them.",
+                 file_bytes_served);
+    text.counter("lanchat_messages_routed_total", "Messages sent to a room or a nickname.", messages_routed);
+    text.counter("lanchat_messages_unrouted_total", "Messages to a room the sender had not joined, discarded.",
+                 messages_unrouted);
+    text.counter("lanchat_nickname_conflicts_total", "Joins and leaves of a nickname owned by another client, refused.",
+                 nickname_conflicts);
+    text.gauge("lanchat_channel_subscriptions", "Rooms and nicknames joined by the clients, all together.",
+               subscriptions);
+
+    if(m_chatLog)
+    {
+        const LogMetrics& log = m_chatLog->metrics();
+
+        LatencyHistogram    commit_latency;
+        const std::uint64_t commit_latency_sum = log.commit_latency.collect(commit_latency);
+
+        text.counter("lanchat_log_messages_total", "Messages appended to the chat log.",
+                     log.messages_appended.value());
+        text.counter("lanchat_log_commits_total", "Groups of messages written to the chat log with one flush.",
+                     log.commits.value());
+        text.counter("lanchat_log_write_errors_total", "Groups of messages that could not be written to the chat log.",
+                     log.write_errors.value());
+        text.gauge("lanchat_log_bytes", "Size of the chat log segments on disk.", log.bytes.value());
+        text.gauge("lanchat_log_segments", "Chat log segments on disk.", log.segments.value());
+        text.summary("lanchat_log_commit_latency_seconds", "Time from the append of a message to the flush of its group.",
+                     commit_latency, commit_latency_sum);
+    }
+
+    return text.text();
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////
 /// PUBLIC METHODS (STATUS GETTERS)
 ///
@@ -266,26 +1158,43 @@ const std::optional<std::atomic<bool>> &Server::is_working() const noexcept
     return m_serverStatus;
 }
 
-std::uint8_t Server::getClientNum() const noexcept
+std::size_t Server::getClientNum() const noexcept
 {
-    std::uint8_t num = 0;
-    for(const auto& connection : m_connections)
-        if(connection->state) ++num;
+    boost::lock_guard<boost::mutex> lckgrd(m_sessionsMutex);
+
+    return m_sessions.size();
+}
 
-    return num;
+std::size_t Server::getShardNum() const noexcept
+{
+    return m_shards.size();
 }
 
-void Server::startConnection() noexcept
+void Server::setMaxClientNum(const std::size_t max_client_num) noexcept
+{
+    boost::lock_guard<boost::mutex> lckgrd(m_sessionsMutex);
+
+    m_sessions.setCapacity(max_client_num);
+}
+
+bool Server::startConnection() noexcept
 {
     m_serverStatus = true;
 
     m_hasEverConnected = true;
 
-    if(!m_endpoint)
-        this->findLANIPAddress();
+    this->raiseFileDescriptorLimit();
 
     try
     {
+        // The log is opened once and kept across restarts of the connection.
+        if(m_chatLogOptions && !m_chatLog)
+            m_chatLog = std::make_unique<ChatLog>(*m_chatLogOptions);
+
+        // So is the file store.
+        if(m_fileStoreOptions && !m_fileStore)
+            m_fileStore = std::make_unique<FileStore>(*m_fileStoreOptions);
+
         if(m_endpoint)
         {
             // If there is a valid endpoint, m_acceptor start listening
@@ -293,85 +1202,87 @@ void Server::startConnection() noexcept
 
             m_acceptor->open(m_endpoint->protocol());
             m_acceptor->set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+
+            // The buffer sizes must be set before listen() to apply to the handshakes.
+            m_socketTuning.applyToAcceptor(*m_acceptor, ec);
+
+            if(ec)
+                this->notifyStatus("  Cannot set the buffer sizes of the listening socket!");
+
             m_acceptor->bind(*m_endpoint, ec);
 
             if(ec)
             {
                 throw std::runtime_error("Invalid m_endpoint (probably the "
                                          "port is occupied by another instance)!");
-
-                m_endpoint.reset();
-                m_endpoint = nullptr;
-                return;
             }
 
-            m_acceptor->listen(MAX_CLIENT_NUM);
+            m_acceptor->listen(m_socketTuning.backlog);
+
+            // With port 0 the system picks a free port; the callback reports the real one.
+            *m_endpoint = m_acceptor->local_endpoint();
+
+            if(m_callbacks.listening_on)
+                m_callbacks.listening_on(m_endpoint);
         }
         else
         {
-            throw std::runtime_error("No valid m_endpoint found after scanning interfaces!");
+            throw std::runtime_error("No endpoint was set for the server!");
         }
 
-        this->acceptConnection();
-    }
-    catch (const std::exception& e)
-    {
-        emit connectionStatus(e.what());
-    }
-}
-//////////////////////////////////////////////////////////////////////////////////////////////////
-void Server::send(const std::vector<std::uint8_t>& send_buffer,
-                  std::optional<std::uint8_t> socket_index)                  noexcept
-{
-    try
-    {
-        if(socket_index.has_value())
+        if(m_metricsAddress)
         {
-            auto& connection = m_connections.at(socket_index.value());
-
-            if(connection->state)
+            try
             {
-                boost::asio::async_write(*connection->socket,
-                                         boost::asio::buffer(send_buffer),
-                                         boost::bind(&Server::onSend,
-                                                     this,
-                                                     boost::asio::placeholders::error,
-                                                     boost::asio::placeholders::bytes_transferred
-                                                     )
-                                         );
+                m_metricsEndpoint->open(*m_metricsAddress);
+            }
+            catch (const boost::system::system_error&)
+            {
+                m_acceptor->close();
+                throw std::runtime_error("The metrics endpoint cannot be opened (probably the "
+                                         "port is occupied by another instance)!");
             }
         }
-        else
+
+        // One timer per shard drives the idle checks of all its sessions.
+        if(m_liveness.heartbeat_interval.count() > 0 || m_liveness.idle_timeout.count() > 0)
         {
-            for(auto& connection : m_connections)
+            for(auto& shard : m_shards)
             {
-                // If the socket is connected, then writing to it is allowed.
-                if(connection->state)
-                {
-                    boost::asio::async_write(*connection->socket,
-                                             boost::asio::buffer(send_buffer),
-                                             boost::bind(&Server::onSend,
-                                                         this,
-                                                         boost::asio::placeholders::error,
-                                                         boost::asio::placeholders::bytes_transferred
-                                                         )
-                                             );
-                }
+                boost::asio::post(shard->strand, [this, shard = shard.get()](){
+                    shard->nextIdleTick = std::chrono::steady_clock::now() + IDLE_TICK;
+                    this->tickIdleWheel(*shard);
+                });
             }
         }
+
+        boost::asio::co_spawn(m_acceptor->get_executor(), this->acceptLoop(), boost::asio::detached);
     }
     catch (const std::exception& e)
     {
-        emit this->connectionStatus(e.what());
+        this->notifyStatus(e.what());
+        return false;
     }
-}
 
-void Server::startRecv() noexcept
+    return true;
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////
+void Server::send(const MessageRecord& record) noexcept
 {
-    for(std::uint8_t i = 0; i < m_connections.size(); ++i)
+    // The operator writes to any valid channel, joined or not.
+    if(!record.channel.empty() && !Channel::isValid(record.channel))
+    {
+        this->notifyStatus("Invalid channel name, the message was not sent.");
+        return;
+    }
+
+    try
+    {
+        this->broadcast(m_chatLog ? m_chatLog->append(record) : record.toFrame(), nullptr, false, record.channel);
+    }
+    catch (const std::exception& e)
     {
-        if(m_connections.at(i)->state)
-            this->recv(i);
+        this->notifyStatus(e.what());
     }
 }
 
@@ -380,33 +1291,42 @@ void Server::closeConnection() noexcept
 {
     m_serverStatus = false;
 
-    boost::system::error_code ec;
-
     try
     {
         // When the server starts a new connection session, all current connections are closed.
-        for(auto& connection : m_connections)
+        // The sessions are taken out of the list first, because closing a session removes it.
+        std::vector<std::shared_ptr<Session>> sessions;
         {
-            if(connection->state)
-            {
-                connection->state = false;
+            boost::lock_guard<boost::mutex> lckgrd(m_sessionsMutex);
 
-                if(connection->socket->is_open())
-                {
-                    connection->socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
-                    connection->socket->close(ec);
+            sessions.reserve(m_sessions.size());
+            m_sessions.forEach([&sessions](std::shared_ptr<Session>& session){ sessions.push_back(session); });
+            m_sessions.clear();
+        }
 
-                    if(ec) emit connectionStatus("Error on socket shutdown/close!");
-                }
-            }
+        for(auto& session : sessions)
+            session->close();
+
+        // The paused sessions are closed; their shards forget them.
+        for(auto& shard : m_shards)
+        {
+            boost::asio::post(shard->strand, [shard = shard.get()](){
+                shard->resumeTimer.cancel();
+                shard->idleTimer.cancel();
+                shard->paused.clear();
+            });
         }
 
+        m_acceptRetryTimer->cancel();
+
         if(m_acceptor->is_open())
             m_acceptor->close();
+
+        m_metricsEndpoint->close();
     }
     catch (const std::exception& e)
     {
-        emit this->connectionStatus(e.what());
+        this->notifyStatus(e.what());
     }
 }
 
@@ -415,7 +1335,5 @@ void Server::finish() noexcept
 {
     this->closeConnection();
 
-    m_work.reset();
-    m_io_cntxt->stop();
-    m_threads.join_all();
+    m_pool->stop();
 }
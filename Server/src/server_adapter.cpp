@@ -0,0 +1,162 @@
+#include "server_adapter.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PRIVATE METHODS
+///
+std::optional<boost::asio::ip::tcp::endpoint> ServerAdapter::findLANIPAddress() noexcept
+{
+    try
+    {
+        // Finding the LAN IP address on Linux/Windows (wi-fi or ethernet)
+        const QList<QNetworkInterface> interfaces = QNetworkInterface::allInterfaces();
+
+        for (const QNetworkInterface &iface : interfaces)
+        {
+            const QString ifaceName = iface.name();
+            bool wifi_or_ethernet = false;
+
+        // Checking interfaces depending on the operating system.
+#ifdef __linux__
+            wifi_or_ethernet = ifaceName.startsWith("wl") ||
+                               ifaceName.startsWith("en") ||
+                               ifaceName.startsWith("eth");
+#elif _WIN32
+            wifi_or_ethernet = ifaceName.contains("Wi-Fi", Qt::CaseInsensitive)) ||
+                               ifaceName.startsWith("Ethernet", Qt::CaseInsensitive);
+#else
+            emit this->connectionStatus("Unknown OS!");
+            return std::nullopt;
+#endif
+            if (wifi_or_ethernet)
+            {
+                const QList<QNetworkAddressEntry> entries = iface.addressEntries();
+                for (const QNetworkAddressEntry &entry : entries)
+                {
+                    // If the address is not local to the device only, but is part of the LAN,
+                    // it can be used by the server for listening.
+                    if (entry.ip().protocol() == QAbstractSocket::IPv4Protocol && !entry.ip().isLoopback())
+                    {
+                        return boost::asio::ip::tcp::endpoint(
+                            boost::asio::ip::make_address(entry.ip().toString().toStdString()),
+                            Server::DEFAULT_PORT);
+                    }
+                }
+            }
+        }
+    }
+    catch(const std::exception& e)
+    {
+        emit this->connectionStatus(e.what());
+    }
+
+    return std::nullopt;
+}
+
+void ServerAdapter::drainMessages() noexcept
+{
+    try
+    {
+        QList<ChatMessage> messages;
+
+        m_inbox->drain([&messages](std::string_view payload){
+            MessageRecord record;
+
+            if(MessageRecord::decode(payload, record))
+                messages.append(ChatMessage::fromRecord(record));
+        }, MAX_DRAIN_BATCH);
+
+        if(!messages.isEmpty())
+            emit this->messages_received(messages);
+    }
+    catch(const std::exception& e)
+    {
+        emit this->connectionStatus(e.what());
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+ServerAdapter::ServerAdapter(QObject* parent)
+    : QObject(parent),
+      m_server(std::make_unique<Server>())
+{
+    // The callbacks run on the worker threads; the signals reach the GUI
+    // through queued connections.
+    m_inbox = std::make_unique<MessageInbox>(m_server->getShardNum(), [this](){
+        QMetaObject::invokeMethod(this, [this](){ this->drainMessages(); }, Qt::QueuedConnection);
+    });
+
+    Server::Callbacks callbacks;
+
+    callbacks.listening_on = [this](const std::shared_ptr<boost::asio::ip::tcp::endpoint>& endpoint){
+        emit this->listening_on(endpoint);
+    };
+    callbacks.message_received = [this](const std::size_t shard, std::string_view message){
+        m_inbox->push(shard, message);
+    };
+    callbacks.connection_status = [this](const char* status){
+        // The text is copied before the thread hop: a queued signal keeps its
+        // arguments, and a status may point into an exception that is gone by then.
+        emit this->connectionStatus(QString::fromUtf8(status));
+    };
+
+    m_server->setCallbacks(std::move(callbacks));
+}
+
+ServerAdapter::~ServerAdapter()
+{
+    // The worker threads may still call back into the adapter while the
+    // server shuts down, so the server goes first.
+    m_server.reset();
+}
+
+void ServerAdapter::setGroupChat(const bool value) noexcept
+{
+    m_server->setGroupChat(value);
+}
+
+bool& ServerAdapter::getHasEverConnected() noexcept
+{
+    return m_server->getHasEverConnected();
+}
+
+const std::optional<std::atomic<bool>>& ServerAdapter::is_working() const noexcept
+{
+    return m_server->is_working();
+}
+
+std::size_t ServerAdapter::getClientNum() const noexcept
+{
+    return m_server->getClientNum();
+}
+
+void ServerAdapter::startConnection() noexcept
+{
+    if(!m_endpoint)
+        m_endpoint = this->findLANIPAddress();
+
+    if(!m_endpoint)
+    {
+        emit this->connectionStatus("No valid m_endpoint found after scanning interfaces!");
+        return;
+    }
+
+    m_server->setEndpoint(m_endpoint.value());
+    m_server->startConnection();
+}
+
+void ServerAdapter::send(const MessageRecord& record) noexcept
+{
+    m_server->send(record);
+}
+
+void ServerAdapter::closeConnection() noexcept
+{
+    m_server->closeConnection();
+}
+
+void ServerAdapter::finish() noexcept
+{
+    m_server->finish();
+}
@@ -33,10 +33,9 @@ void SMainWindow::resetAtributes()
         m_welcomeLabel = nullptr;
 
     m_connectionStatusLabel = nullptr;
-    m_messagesLabel         = nullptr;
-
-    m_messagesLabelScroll   = nullptr;
-    m_messagesLabelLayout   = nullptr;
+    m_messagesView          = nullptr;
+    m_messagesModel         = nullptr;
+    m_messagesLayout        = nullptr;
 
     m_userInputLine         = nullptr;
 
@@ -109,7 +108,7 @@ void SMainWindow::addStatusLable()
     m_connectionStatusLabel->show();
 
 
-    connect(m_server, &Server::listening_on, this, &SMainWindow::setStatusLabel);
+    connect(m_server, &ServerAdapter::listening_on, this, &SMainWindow::setStatusLabel);
 }
 
 void SMainWindow::addUserInput()
@@ -136,24 +135,22 @@ void SMainWindow::addUserInput()
     connect(m_userInputLine, &QLineEdit::returnPressed, this, &SMainWindow::sendingMessages);
 }
 
-void SMainWindow::addMessagesLabel()
+void SMainWindow::addMessagesView()
 {
-    m_messagesLabel = new QLabel(m_centralWidget);
-    m_messagesLabel->setFrameStyle(QFrame::Panel | QFrame::Sunken);
-    m_messagesLabel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
-    m_messagesLabel->setTextInteractionFlags(Qt::TextSelectableByMouse | Qt::TextSelectableByKeyboard);
-    m_messagesLabel->setWordWrap(true);
-    m_messagesLabel->setAlignment(Qt::AlignBottom);
-
-    m_messagesLabelScroll = new QScrollArea(m_centralWidget);
-    m_messagesLabelScroll->setWidget(m_messagesLabel);
-    m_messagesLabelScroll->setWidgetResizable(true);
-    m_messagesLabelScroll->setPalette(*m_widgetsPalette);
-
-    m_messagesLabelLayout = new QHBoxLayout();
-    m_messagesLabelLayout->addWidget(m_messagesLabelScroll);
-
-    m_verticalLayout->addLayout(m_messagesLabelLayout, Qt::AlignCenter);
+    // Only the visible messages are laid out, so the cost of a new message does not
+    // grow with the length of the history.
+    m_messagesView  = new ChatLogView(m_centralWidget);
+    m_messagesModel = new ChatLogModel(m_messagesView);
+
+    m_messagesView->setModel(m_messagesModel);
+    m_messagesView->setFrameStyle(QFrame::Panel | QFrame::Sunken);
+    m_messagesView->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+    m_messagesView->setPalette(*m_widgetsPalette);
+
+    m_messagesLayout = new QHBoxLayout();
+    m_messagesLayout->addWidget(m_messagesView);
+
+    m_verticalLayout->addLayout(m_messagesLayout, Qt::AlignCenter);
 }
 
 void SMainWindow::startListening()
@@ -162,7 +159,7 @@ void SMainWindow::startListening()
     // necessary to close the previous one.
     if(m_server->is_working().has_value() && m_server->is_working())
     {
-        disconnect(m_server, &Server::message_received, nullptr, nullptr);
+        disconnect(m_server, &ServerAdapter::messages_received, nullptr, nullptr);
 
         if(m_centralWidget)
         {
@@ -188,47 +185,55 @@ void SMainWindow::startListening()
             this->resetAtributes();
         }
 
-        connect(m_server, &Server::connectionStatus, this, &SMainWindow::connectionStatus);
+        connect(m_server, &ServerAdapter::connectionStatus, this, &SMainWindow::connectionStatus);
     }
 
-    m_serverThread = std::make_unique<boost::thread>(&Server::startConnection, m_server);
+    m_serverThread = std::make_unique<boost::thread>(&ServerAdapter::startConnection, m_server);
     this->addLayouts();
     this->addStatusLable();
 }
 
 void SMainWindow::sendingMessages()
 {
-    std::string input = m_userInputLine->text().toStdString();
+    const std::string input = m_userInputLine->text().toStdString();
     m_userInputLine->clear();
 
     if(input.empty())
         return;
 
-    input = "<span style='color: red;'>SERVER: </span>" + input + "<br>";
+    // "/msg <#room|@nickname> text" writes to the members of a room, or to someone;
+    // anything else goes to everyone.
+    std::string_view channel;
+    std::string_view text = input;
+    std::string_view rest;
+
+    if(Channel::parseCommand(input, "msg", channel, rest))
+        text = rest;
 
-    std::copy(input.begin(), input.end(), std::back_inserter(m_send_buffer));
+    // Only the fields travel; how the message looks is decided by each receiver.
+    MessageRecord record;
+    record.type      = MessageRecord::Type::Broadcast;
+    record.timestamp = MessageRecord::now();
+    record.channel   = channel;
+    record.sender    = SENDER_NAME;
+    record.body      = text;
 
-    m_server->send(m_send_buffer);
-    m_send_buffer.clear();
+    m_server->send(record);
 
-    // Adding text to the messageLabel
-    this->displayMessage(input);
+    // Adding the message to the history
+    this->displayMessage(ChatMessage::fromRecord(record));
 }
 
-void SMainWindow::displayMessage(const std::string &message)
+void SMainWindow::displayMessage(const ChatMessage& message)
 {
-    boost::lock_guard<boost::mutex> lckgrd(m_messageLabelMutex);
-
-    m_messagesLabel->setText(m_messagesLabel->text() + QString::fromStdString(message));
-
-    // Adjust the widget size to fit the new content.
-    // This ensures that the text is fully visible and that the scrollbar will adjust accordingly.
-    m_messagesLabel->adjustSize();
+    this->displayMessages(QList<ChatMessage>{message});
+}
 
-    // Set scroll bar in the bottom position
-    m_messagesLabelScroll->verticalScrollBar()->setValue(
-        m_messagesLabelScroll->verticalScrollBar()->maximum()
-    );
+void SMainWindow::displayMessages(const QList<ChatMessage>& messages)
+{
+    // One rowsInserted for the whole batch; the view follows the new messages
+    // if it was showing the latest ones.
+    m_messagesModel->appendMessages(messages);
 }
 
 void SMainWindow::cleanup()
@@ -251,37 +256,35 @@ void SMainWindow::setStatusLabel(const std::shared_ptr<boost::asio::ip::tcp::end
     m_connectionStatusLabel->setText(ipAndPort);
 
     // Disconnection from signal
-    disconnect(m_server, &Server::listening_on, this, &SMainWindow::setStatusLabel);
+    disconnect(m_server, &ServerAdapter::listening_on, this, &SMainWindow::setStatusLabel);
 }
 
-void SMainWindow::connectionStatus(const char* status)
+void SMainWindow::connectionStatus(const QString& status)
 {
     QPalette labelPalette;
     m_connectionStatusLabel->setText(status);
 
-    labelPalette.setColor(QPalette::WindowText, (!std::strcmp(status, "  Connected!"))? Qt::green : Qt::red);
+    labelPalette.setColor(QPalette::WindowText, (status == "  Connected!")? Qt::green : Qt::red);
     m_connectionStatusLabel->setPalette(labelPalette);
 
-    if(!std::strcmp(status, "  Connected!"))
+    if(status == "  Connected!")
     {
         // The graphical interface for displaying messages is initialized only when
         // the first client is connected.
         if(m_server->getClientNum() == 1)
         {
-            this->addMessagesLabel();
+            this->addMessagesView();
             this->addUserInput();
 
-            connect(m_server,&Server::message_received, this, &SMainWindow::displayMessage);
+            connect(m_server,&ServerAdapter::messages_received, this, &SMainWindow::displayMessages);
         }
-
-        m_server->startRecv();
     }
 }
 
 void SMainWindow::clearMessages()
 {
-    if(m_messagesLabel)
-        m_messagesLabel->clear();
+    if(m_messagesModel)
+        m_messagesModel->clear();
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////
@@ -304,7 +307,7 @@ void SMainWindow::resizeEvent(QResizeEvent *event)
 /// PUBLIC METHODS
 ///
 SMainWindow::SMainWindow(QWidget *parent) : QMainWindow(parent),
-                                            m_server(new Server(this)),
+                                            m_server(new ServerAdapter(this)),
                                             m_serverThread(nullptr)
 {
     this->initWelcomeScreen();
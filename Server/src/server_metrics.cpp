@@ -0,0 +1,58 @@
+#include "server_metrics.h"
+
+#include <cstdio>
+#include <utility>
+
+namespace
+{
+    std::string seconds(const std::uint64_t nanoseconds)
+    {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.9g", static_cast<double>(nanoseconds) / 1e9);
+
+        return text;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PRIVATE METHODS
+///
+void PrometheusText::header(std::string_view name, std::string_view help, std::string_view type)
+{
+    m_text.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    m_text.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+void PrometheusText::counter(std::string_view name, std::string_view help, const std::uint64_t value)
+{
+    this->header(name, help, "counter");
+    m_text.append(name).append(" ").append(std::to_string(value)).append("\n");
+}
+
+void PrometheusText::gauge(std::string_view name, std::string_view help, const std::int64_t value)
+{
+    this->header(name, help, "gauge");
+    m_text.append(name).append(" ").append(std::to_string(value)).append("\n");
+}
+
+void PrometheusText::summary(std::string_view name, std::string_view help,
+                             const LatencyHistogram& histogram, const std::uint64_t sum)
+{
+    static constexpr std::pair<const char*, double> QUANTILES[] = {
+        {"0.5", 0.5}, {"0.9", 0.9}, {"0.99", 0.99}, {"0.999", 0.999}
+    };
+
+    this->header(name, help, "summary");
+
+    for(const auto& [label, fraction] : QUANTILES)
+    {
+        m_text.append(name).append("{quantile=\"").append(label).append("\"} ")
+              .append(seconds(histogram.percentile(fraction))).append("\n");
+    }
+
+    m_text.append(name).append("_sum ").append(seconds(sum)).append("\n");
+    m_text.append(name).append("_count ").append(std::to_string(histogram.count())).append("\n");
+}
@@ -0,0 +1,728 @@
+#include "session.h"
+#include "server.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <string>
+
+#if defined(__linux__)
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/sendfile.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PRIVATE METHODS
+///
+boost::asio::awaitable<void> Session::readLoop(std::shared_ptr<Session> self)
+{
+    boost::system::error_code ec;
+
+    try
+    {
+        while(m_state)
+        {
+            // No buffer is tied to the wait, so an idle session holds no receive memory.
+            co_await m_socket.async_wait(boost::asio::ip::tcp::socket::wait_read,
+                                         boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
+            if(!this->readAvailable(ec))
+                co_return;
+
+            // While the server holds too much for slow clients, the senders stop being read:
+            // their data waits in the kernel buffers and TCP slows them down.
+            if(m_server.overHighWatermark())
+            {
+                m_server.pauseReading(self);
+                co_return;
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        m_server.reportStatus(e.what());
+        this->close();
+    }
+}
+
+bool Session::readAvailable(const boost::system::error_code& ec) noexcept
+{
+    boost::system::error_code read_ec = ec;
+
+    try
+    {
+        for(std::size_t i = 0; !read_ec && i < MAX_READS_PER_WAKEUP; ++i)
+        {
+            const bool more = this->readSome(read_ec);
+
+            if(read_ec)
+                break;
+
+            // A single read may contain several frames, or only a part of one.
+            std::string_view payload;
+            FrameDecoder::Status status;
+
+            while((status = m_decoder.next(payload)) == FrameDecoder::Status::Ok)
+            {
+                m_metrics.messages_received.add();
+                m_server.onMessage(*this, payload);
+            }
+
+            if(status == FrameDecoder::Status::Oversized)
+            {
+                // The stream can no longer be split into messages, so the client is dropped.
+                m_server.reportStatus("Invalid frame received, client disconnected!");
+                this->close();
+
+                m_decoder.reset();
+                this->releaseBuffer();
+                return false;
+            }
+
+            if(!more)
+                break;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        m_server.reportStatus(e.what());
+        read_ec = boost::asio::error::no_memory;
+    }
+
+    if(read_ec && read_ec != boost::asio::error::would_block)
+    {
+        if(m_state)
+        {
+            m_server.reportStatus(read_ec == boost::asio::error::eof ? "  A client has disconnected."
+                                                                     : "Async_read_some error!");
+            this->close();
+        }
+
+        m_decoder.reset();
+        this->releaseBuffer();
+        return false;
+    }
+
+    this->releaseBuffer();
+    return true;
+}
+
+bool Session::readSome(boost::system::error_code& ec)
+{
+    // The scratch buffer is only used during this synchronous call, so one per
+    // thread serves all the sessions: a burst larger than the receive buffer is
+    // still read in a single call, and only the bytes actually received are kept.
+    thread_local std::array<std::uint8_t, SCRATCH_SIZE> scratch;
+
+    const boost::asio::mutable_buffer own = m_decoder.prepare();
+    const std::array<boost::asio::mutable_buffer, 2> buffers{own, boost::asio::buffer(scratch)};
+
+    const std::size_t bytes = m_socket.read_some(buffers, ec);
+
+    if(ec)
+        return false;
+
+    if(bytes <= own.size())
+    {
+        m_decoder.commit(bytes);
+    }
+    else
+    {
+        m_decoder.commit(own.size());
+        m_decoder.append(scratch.data(), bytes - own.size());
+    }
+
+    m_metrics.bytes_received.add(bytes);
+    m_lastReceive = m_idleWheel.now();
+
+    m_server.m_socketTuning.rearm(m_socket);
+
+    return bytes == own.size() + scratch.size();
+}
+
+void Session::releaseBuffer() noexcept
+{
+    m_decoder.release();
+
+    m_metrics.receive_buffer_bytes.add(static_cast<std::int64_t>(m_decoder.capacity()) -
+                                       static_cast<std::int64_t>(m_bufferBytes));
+    m_bufferBytes = m_decoder.capacity();
+}
+
+// self is never read: it lives in the coroutine frame, so that the session outlives
+// the loop however long it sleeps.
+boost::asio::awaitable<void> Session::writeLoop([[maybe_unused]] std::shared_ptr<Session> self)
+{
+    boost::system::error_code ec;
+
+    try
+    {
+        while(m_state)
+        {
+            std::size_t bytes = 0;
+
+            // File data only goes out while no other frame waits, one chunk at a time.
+            if(!m_writeQueue.empty())
+            {
+                bytes = co_await this->writeFrames(ec);
+            }
+            else if(!m_bulkQueue.empty())
+            {
+                bytes = co_await this->writeBulk(ec);
+            }
+            else if(!m_files.empty())
+            {
+                bytes = co_await this->writeFileChunk(ec);
+            }
+            else
+            {
+                // Sleeps until deliver() or close() cancels the wait.
+                m_writeSignal.expires_at(std::chrono::steady_clock::time_point::max());
+                co_await m_writeSignal.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+                continue;
+            }
+
+            if(ec)
+            {
+                // A write that failed partway has put a truncated frame on the wire:
+                // the stream cannot be continued. The queue is dropped below.
+                m_metrics.send_errors.add();
+
+                if(m_state)
+                {
+                    m_server.reportStatus("An error occurred while transmitting data.");
+                    this->close();
+                }
+
+                break;
+            }
+
+            m_metrics.bytes_sent.add(bytes);
+            m_lastSend = m_idleWheel.now();
+            m_metrics.write_latency.record(std::chrono::steady_clock::now() - m_writeStart);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        m_server.reportStatus(e.what());
+        this->close();
+    }
+
+    // Frames queued just before the close are never written.
+    this->dropQueue();
+}
+
+boost::asio::awaitable<std::size_t> Session::writeFrames(boost::system::error_code& ec)
+{
+    // Everything queued so far leaves in a single gathered write.
+    m_writeBatch = std::min(m_writeQueue.size(), MAX_WRITE_BATCH);
+
+    m_writeBuffers.clear();
+    for(std::size_t i = 0; i < m_writeBatch; ++i)
+        m_writeBuffers.push_back(m_writeQueue[i].buffer());
+
+    m_writeStart = std::chrono::steady_clock::now();
+
+    // The frames are held by the queue until the write completes.
+    const std::size_t bytes =
+        co_await boost::asio::async_write(m_socket, m_writeBuffers,
+                                          boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
+    if(ec)
+        co_return 0;
+
+    m_metrics.write_queue_depth.add(-static_cast<std::int64_t>(m_writeBatch));
+    m_metrics.write_queue_bytes.add(-static_cast<std::int64_t>(bytes));
+
+    // Frames queued during the write are sent together in the next one.
+    m_queuedBytes -= bytes;
+    m_writeQueue.erase(m_writeQueue.begin(), m_writeQueue.begin() + m_writeBatch);
+    m_writeBatch = 0;
+
+    co_return bytes;
+}
+
+boost::asio::awaitable<std::size_t> Session::writeBulk(boost::system::error_code& ec)
+{
+    this->limitUnsent();
+
+    m_bulkWriting = true;
+    m_writeStart  = std::chrono::steady_clock::now();
+
+    const std::size_t bytes =
+        co_await boost::asio::async_write(m_socket, m_bulkQueue.front().buffer(),
+                                          boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
+    m_bulkWriting = false;
+
+    if(ec)
+        co_return 0;
+
+    m_metrics.write_queue_depth.add(-1);
+    m_metrics.write_queue_bytes.add(-static_cast<std::int64_t>(bytes));
+
+    m_bulkBytes -= bytes;
+    m_bulkQueue.pop_front();
+
+    co_return bytes;
+}
+
+boost::asio::awaitable<std::size_t> Session::writeFileChunk(boost::system::error_code& ec)
+{
+    // The copy keeps the file open even if a close empties m_files in the meantime.
+    const SharedFile    file   = m_files.front();
+    const std::uint64_t offset = m_fileOffset;
+    const std::size_t   size   = static_cast<std::size_t>(std::min<std::uint64_t>(FileTransfer::CHUNK_SIZE,
+                                                                                   file->size - offset));
+
+    this->limitUnsent();
+
+    Frame::encodeHeader(m_chunkPrefix.data(), static_cast<std::uint32_t>(FileTransfer::CHUNK_HEADER_SIZE + size));
+    FileTransfer::encodeChunkHeader(m_chunkPrefix.data() + Frame::HEADER_SIZE, file->id, offset);
+
+    m_writeStart = std::chrono::steady_clock::now();
+
+    std::size_t bytes =
+        co_await boost::asio::async_write(m_socket, boost::asio::buffer(m_chunkPrefix),
+                                          boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
+    if(ec)
+        co_return 0;
+
+#if defined(__linux__)
+    // The data goes from the page cache to the socket without passing through the
+    // server; the socket is non-blocking, so a full send buffer is waited for.
+    off_t       position = static_cast<off_t>(offset);
+    std::size_t left     = size;
+
+    while(left > 0)
+    {
+        const ssize_t sent = ::sendfile(m_socket.native_handle(), ::fileno(file->file), &position, left);
+
+        if(sent > 0)
+        {
+            left  -= static_cast<std::size_t>(sent);
+            bytes += static_cast<std::size_t>(sent);
+            continue;
+        }
+
+        if(sent < 0 && errno == EINTR)
+            continue;
+
+        if(sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            co_await m_socket.async_wait(boost::asio::ip::tcp::socket::wait_write,
+                                         boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            if(ec)
+                co_return 0;
+
+            continue;
+        }
+
+        // The frame is cut short: the stream cannot be continued.
+        ec = (sent == 0) ? boost::system::error_code(boost::asio::error::eof)
+                         : boost::system::error_code(errno, boost::system::system_category());
+        this->close();
+        co_return 0;
+    }
+#else
+    // Elsewhere the chunk is read into a buffer of the coroutine first. Sessions of
+    // other shards may be reading the same file: the read never moves a position
+    // they share.
+    std::string data(size, '\0');
+    bool        read = false;
+
+#if defined(__unix__) || defined(__APPLE__)
+    std::size_t done = 0;
+
+    while(done < size)
+    {
+        const ssize_t n = ::pread(::fileno(file->file), data.data() + done, size - done,
+                                  static_cast<off_t>(offset + done));
+        if(n > 0)
+            done += static_cast<std::size_t>(n);
+        else if(n < 0 && errno == EINTR)
+            continue;
+        else
+            break;
+    }
+
+    read = done == size;
+#else
+    {
+        boost::lock_guard<boost::mutex> lckgrd(file->read_mutex);
+
+        read = std::fseek(file->file, static_cast<long>(offset), SEEK_SET) == 0 &&
+               std::fread(data.data(), 1, size, file->file) == size;
+    }
+#endif
+
+    if(!read)
+    {
+        ec = boost::asio::error::eof;
+        this->close();
+        co_return 0;
+    }
+
+    bytes += co_await boost::asio::async_write(m_socket, boost::asio::buffer(data),
+                                               boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    if(ec)
+        co_return 0;
+#endif
+
+    m_metrics.file_bytes_served.add(size);
+
+    // A close may have emptied the list during the write.
+    if(!m_files.empty() && m_files.front() == file)
+    {
+        m_fileOffset += size;
+
+        if(m_fileOffset == file->size)
+        {
+            m_files.pop_front();
+            m_fileOffset = 0;
+        }
+    }
+
+    co_return bytes;
+}
+
+void Session::limitUnsent() noexcept
+{
+    if(m_bulkLimited)
+        return;
+
+    m_bulkLimited = true;
+
+    // A socket tuning that already keeps less unsent data is left as it is.
+    const int tuned = m_server.m_socketTuning.not_sent_lowat;
+
+    if(tuned > 0 && tuned <= BULK_UNSENT_LIMIT)
+        return;
+
+#if defined(TCP_NOTSENT_LOWAT)
+    // The socket is writable again only below the limit, so a chat message waits
+    // for one chunk at most; the send buffer keeps its size for the data in flight.
+    boost::system::error_code ec;
+    m_socket.set_option(boost::asio::detail::socket_option::integer<IPPROTO_TCP, TCP_NOTSENT_LOWAT>(BULK_UNSENT_LIMIT), ec);
+#endif
+}
+
+void Session::dropQueue() noexcept
+{
+    const std::size_t frames = m_writeQueue.size() + m_bulkQueue.size();
+
+    m_metrics.frames_dropped.add(frames);
+    m_metrics.write_queue_depth.add(-static_cast<std::int64_t>(frames));
+    m_metrics.write_queue_bytes.add(-static_cast<std::int64_t>(m_queuedBytes + m_bulkBytes));
+
+    m_writeBatch  = 0;
+    m_queuedBytes = 0;
+    m_bulkBytes   = 0;
+    m_fileOffset  = 0;
+    m_writeQueue.clear();
+    m_bulkQueue.clear();
+    m_files.clear();
+}
+
+bool Session::makeRoom(const std::size_t frame_size) noexcept
+{
+    const Server::FlowControl& flow_control = m_server.m_flowControl;
+
+    switch(flow_control.policy)
+    {
+    case Server::SlowConsumerPolicy::DropOldest:
+        // The frames of the write in flight stay; the ones after them go, oldest first.
+        while(m_writeQueue.size() > m_writeBatch && m_queuedBytes + frame_size > flow_control.session_budget)
+        {
+            const std::size_t size = m_writeQueue[m_writeBatch].size();
+
+            m_writeQueue.erase(m_writeQueue.begin() + static_cast<std::ptrdiff_t>(m_writeBatch));
+            m_queuedBytes -= size;
+
+            m_metrics.frames_shed.add();
+            m_metrics.write_queue_depth.add(-1);
+            m_metrics.write_queue_bytes.add(-static_cast<std::int64_t>(size));
+        }
+
+        return true;
+
+    case Server::SlowConsumerPolicy::DropNewest:
+        m_metrics.frames_shed.add();
+        return false;
+
+    case Server::SlowConsumerPolicy::Disconnect:
+        m_metrics.frames_shed.add();
+        m_metrics.slow_disconnects.add();
+        m_server.reportStatus("A client was too slow to receive messages and was disconnected.");
+        this->close();
+        return false;
+    }
+
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PUBLIC METHODS
+///
+Session::Session(Strand strand, Server& server, const std::size_t shard, ShardMetrics& metrics,
+                 const IdleWheel& idle_wheel)
+    : m_server(server),
+      m_metrics(metrics),
+      m_idleWheel(idle_wheel),
+      m_strand(std::move(strand)),
+      m_socket(m_strand),
+      m_writeSignal(m_strand),
+      m_bufferBytes(0),
+      m_writeBatch(0),
+      m_queuedBytes(0),
+      m_bulkBytes(0),
+      m_bulkWriting(false),
+      m_bulkLimited(false),
+      m_fileOffset(0),
+      m_lastReceive(0),
+      m_lastSend(0),
+      m_codecs(0),
+      m_id(INVALID_ID),
+      m_shard(shard),
+      m_shardSlot(INVALID_ID),
+      m_state(false),
+      m_reading(false)
+{
+    m_writeBuffers.reserve(MAX_WRITE_BATCH);
+}
+
+boost::asio::ip::tcp::socket& Session::socket() noexcept
+{
+    return m_socket;
+}
+
+Session::Id Session::id() const noexcept
+{
+    return m_id;
+}
+
+void Session::setId(const Id id) noexcept
+{
+    m_id = id;
+}
+
+std::size_t Session::shard() const noexcept
+{
+    return m_shard;
+}
+
+Session::Id Session::shardSlot() const noexcept
+{
+    return m_shardSlot;
+}
+
+void Session::setShardSlot(const Id slot) noexcept
+{
+    m_shardSlot = slot;
+}
+
+void Session::markActive() noexcept
+{
+    m_lastReceive = m_idleWheel.now();
+    m_lastSend    = m_lastReceive;
+}
+
+Session::IdleWheel::Tick Session::lastReceive() const noexcept
+{
+    return m_lastReceive;
+}
+
+Session::IdleWheel::Tick Session::lastSend() const noexcept
+{
+    return m_lastSend;
+}
+
+bool Session::hasQueuedFrames() const noexcept
+{
+    return !m_writeQueue.empty() || !m_bulkQueue.empty() || !m_files.empty();
+}
+
+Compression::CodecSet Session::codecs() const noexcept
+{
+    return m_codecs;
+}
+
+void Session::setCodecs(const Compression::CodecSet codecs) noexcept
+{
+    m_codecs = codecs;
+}
+
+bool Session::is_open() const noexcept
+{
+    return m_state;
+}
+
+void Session::start() noexcept
+{
+    m_state = true;
+}
+
+void Session::startRecv() noexcept
+{
+    if(!m_reading.exchange(true))
+    {
+        boost::asio::post(m_strand, [self = shared_from_this()](){
+            // The reads are synchronous and must not block once the socket is readable.
+            boost::system::error_code ec;
+            self->m_socket.non_blocking(true, ec);
+
+            try
+            {
+                // Both loops run on the strand; the write loop lasts as long as the session.
+                boost::asio::co_spawn(self->m_strand, self->writeLoop(self), boost::asio::detached);
+                boost::asio::co_spawn(self->m_strand, self->readLoop(self), boost::asio::detached);
+            }
+            catch (const std::exception& e)
+            {
+                self->m_server.reportStatus(e.what());
+                self->close();
+            }
+        });
+    }
+}
+
+void Session::resumeRecv() noexcept
+{
+    try
+    {
+        boost::asio::co_spawn(m_strand, this->readLoop(shared_from_this()), boost::asio::detached);
+    }
+    catch (const std::exception& e)
+    {
+        m_server.reportStatus(e.what());
+        this->close();
+    }
+}
+
+void Session::send(SharedFrame frame) noexcept
+{
+    if(!m_state)
+        return;
+
+    try
+    {
+        boost::asio::dispatch(m_strand, [self = shared_from_this(), frame = std::move(frame)]() mutable {
+            self->deliver(std::move(frame));
+        });
+    }
+    catch (const std::exception& e)
+    {
+        m_server.reportStatus(e.what());
+    }
+}
+
+void Session::deliver(SharedFrame frame, const bool bulk) noexcept
+{
+    if(!m_state)
+        return;
+
+    try
+    {
+        const std::size_t size = frame.size();
+
+        if(bulk)
+        {
+            // The chunks have a budget of their own, so a file never sheds chat messages.
+            // A chunk always fits in an empty queue.
+            if(!m_bulkQueue.empty() && m_bulkBytes + size > m_server.m_flowControl.session_budget)
+            {
+                m_metrics.frames_shed.add();
+                return;
+            }
+
+            m_bulkQueue.push_back(std::move(frame));
+            m_bulkBytes += size;
+
+            m_metrics.file_chunks_relayed.add();
+        }
+        else
+        {
+            // A frame always fits in an empty queue, even if it is larger than the budget.
+            if(!m_writeQueue.empty() && m_queuedBytes + size > m_server.m_flowControl.session_budget &&
+               !this->makeRoom(size))
+                return;
+
+            m_writeQueue.push_back(std::move(frame));
+            m_queuedBytes += size;
+        }
+
+        m_metrics.frames_queued.add();
+        m_metrics.write_queue_depth.add(1);
+        m_metrics.write_queue_bytes.add(static_cast<std::int64_t>(size));
+
+        // If a write is already in flight, the frame leaves after it; otherwise the
+        // write loop is woken up.
+        if(m_writeBatch == 0 && !m_bulkWriting)
+            m_writeSignal.cancel();
+    }
+    catch (const std::exception& e)
+    {
+        m_server.reportStatus(e.what());
+    }
+}
+
+void Session::streamFile(SharedFile file) noexcept
+{
+    if(!m_state || !file)
+        return;
+
+    try
+    {
+        // Each queued file holds a descriptor: a client gets only a few at a time,
+        // and is told that the others are not available.
+        if(m_files.size() >= MAX_STREAMED_FILES)
+        {
+            this->deliver(FileTransfer::offerFrame("SERVER", FileTransfer::Offer{file->id, 0, {}}));
+            return;
+        }
+
+        this->deliver(file->offer);
+
+        if(file->size > 0)
+        {
+            m_files.push_back(std::move(file));
+            m_writeSignal.cancel();
+        }
+    }
+    catch (const std::exception& e)
+    {
+        m_server.reportStatus(e.what());
+    }
+}
+
+void Session::close() noexcept
+{
+    if(!m_state.exchange(false))
+        return;
+
+    m_server.removeSession(shared_from_this());
+
+    try
+    {
+        boost::asio::dispatch(m_strand, [self = shared_from_this()](){
+            boost::system::error_code ec;
+
+            // Wakes the write loop up, so that it ends.
+            self->m_writeSignal.cancel(ec);
+
+            if(self->m_socket.is_open())
+            {
+                self->m_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+                self->m_socket.close(ec);
+            }
+        });
+    }
+    catch (const std::exception& e)
+    {
+        m_server.reportStatus(e.what());
+    }
+}
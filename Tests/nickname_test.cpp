@@ -0,0 +1,255 @@
+#include "frame.h"
+#include "message_record.h"
+#include "server.h"
+
+#include <boost/asio.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// A nickname belongs to the first connection that joins it: a second connection
+// that joins it is refused and does not receive its direct messages, until the
+// owner disconnects. Exits with 0 if the server behaves so.
+namespace
+{
+    using boost::asio::ip::tcp;
+
+    constexpr auto READ_TIMEOUT = std::chrono::seconds(5);
+
+    /**
+     * @struct Received
+     * @brief What a test connection keeps of a received record.
+     */
+    struct Received
+    {
+        MessageRecord::Type type;
+        std::string         channel;
+        std::string         body;
+    };
+
+    /**
+     * @class Peer
+     * @brief A raw client connection, read and written synchronously.
+     */
+    class Peer
+    {
+    private: // Fields
+        boost::asio::io_context m_io_cntxt;
+        tcp::socket             m_sckt;
+        FrameDecoder            m_decoder;
+
+    public:
+        explicit Peer(const tcp::endpoint& endpoint)
+            : m_sckt(m_io_cntxt)
+        {
+            m_sckt.connect(endpoint);
+        }
+
+        void send(const MessageRecord::Type type, std::string_view channel, std::string_view body = {})
+        {
+            MessageRecord record;
+            record.type      = type;
+            record.timestamp = MessageRecord::now();
+            record.sender    = "test";
+            record.channel   = channel;
+            record.body      = body;
+
+            boost::asio::write(m_sckt, record.toFrame().buffer());
+        }
+
+        /// Sends a Hello: the server answers it after every record sent before it.
+        void sync()
+        {
+            this->send(MessageRecord::Type::Hello, {});
+        }
+
+        /// The next record, or nullopt if none arrives in time.
+        std::optional<Received> next()
+        {
+            for(;;)
+            {
+                std::string_view payload;
+
+                if(m_decoder.next(payload) == FrameDecoder::Status::Ok)
+                {
+                    MessageRecord record;
+
+                    if(!MessageRecord::decode(payload, record))
+                        continue;
+
+                    return Received{record.type, std::string(record.channel), std::string(record.body)};
+                }
+
+                boost::system::error_code ec = boost::asio::error::timed_out;
+                std::size_t               n_bytes = 0;
+
+                m_sckt.async_read_some(m_decoder.prepare(), [&ec, &n_bytes](const boost::system::error_code& error,
+                                                                            const std::size_t n){
+                    ec      = error;
+                    n_bytes = n;
+                });
+
+                m_io_cntxt.restart();
+                m_io_cntxt.run_for(READ_TIMEOUT);
+
+                if(!m_io_cntxt.stopped())
+                {
+                    m_sckt.cancel();
+                    m_io_cntxt.run();
+                    return std::nullopt;
+                }
+
+                if(ec)
+                    return std::nullopt;
+
+                m_decoder.commit(n_bytes);
+            }
+        }
+
+        /// Reads up to the server's answer to sync(); false if a Leave of the channel came before.
+        bool joined(std::string_view channel)
+        {
+            bool refused = false;
+
+            while(const auto received = this->next())
+            {
+                if(received->type == MessageRecord::Type::Hello)
+                    return !refused;
+
+                if(received->type == MessageRecord::Type::Leave && received->channel == channel)
+                    refused = true;
+            }
+
+            return false;
+        }
+
+        /// Reads up to the message of a room; true if a direct message to the channel came before.
+        bool receivedBefore(std::string_view channel, std::string_view room)
+        {
+            bool received_dm = false;
+
+            while(const auto received = this->next())
+            {
+                if(received->type != MessageRecord::Type::Chat)
+                    continue;
+
+                if(received->channel == room)
+                    return received_dm;
+
+                if(received->channel == channel)
+                    received_dm = true;
+            }
+
+            return received_dm;
+        }
+
+        void close()
+        {
+            boost::system::error_code ec;
+            m_sckt.shutdown(tcp::socket::shutdown_both, ec);
+            m_sckt.close(ec);
+        }
+    };
+
+    bool check(const bool condition, const char* what)
+    {
+        if(!condition)
+            std::cerr << "nickname_test: " << what << '\n';
+
+        return condition;
+    }
+}
+
+int main()
+{
+    Server server(8);
+
+    std::shared_ptr<tcp::endpoint> endpoint;
+    Server::Callbacks              callbacks;
+
+    callbacks.listening_on = [&endpoint](const std::shared_ptr<tcp::endpoint>& listening){
+        endpoint = listening;
+    };
+
+    server.setCallbacks(std::move(callbacks));
+    server.setEndpoint(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 0));
+
+    if(!check(server.startConnection() && endpoint, "the server did not start"))
+        return EXIT_FAILURE;
+
+    bool passed = true;
+
+    try
+    {
+        Peer alice(*endpoint), mallory(*endpoint), carol(*endpoint);
+
+        alice.send(MessageRecord::Type::Join, "@alice");
+        alice.sync();
+        passed &= check(alice.joined("@alice"), "the owner could not join its nickname");
+
+        // Carol and mallory share a room, whose message ends each exchange.
+        for(Peer* peer : {&mallory, &carol})
+        {
+            peer->send(MessageRecord::Type::Join, "#sync");
+            peer->sync();
+            passed &= check(peer->joined("#sync"), "a client could not join a room");
+        }
+
+        mallory.send(MessageRecord::Type::Join, "@alice");
+        mallory.sync();
+        passed &= check(!mallory.joined("@alice"), "a second client joined an owned nickname");
+
+        // Nor can it take the nickname from its owner by leaving it.
+        mallory.send(MessageRecord::Type::Leave, "@alice");
+
+        carol.send(MessageRecord::Type::Chat, "@alice", "for alice only");
+        carol.send(MessageRecord::Type::Chat, "#sync", "sync");
+        passed &= check(!mallory.receivedBefore("@alice", "#sync"), "a second client received a direct message");
+
+        alice.send(MessageRecord::Type::Join, "#sync");
+        alice.sync();
+        passed &= check(alice.joined("#sync"), "the owner could not join a room");
+
+        carol.send(MessageRecord::Type::Chat, "@alice", "for alice only");
+        carol.send(MessageRecord::Type::Chat, "#sync", "sync");
+        passed &= check(alice.receivedBefore("@alice", "#sync"), "the owner did not receive its direct message");
+
+        // Once the owner is gone, the nickname is free; it is released on the shard's
+        // strand, shortly after the connection closes.
+        alice.close();
+
+        bool claimed = false;
+
+        for(int attempt = 0; attempt < 100 && !claimed; ++attempt)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+            mallory.send(MessageRecord::Type::Join, "@alice");
+            mallory.sync();
+            claimed = mallory.joined("@alice");
+        }
+
+        passed &= check(claimed, "the nickname was not released when its owner disconnected");
+
+        carol.send(MessageRecord::Type::Chat, "@alice", "for the new owner");
+        carol.send(MessageRecord::Type::Chat, "#sync", "sync");
+        passed &= check(mallory.receivedBefore("@alice", "#sync"), "the new owner did not receive its direct message");
+
+        mallory.close();
+        carol.close();
+    }
+    catch(const std::exception& e)
+    {
+        passed = check(false, e.what());
+    }
+
+    server.finish();
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -8,6 +8,9 @@ class ConanClass(ConanFile):
 
     def requirements(self):
         self.requires("boost/1.86.0")
+        self.requires("zlib/1.3.1")
+        self.requires("lz4/1.9.4")
+        self.requires("zstd/1.5.5")
 
     def generate(self):
         tc = CMakeToolchain(self)